@@ -0,0 +1,115 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2017 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INGEN_ATOMPROTOCOL_HPP
+#define INGEN_ATOMPROTOCOL_HPP
+
+#include <ingen/ingen.h>
+#include <lv2/atom/atom.h>
+#include <lv2/urid/urid.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace ingen {
+
+class URIMap;
+
+/** Format of the messages sent over an Ingen socket connection. */
+enum class SocketFormat {
+	TURTLE, ///< Turtle text, the default
+	ATOM,   ///< Binary atoms, see AtomProtocol
+	SHM,    ///< Binary atoms in shared memory, see ShmSession
+};
+
+/** Per-connection state of the binary atom socket protocol.
+ *
+ * A client selects this protocol by sending atom_protocol_hello as the very
+ * first bytes on a connection, after which both directions are a stream of
+ * frames.  A frame is an LV2_Atom header and body, padded to 64 bits.
+ *
+ * URIDs are local to each process, so they are translated per connection.
+ * Before a message that refers to a URID the peer has not seen yet, the
+ * sender writes a definition frame with type 0, whose body is the URID
+ * followed by the null-terminated URI.  The receiver maps the URI and
+ * rewrites the URIDs in subsequent messages accordingly.  Object IDs that
+ * are not URIs, such as blank node IDs, are not translated, and are sent
+ * with blank_id_flag set to distinguish them from URIDs.
+ *
+ * @ingroup IngenShared
+ */
+class INGEN_API AtomProtocol
+{
+public:
+	explicit AtomProtocol(URIMap& map);
+
+	/// Largest frame body that a receiver accepts
+	static constexpr uint32_t max_frame_size = 1U << 24U;
+
+	/** Largest peer URID accepted before any definitions are received.
+	 *
+	 * Every definition raises the limit by one, so the table of peer URIDs
+	 * only grows with the definitions actually received.
+	 */
+	static constexpr uint32_t max_remote_urid = 1U << 16U;
+
+	/// Flag set in object IDs that are sent as they are
+	static constexpr uint32_t blank_id_flag = 1U << 31U;
+
+	/** Encode a message to send to the peer.
+	 *
+	 * @return The frames to send, which remain valid until the next call.
+	 */
+	const std::vector<uint8_t>& encode(const LV2_Atom* msg);
+
+	/** Decode a received frame in place.
+	 *
+	 * The frame body must be `frame.size` bytes long.  Definitions are
+	 * consumed and left with type 0, messages are rewritten to use local
+	 * URIDs and may be passed to an AtomSink.
+	 *
+	 * @return False if the frame is malformed.
+	 */
+	bool decode(LV2_Atom& frame);
+
+private:
+	template<typename Func, typename IdFunc>
+	bool walk(LV2_Atom& atom, Func& func, IdFunc& id_func) const;
+
+	void define(LV2_URID urid);
+
+	URIMap&               _map;
+	std::vector<uint8_t>  _frames;
+	std::vector<uint64_t> _message;
+	std::vector<bool>     _sent;         ///< Local URIDs the peer knows
+	std::vector<LV2_URID> _remote;       ///< Local URID for each peer URID
+	uint32_t              _n_remote{0U}; ///< Number of definitions received
+	LV2_URID              _atom_Literal;
+	LV2_URID              _atom_Object;
+	LV2_URID              _atom_Property;
+	LV2_URID              _atom_Sequence;
+	LV2_URID              _atom_Tuple;
+	LV2_URID              _atom_URID;
+	LV2_URID              _atom_Vector;
+};
+
+/// Bytes sent by a client to select the binary atom protocol
+constexpr char atom_protocol_hello[8] = {
+	'\0', 'i', 'n', 'g', 'e', 'n', 'A', '1'};
+
+} // namespace ingen
+
+#endif // INGEN_ATOMPROTOCOL_HPP
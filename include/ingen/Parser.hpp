@@ -73,8 +73,10 @@ public:
 	 *
 	 * If `path` is a file path, then the graph is loaded from that
 	 * file.  If it is a directory, then the manifest.ttl from that directory
-	 * is used instead.  In either case, any rdfs:seeAlso files are loaded and
-	 * the graph parsed from the resulting combined model.
+	 * is used instead.  In either case, the graph is read from the file given
+	 * by rdfs:seeAlso in the manifest, if any.  The file is streamed, and
+	 * messages are sent as soon as blocks and arcs are complete, so no model
+	 * of the whole graph is built.
 	 *
 	 * @return whether or not load was successful.
 	 */
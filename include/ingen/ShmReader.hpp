@@ -0,0 +1,78 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2017 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INGEN_SHMREADER_HPP
+#define INGEN_SHMREADER_HPP
+
+#include <ingen/ingen.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+
+namespace raul {
+class Socket;
+} // namespace raul
+
+namespace ingen {
+
+class Interface;
+class ShmRing;
+class ShmSession;
+class World;
+
+/** Calls Interface methods based on messages received via a shared ring.
+ *
+ * The reader thread drains the ring, then sleeps on the session socket until
+ * the writer wakes it up, see ShmRing.
+ */
+class INGEN_API ShmReader
+{
+public:
+	/// Function called from the reader thread when the peer hangs up
+	using HangupHandler = std::function<void()>;
+
+	ShmReader(World&                        world,
+	          Interface&                    iface,
+	          std::shared_ptr<ShmSession>   session,
+	          ShmRing&                      ring,
+	          std::shared_ptr<raul::Socket> sock,
+	          HangupHandler                 on_hangup = {});
+
+	ShmReader(const ShmReader&)            = delete;
+	ShmReader& operator=(const ShmReader&) = delete;
+	ShmReader(ShmReader&&)                 = delete;
+	ShmReader& operator=(ShmReader&&)      = delete;
+
+	~ShmReader();
+
+private:
+	void run();
+
+	World&                        _world;
+	Interface&                    _iface;
+	std::shared_ptr<ShmSession>   _session;
+	ShmRing&                      _ring;
+	std::shared_ptr<raul::Socket> _socket;
+	HangupHandler                 _on_hangup;
+	std::atomic<bool>             _exit_flag{false};
+	std::thread                   _thread;
+};
+
+} // namespace ingen
+
+#endif // INGEN_SHMREADER_HPP
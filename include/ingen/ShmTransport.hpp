@@ -0,0 +1,226 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2017 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INGEN_SHMTRANSPORT_HPP
+#define INGEN_SHMTRANSPORT_HPP
+
+#include <ingen/ingen.h>
+#include <lv2/atom/atom.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ingen {
+
+/** Start of a stream from a client that requests a shared memory session.
+ *
+ * Like the atom protocol hello, this is sent on a UNIX engine socket.  The
+ * engine replies with the descriptors of a ShmSession and the ShmValues of
+ * the engine, after which messages are exchanged through the session rings
+ * and the socket only carries single wakeup bytes.
+ */
+constexpr char shm_protocol_hello[8] = {'\0', 'i', 'n', 'g', 'e', 'n', 'S', '1'};
+
+/** Memory backed by an anonymous file.
+ *
+ * Regions are shared with other processes by passing their file descriptor
+ * over a UNIX socket, see shm_send_fds().
+ */
+class INGEN_API ShmRegion
+{
+public:
+	/// Create a new zeroed region, or return null on error
+	static std::unique_ptr<ShmRegion> create(const char* name, size_t size);
+
+	/** Map a region received from another process.
+	 *
+	 * The region takes ownership of `fd`, which is closed on error.
+	 */
+	static std::unique_ptr<ShmRegion> attach(int fd, bool writable);
+
+	ShmRegion(const ShmRegion&)            = delete;
+	ShmRegion& operator=(const ShmRegion&) = delete;
+	ShmRegion(ShmRegion&&)                 = delete;
+	ShmRegion& operator=(ShmRegion&&)      = delete;
+
+	~ShmRegion();
+
+	int    fd() const { return _fd; }
+	void*  data() const { return _data; }
+	size_t size() const { return _size; }
+
+private:
+	ShmRegion(int fd, void* data, size_t size)
+		: _fd(fd), _data(data), _size(size)
+	{}
+
+	int    _fd;
+	void*  _data;
+	size_t _size;
+};
+
+/** A lock-free ring of atom protocol frames in shared memory.
+ *
+ * There is a single writer and a single reader, usually in different
+ * processes.  A reader that finds the ring empty may sleep on the socket of
+ * its session, in which case the writer wakes it up by sending a byte.
+ */
+class INGEN_API ShmRing
+{
+public:
+	/// Return the size of memory needed for a ring of `capacity` bytes
+	static size_t memory_size(uint32_t capacity);
+
+	/// Use a ring in `mem`, which is initialised if `init` is true
+	ShmRing(void* mem, uint32_t capacity, bool init);
+
+	/// Write complete frames, return false if there is not enough space
+	bool write(const void* buf, uint32_t size);
+
+	/// Read the next frame into `buf` and return it, or null if there is none
+	LV2_Atom* read(std::vector<uint64_t>& buf);
+
+	/** Announce that the reader is going to sleep.
+	 *
+	 * Returns false if the ring is not empty, in which case the reader must
+	 * not sleep, since it may never be woken up.
+	 */
+	bool sleep();
+
+	/** Return true iff the reader is sleeping and must be woken up.
+	 *
+	 * This is called by the writer after writing, and clears the flag, so
+	 * the reader is woken only once.
+	 */
+	bool wake();
+
+private:
+	struct Header {
+		alignas(64) std::atomic<uint32_t> write_head;
+		alignas(64) std::atomic<uint32_t> read_head;
+		alignas(64) std::atomic<uint32_t> sleeping;
+	};
+
+	void copy_out(uint32_t head, void* buf, uint32_t size) const;
+
+	Header*  _header;
+	uint8_t* _data;
+	uint32_t _capacity;
+};
+
+/** The shared memory of a client session, with a ring in each direction. */
+class INGEN_API ShmSession
+{
+public:
+	/// Size of each ring in bytes
+	static constexpr uint32_t ring_capacity = 1U << 20U;
+
+	/// Create a new session in the engine, or return null on error
+	static std::unique_ptr<ShmSession> create();
+
+	/// Use a session received from the engine, or return null on error
+	static std::unique_ptr<ShmSession> attach(int fd);
+
+	int      fd() const { return _region->fd(); }
+	ShmRing& to_engine() { return _to_engine; }
+	ShmRing& to_client() { return _to_client; }
+
+private:
+	ShmSession(std::unique_ptr<ShmRegion> region, bool init);
+
+	std::unique_ptr<ShmRegion> _region;
+	ShmRing                    _to_engine;
+	ShmRing                    _to_client;
+};
+
+/** The latest values of engine ports, shared with local clients.
+ *
+ * This is a fixed-size hash table keyed by port path.  The audio thread
+ * writes control values and audio peaks into it as they are monitored, and
+ * clients can read them at any time without messages or system calls.
+ */
+class INGEN_API ShmValues
+{
+public:
+	/// Default number of ports that can have a value
+	static constexpr uint32_t default_capacity = 4096U;
+
+	/// Create a new table in the engine, or return null on error
+	static std::unique_ptr<ShmValues> create(uint32_t capacity);
+
+	/// Use a table received from the engine, or return null on error
+	static std::unique_ptr<ShmValues> attach(int fd);
+
+	/// Return the key of the port at `path`
+	static uint64_t key(const char* path)
+	{
+		// 64-bit FNV-1a, with zero reserved for empty entries
+		uint64_t hash = 0xCBF29CE484222325U;
+		for (const char* c = path; *c; ++c) {
+			hash = (hash ^ static_cast<uint8_t>(*c)) * 0x100000001B3U;
+		}
+
+		return hash ? hash : 1U;
+	}
+
+	int fd() const { return _region->fd(); }
+
+	/// Set the control value of a port (realtime safe)
+	void write_value(uint64_t key, float value) { write(key, value, false); }
+
+	/// Set the peak level of an audio port (realtime safe)
+	void write_peak(uint64_t key, float peak) { write(key, peak, true); }
+
+	/** Get the latest value and peak of a port.
+	 *
+	 * Returns false if the port has no value, or if it could not be read
+	 * consistently after a bounded number of attempts.
+	 */
+	bool read(uint64_t key, float& value, float& peak) const;
+
+private:
+	struct Entry {
+		std::atomic<uint32_t> seq;
+		std::atomic<uint64_t> key;
+		std::atomic<float>    value;
+		std::atomic<float>    peak;
+	};
+
+	ShmValues(std::unique_ptr<ShmRegion> region, uint32_t capacity);
+
+	Entry* find(uint64_t key, bool insert) const;
+	void   write(uint64_t key, float value, bool is_peak);
+
+	std::unique_ptr<ShmRegion> _region;
+	Entry*                     _entries;
+	uint32_t                   _capacity;
+};
+
+/// Send file descriptors over a UNIX socket, with a single byte of data
+INGEN_API bool shm_send_fds(int sock, const int* fds, size_t n_fds);
+
+/// Receive descriptors sent with shm_send_fds(), return how many arrived
+INGEN_API size_t shm_recv_fds(int sock, int* fds, size_t n_fds);
+
+/// Wake up the reader on the other end of a session socket
+INGEN_API void shm_wake(int sock);
+
+} // namespace ingen
+
+#endif // INGEN_SHMTRANSPORT_HPP
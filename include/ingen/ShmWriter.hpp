@@ -0,0 +1,69 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2017 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INGEN_SHMWRITER_HPP
+#define INGEN_SHMWRITER_HPP
+
+#include <ingen/AtomProtocol.hpp>
+#include <ingen/AtomSink.hpp>
+#include <ingen/AtomWriter.hpp>
+#include <ingen/URI.hpp>
+#include <ingen/ingen.h>
+#include <lv2/atom/atom.h>
+
+#include <cstdint>
+#include <memory>
+
+namespace raul {
+class Socket;
+} // namespace raul
+
+namespace ingen {
+
+class ShmRing;
+class ShmSession;
+class URIMap;
+class URIs;
+
+/** An Interface that writes binary atom messages to a shared memory ring.
+ *
+ * The socket of the session is only used to wake up the reader.
+ */
+class INGEN_API ShmWriter : public AtomWriter, public AtomSink
+{
+public:
+	ShmWriter(URIMap&                       map,
+	          URIs&                         uris,
+	          URI                           uri,
+	          std::shared_ptr<ShmSession>   session,
+	          ShmRing&                      ring,
+	          std::shared_ptr<raul::Socket> sock);
+
+	bool write(const LV2_Atom* msg, int32_t default_id=0) override;
+
+	URI uri() const override { return _uri; }
+
+protected:
+	std::shared_ptr<ShmSession>   _session;
+	ShmRing&                      _ring;
+	std::shared_ptr<raul::Socket> _socket;
+	AtomProtocol                  _protocol;
+	URI                           _uri;
+};
+
+} // namespace ingen
+
+#endif // INGEN_SHMWRITER_HPP
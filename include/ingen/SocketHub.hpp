@@ -0,0 +1,120 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2017 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INGEN_SOCKETHUB_HPP
+#define INGEN_SOCKETHUB_HPP
+
+#include <ingen/AtomProtocol.hpp>
+#include <ingen/ingen.h>
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace raul {
+class Socket;
+} // namespace raul
+
+namespace ingen {
+
+class Interface;
+class ShmSession;
+class ShmValues;
+class World;
+
+/** Calls Interface methods based on messages received via many sockets.
+ *
+ * Unlike SocketReader, which uses a thread for every connection, this polls
+ * all connections with epoll from a fixed pool of threads.  Input is read
+ * without blocking into a buffer for each connection, and parsed as soon as a
+ * complete message has arrived.
+ *
+ * Clients on the same host may instead request a shared memory session, in
+ * which case messages are read from its ring when the client wakes the hub.
+ */
+class INGEN_API SocketHub
+{
+public:
+	/** Function called with the format of a connection once it is known.
+	 *
+	 * For SocketFormat::SHM, `session` is the shared memory of the
+	 * connection, otherwise it is null.
+	 */
+	using FormatHandler =
+		std::function<void(SocketFormat                       format,
+		                   const std::shared_ptr<ShmSession>& session)>;
+
+	/// Function called after a connection has been closed
+	using HangupHandler = std::function<void()>;
+
+	/** Create a hub that reads with `n_threads` threads.
+	 *
+	 * Clients may request a shared memory session only if `values` is
+	 * given, which is then shared with them.
+	 */
+	SocketHub(World&           world,
+	          unsigned         n_threads,
+	          const ShmValues* values = nullptr);
+
+	SocketHub(const SocketHub&)            = delete;
+	SocketHub& operator=(const SocketHub&) = delete;
+	SocketHub(SocketHub&&)                 = delete;
+	SocketHub& operator=(SocketHub&&)      = delete;
+
+	~SocketHub();
+
+	/** Start reading messages from a connected socket.
+	 *
+	 * The format is detected like SocketReader does, and reported to
+	 * `on_format` before any message is sent to `iface`.  After the
+	 * connection has been closed, `on_hangup` is called and `iface` is no
+	 * longer used.  Both handlers are called from an I/O thread, or when the
+	 * hub is destroyed.
+	 */
+	void add(std::shared_ptr<raul::Socket> sock,
+	         Interface&                    iface,
+	         FormatHandler                 on_format,
+	         HangupHandler                 on_hangup);
+
+	/// Return the number of open connections
+	size_t size() const;
+
+private:
+	class Connection;
+
+	void run();
+	void handle(Connection* conn);
+	void remove(Connection* conn);
+
+	using Connections = std::map<Connection*, std::unique_ptr<Connection>>;
+
+	World&                   _world;
+	const ShmValues*         _values;
+	int                      _epoll{-1};
+	mutable std::mutex       _mutex;
+	Connections              _connections;
+	std::atomic<bool>        _exit_flag{false};
+	std::vector<std::thread> _threads;
+};
+
+} // namespace ingen
+
+#endif // INGEN_SOCKETHUB_HPP
@@ -17,11 +17,13 @@
 #ifndef INGEN_SOCKETREADER_HPP
 #define INGEN_SOCKETREADER_HPP
 
+#include <ingen/AtomProtocol.hpp>
 #include <ingen/ingen.h>
 #include <serd/serd.h>
 #include <sord/sord.h>
 
 #include <cstddef>
+#include <functional>
 #include <memory>
 #include <thread>
 
@@ -34,13 +36,29 @@ namespace ingen {
 class Interface;
 class World;
 
-/** Calls Interface methods based on Turtle messages received via socket. */
+/** Calls Interface methods based on messages received via socket. */
 class INGEN_API SocketReader
 {
 public:
+	/// Function called with the format of a connection once it is known
+	using FormatHandler = std::function<void(SocketFormat)>;
+
+	/** Read messages in a known format. */
+	SocketReader(World&                        world,
+	             Interface&                    iface,
+	             std::shared_ptr<raul::Socket> sock,
+	             SocketFormat                  format = SocketFormat::TURTLE);
+
+	/** Read messages in the format requested by the peer.
+	 *
+	 * The format is detected from the start of the stream, see AtomProtocol.
+	 * The handler is called from the reader thread before any message is
+	 * read.
+	 */
 	SocketReader(World&                        world,
 	             Interface&                    iface,
-	             std::shared_ptr<raul::Socket> sock);
+	             std::shared_ptr<raul::Socket> sock,
+	             FormatHandler                 on_format);
 
 	virtual ~SocketReader();
 
@@ -55,6 +73,10 @@ private:
 	static int c_err(void* stream);
 
 	void run();
+	void read_turtle();
+	void read_atoms();
+
+	bool recv_all(void* buf, size_t len);
 
 	static SerdStatus set_base_uri(SocketReader*   iface,
 	                               const SerdNode* uri_node);
@@ -74,12 +96,15 @@ private:
 
 	World&                        _world;
 	Interface&                    _iface;
+	SordWorld*                    _sord_world{nullptr};
 	SerdEnv*                      _env{nullptr};
 	SordInserter*                 _inserter{nullptr};
 	SordNode*                     _msg_node{nullptr};
 	std::shared_ptr<raul::Socket> _socket;
 	int                           _socket_error{0};
 	bool                          _exit_flag{false};
+	SocketFormat                  _format;
+	FormatHandler                 _on_format;
 	std::thread                   _thread;
 };
 
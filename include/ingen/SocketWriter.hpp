@@ -17,12 +17,16 @@
 #ifndef INGEN_SOCKETWRITER_HPP
 #define INGEN_SOCKETWRITER_HPP
 
+#include <ingen/AtomProtocol.hpp>
 #include <ingen/Message.hpp>
 #include <ingen/TurtleWriter.hpp>
 #include <ingen/ingen.h>
+#include <lv2/atom/atom.h>
 
 #include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <string>
 
 namespace raul {
 class Socket;
@@ -34,7 +38,10 @@ class URI;
 class URIMap;
 class URIs;
 
-/** An Interface that writes Turtle messages to a socket.
+/** An Interface that writes Turtle or binary atom messages to a socket.
+ *
+ * In Turtle, the end of a bundle is marked with a null byte.  Bundles may be
+ * nested, in which case only the end of the outermost one is marked.
  */
 class INGEN_API SocketWriter : public TurtleWriter
 {
@@ -42,14 +49,31 @@ public:
 	SocketWriter(URIMap&                       map,
 	             URIs&                         uris,
 	             const URI&                    uri,
-	             std::shared_ptr<raul::Socket> sock);
+	             std::shared_ptr<raul::Socket> sock,
+	             SocketFormat                  format = SocketFormat::TURTLE);
+
+	/** Keep output instead of blocking when the socket is full.
+	 *
+	 * Output that can't be sent immediately is sent by flush(), and any
+	 * output that follows it is kept as well until then.
+	 */
+	void set_nonblocking(bool nonblocking) { _nonblocking = nonblocking; }
+
+	/** Send kept output without blocking, return true if none is left. */
+	bool flush();
 
 	void message(const Message& message) override;
 
+	bool write(const LV2_Atom* msg, int32_t default_id=0) override;
+
 	size_t text_sink(const void* buf, size_t len) override;
 
 protected:
 	std::shared_ptr<raul::Socket> _socket;
+	std::unique_ptr<AtomProtocol> _protocol; ///< Null for Turtle
+	std::string                   _unsent;   ///< Output kept by flush()
+	unsigned                      _bundle_depth{0U}; ///< Open Turtle bundles
+	bool                          _nonblocking{false};
 };
 
 } // namespace ingen
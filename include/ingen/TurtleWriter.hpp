@@ -19,14 +19,20 @@
 
 #include <ingen/AtomSink.hpp>
 #include <ingen/AtomWriter.hpp>
+#include <ingen/Message.hpp>
 #include <ingen/URI.hpp>
 #include <ingen/ingen.h>
 #include <lv2/atom/atom.h>
+#include <lv2/urid/urid.h>
 #include <serd/serd.h>
 #include <sratom/sratom.h>
 
 #include <cstddef>
 #include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace ingen {
 
@@ -37,6 +43,12 @@ class URIs;
  *
  * Derived classes must implement text_sink() to do something with the
  * serialized messages.
+ *
+ * Value changes are by far the most common messages, so SetProperty and
+ * Delta messages with only numeric, boolean, or URI values take a faster
+ * path.  The first message of each shape is serialised as usual and kept as
+ * a template, and later ones are written by filling in their numbers, which
+ * gives exactly the same output without going through sratom and serd.
  */
 class INGEN_API TurtleWriter : public AtomWriter, public AtomSink
 {
@@ -45,6 +57,9 @@ public:
 
 	~TurtleWriter() override;
 
+	/** Write a message, using a template if possible. */
+	void message(const Message& message) override;
+
 	/** AtomSink method which receives calls serialized to LV2 atoms. */
 	bool write(const LV2_Atom* msg, int32_t default_id=0) override;
 
@@ -62,6 +77,46 @@ protected:
 	SerdWriter* _writer;
 	URI         _uri;
 	bool        _wrote_prefixes{false};
+
+private:
+	/// Serialised message with holes for the label and values
+	struct Template {
+		std::vector<std::string> text;   ///< Text before each hole, and tail
+		std::vector<uint64_t>    blanks; ///< Atom with as many blank objects
+		bool                     usable{false};
+	};
+
+	/// A scalar value to write into a hole
+	using Value = std::pair<LV2_URID, const void*>;
+
+	bool shape(const Message& message);
+	bool add_value(const Atom& value);
+	void literal(std::string& out, const Value& value) const;
+	void learn(Template& tmpl, const Message& message);
+	void write_template(const Template& tmpl);
+
+	static size_t write_text(const void* buf, size_t len, void* stream);
+
+	static SerdStatus write_statement(TurtleWriter*      writer,
+	                                  SerdStatementFlags flags,
+	                                  const SerdNode*    graph,
+	                                  const SerdNode*    subject,
+	                                  const SerdNode*    predicate,
+	                                  const SerdNode*    object,
+	                                  const SerdNode*    object_datatype,
+	                                  const SerdNode*    object_lang);
+
+	static SerdStatus end_anon(TurtleWriter* writer, const SerdNode* node);
+
+	URIs&                                     _uris;
+	std::unordered_map<std::string, Template> _templates;
+	std::string                               _key;     ///< Shape of message
+	std::vector<Value>                        _values;  ///< Values in holes
+	std::string                               _text;    ///< Output buffer
+	std::string                               _label;   ///< Blank label
+	std::string*                              _capture{nullptr};
+	bool                                      _counting{false};
+	bool                                      _steady{false};
 };
 
 } // namespace ingen
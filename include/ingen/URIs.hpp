@@ -104,6 +104,8 @@ public:
 	Quark ingen_broadcast;
 	Quark ingen_canvasX;
 	Quark ingen_canvasY;
+	Quark ingen_catalogVersion;
+	Quark ingen_deferredEvents;
 	Quark ingen_enabled;
 	Quark ingen_externalContext;
 	Quark ingen_file;
@@ -111,6 +113,7 @@ public:
 	Quark ingen_incidentTo;
 	Quark ingen_internalContext;
 	Quark ingen_loadedBundle;
+	Quark ingen_maxQueueDepth;
 	Quark ingen_maxRunLoad;
 	Quark ingen_meanRunLoad;
 	Quark ingen_minRunLoad;
@@ -118,7 +121,11 @@ public:
 	Quark ingen_polyphonic;
 	Quark ingen_polyphony;
 	Quark ingen_prototype;
+	Quark ingen_queueDepth;
+	Quark ingen_spareVoices;
 	Quark ingen_sprungLayout;
+	Quark ingen_subscribe;
+	Quark ingen_subscribeProperty;
 	Quark ingen_tail;
 	Quark ingen_uiEmbedded;
 	Quark ingen_value;
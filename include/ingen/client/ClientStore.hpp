@@ -43,6 +43,7 @@ namespace client {
 
 class GraphModel;
 class ObjectModel;
+class PluginCache;
 class PluginModel;
 class SigClientInterface;
 
@@ -74,6 +75,19 @@ public:
 
 	void set_plugins(std::shared_ptr<Plugins> p) { _plugins = std::move(p); }
 
+	/** Set the cache to load and save the plugin catalog with.
+	 *
+	 * When the engine sends the catalog version, a cached catalog of that
+	 * version is loaded, or the plugins received so far are saved as it.
+	 */
+	void set_plugin_cache(std::shared_ptr<PluginCache> cache) {
+		_plugin_cache = std::move(cache);
+	}
+
+	std::shared_ptr<const PluginCache> plugin_cache() const {
+		return _plugin_cache;
+	}
+
 	URIs& uris() { return _uris; }
 
 	void message(const Message& msg) override;
@@ -121,7 +135,8 @@ private:
 	Log&                                _log;
 	std::shared_ptr<SigClientInterface> _emitter;
 
-	std::shared_ptr<Plugins> _plugins; ///< Map, keyed by plugin URI
+	std::shared_ptr<Plugins>     _plugins; ///< Map, keyed by plugin URI
+	std::shared_ptr<PluginCache> _plugin_cache;
 };
 
 } // namespace client
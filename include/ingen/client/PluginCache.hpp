@@ -0,0 +1,81 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2017 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INGEN_CLIENT_PLUGINCACHE_HPP
+#define INGEN_CLIENT_PLUGINCACHE_HPP
+
+#include <ingen/FilePath.hpp>
+#include <ingen/URI.hpp>
+#include <ingen/client/ClientStore.hpp>
+#include <ingen/ingen.h>
+
+#include <cstddef>
+#include <string>
+
+namespace ingen {
+
+class Interface;
+class URIMap;
+class URIs;
+
+namespace client {
+
+/** Plugin catalogs of engines saved across sessions.
+ *
+ * Each catalog is saved as a Turtle file named after its version, see
+ * ingen:catalogVersion.  A client gets the plugins with request_uri(), and
+ * when the engine replies with the version, either loads the catalog it
+ * already has or saves the one it was just sent.
+ *
+ * @ingroup IngenClient
+ */
+class INGEN_API PluginCache
+{
+public:
+	PluginCache(URIMap& map, URIs& uris, FilePath dir);
+
+	/// Number of catalogs kept, older ones are removed when saving
+	static constexpr size_t max_catalogs = 4U;
+
+	/** Return the URI to get plugins with.
+	 *
+	 * This names the most recently used catalog, so the engine doesn't send
+	 * any plugins if it is still current.
+	 */
+	URI request_uri() const;
+
+	/** Put every plugin in the catalog `version` to `target`.
+	 *
+	 * @return False if no catalog with this version is cached.
+	 */
+	bool load(const std::string& version, Interface& target) const;
+
+	/** Save `plugins` as the catalog `version`. */
+	bool save(const std::string&          version,
+	          const ClientStore::Plugins& plugins) const;
+
+private:
+	FilePath path(const std::string& version) const;
+
+	URIMap&  _map;
+	URIs&    _uris;
+	FilePath _dir;
+};
+
+} // namespace client
+} // namespace ingen
+
+#endif // INGEN_CLIENT_PLUGINCACHE_HPP
@@ -0,0 +1,143 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2017 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INGEN_CLIENT_SHMCLIENT_HPP
+#define INGEN_CLIENT_SHMCLIENT_HPP
+
+#include <ingen/Log.hpp>
+#include <ingen/ShmReader.hpp>
+#include <ingen/ShmTransport.hpp>
+#include <ingen/ShmWriter.hpp>
+#include <ingen/URI.hpp>
+#include <ingen/World.hpp>
+#include <ingen/ingen.h>
+#include <raul/Socket.hpp>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace ingen {
+
+class Interface;
+
+namespace client {
+
+/** The client side of a shared memory connection to a local engine.
+ *
+ * A URI like shm:///tmp/ingen.sock connects to the UNIX socket at its path,
+ * and requests a session with shm_protocol_hello.  Messages are then
+ * exchanged as binary atoms in shared rings, and the values of engine ports
+ * can be read directly with values().
+ */
+class INGEN_API ShmClient : public ShmWriter
+{
+public:
+	ShmClient(World&                               world,
+	          const URI&                           uri,
+	          const std::shared_ptr<raul::Socket>& sock,
+	          const std::shared_ptr<Interface>&    respondee,
+	          const std::shared_ptr<ShmSession>&   session,
+	          std::unique_ptr<ShmValues>           values)
+	    : ShmWriter(world.uri_map(),
+	                world.uris(),
+	                uri,
+	                session,
+	                session->to_engine(),
+	                sock)
+	    , _respondee(respondee)
+	    , _values(std::move(values))
+	    , _reader(world, *respondee, session, session->to_client(), sock)
+	{}
+
+	std::shared_ptr<Interface> respondee() const override {
+		return _respondee;
+	}
+
+	void set_respondee(const std::shared_ptr<Interface>& respondee) override
+	{
+		_respondee = respondee;
+	}
+
+	/// Return the latest values of engine ports, updated by the engine
+	const ShmValues& values() const { return *_values; }
+
+	static std::shared_ptr<ingen::Interface>
+	new_shm_interface(ingen::World&                            world,
+	                  const URI&                               uri,
+	                  const std::shared_ptr<ingen::Interface>& respondee)
+	{
+		const std::shared_ptr<raul::Socket> sock{
+		    new raul::Socket(raul::Socket::Type::UNIX)};
+		if (!sock->connect(URI("unix://" + std::string(uri.path())))) {
+			world.log().error("Failed to connect <%1%> (%2%)\n",
+			                  sock->uri(), strerror(errno));
+			return nullptr;
+		}
+
+		if (send(sock->fd(),
+		         shm_protocol_hello,
+		         sizeof(shm_protocol_hello),
+		         MSG_NOSIGNAL) !=
+		    static_cast<ssize_t>(sizeof(shm_protocol_hello))) {
+			world.log().error("Failed to write to <%1%> (%2%)\n",
+			                  sock->uri(), strerror(errno));
+			return nullptr;
+		}
+
+		// The engine replies with the session and value table descriptors
+		int fds[2] = {-1, -1};
+		if (shm_recv_fds(sock->fd(), fds, 2U) != 2U) {
+			world.log().error("No shared memory from <%1%>\n", sock->uri());
+			for (const int fd : fds) {
+				if (fd >= 0) {
+					close(fd);
+				}
+			}
+			return nullptr;
+		}
+
+		const std::shared_ptr<ShmSession> session = ShmSession::attach(fds[0]);
+		auto                              values  = ShmValues::attach(fds[1]);
+		if (!session || !values) {
+			world.log().error("Invalid shared memory from <%1%>\n",
+			                  sock->uri());
+			return nullptr;
+		}
+
+		return std::shared_ptr<Interface>(new ShmClient(
+		    world, uri, sock, respondee, session, std::move(values)));
+	}
+
+	static void register_factories(World& world) {
+		world.add_interface_factory("shm", &new_shm_interface);
+	}
+
+private:
+	std::shared_ptr<Interface> _respondee;
+	std::unique_ptr<ShmValues> _values;
+	ShmReader                  _reader;
+};
+
+} // namespace client
+} // namespace ingen
+
+#endif // INGEN_CLIENT_SHMCLIENT_HPP
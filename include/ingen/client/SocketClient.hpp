@@ -17,6 +17,9 @@
 #ifndef INGEN_CLIENT_SOCKETCLIENT_HPP
 #define INGEN_CLIENT_SOCKETCLIENT_HPP
 
+#include <ingen/Atom.hpp>
+#include <ingen/AtomProtocol.hpp>
+#include <ingen/Configuration.hpp>
 #include <ingen/Log.hpp>
 #include <ingen/SocketReader.hpp>
 #include <ingen/SocketWriter.hpp>
@@ -25,10 +28,16 @@
 #include <ingen/ingen.h>
 #include <raul/Socket.hpp>
 
+#include <sys/socket.h>
+
 #include <cerrno>
 #include <cstring>
 #include <memory>
 
+#ifndef MSG_NOSIGNAL
+#    define MSG_NOSIGNAL 0
+#endif
+
 namespace ingen {
 
 class Interface;
@@ -42,10 +51,11 @@ public:
 	SocketClient(World&                               world,
 	             const URI&                           uri,
 	             const std::shared_ptr<raul::Socket>& sock,
-	             const std::shared_ptr<Interface>&    respondee)
-	    : SocketWriter(world.uri_map(), world.uris(), uri, sock)
+	             const std::shared_ptr<Interface>&    respondee,
+	             SocketFormat                         format = SocketFormat::TURTLE)
+	    : SocketWriter(world.uri_map(), world.uris(), uri, sock, format)
 	    , _respondee(respondee)
-	    , _reader(world, *respondee, sock)
+	    , _reader(world, *respondee, sock, format)
 	{}
 
 	std::shared_ptr<Interface> respondee() const override {
@@ -72,8 +82,25 @@ public:
 			                  sock->uri(), strerror(errno));
 			return nullptr;
 		}
+
+		// Request binary atom messages if enabled, see AtomProtocol
+		SocketFormat format = SocketFormat::TURTLE;
+		if (world.conf().option("binary").get<int32_t>()) {
+			if (send(sock->fd(),
+			         atom_protocol_hello,
+			         sizeof(atom_protocol_hello),
+			         MSG_NOSIGNAL) !=
+			    static_cast<ssize_t>(sizeof(atom_protocol_hello))) {
+				world.log().error("Failed to write to <%1%> (%2%)\n",
+				                  sock->uri(), strerror(errno));
+				return nullptr;
+			}
+
+			format = SocketFormat::ATOM;
+		}
+
 		return std::shared_ptr<Interface>(
-		    new SocketClient(world, uri, sock, respondee));
+		    new SocketClient(world, uri, sock, respondee, format));
 	}
 
 	static void register_factories(World& world) {
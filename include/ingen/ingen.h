@@ -46,6 +46,8 @@
 #define INGEN__broadcast       INGEN_NS "broadcast"
 #define INGEN__canvasX         INGEN_NS "canvasX"
 #define INGEN__canvasY         INGEN_NS "canvasY"
+#define INGEN__catalogVersion  INGEN_NS "catalogVersion"
+#define INGEN__deferredEvents  INGEN_NS "deferredEvents"
 #define INGEN__enabled         INGEN_NS "enabled"
 #define INGEN__externalContext INGEN_NS "externalContext"
 #define INGEN__file            INGEN_NS "file"
@@ -53,6 +55,7 @@
 #define INGEN__incidentTo      INGEN_NS "incidentTo"
 #define INGEN__internalContext INGEN_NS "internalContext"
 #define INGEN__loadedBundle    INGEN_NS "loadedBundle"
+#define INGEN__maxQueueDepth   INGEN_NS "maxQueueDepth"
 #define INGEN__maxRunLoad      INGEN_NS "maxRunLoad"
 #define INGEN__meanRunLoad     INGEN_NS "meanRunLoad"
 #define INGEN__minRunLoad      INGEN_NS "minRunLoad"
@@ -60,7 +63,11 @@
 #define INGEN__polyphonic      INGEN_NS "polyphonic"
 #define INGEN__polyphony       INGEN_NS "polyphony"
 #define INGEN__prototype       INGEN_NS "prototype"
+#define INGEN__queueDepth      INGEN_NS "queueDepth"
+#define INGEN__spareVoices     INGEN_NS "spareVoices"
 #define INGEN__sprungLayout    INGEN_NS "sprungLayout"
+#define INGEN__subscribe       INGEN_NS "subscribe"
+#define INGEN__subscribeProperty INGEN_NS "subscribeProperty"
 #define INGEN__tail            INGEN_NS "tail"
 #define INGEN__uiEmbedded      INGEN_NS "uiEmbedded"
 #define INGEN__value           INGEN_NS "value"
@@ -27,6 +27,14 @@ namespace ingen {
 
 inline URI main_uri() { return URI("ingen:/main"); }
 
+inline URI plugins_uri() { return URI("ingen:/plugins"); }
+
+/** Return the URI to get plugins with unless the catalog is at `version`. */
+inline URI plugins_uri(const std::string& version)
+{
+	return URI(plugins_uri().string() + "?version=" + version);
+}
+
 inline bool uri_is_path(const URI& uri)
 {
 	const size_t root_len = main_uri().string().length();
@@ -36,6 +36,7 @@ INGEN_API FilePath bundle_file_path(const std::string& name);
 INGEN_API FilePath data_file_path(const std::string& name);
 INGEN_API FilePath ingen_module_path(const std::string& name);
 
+INGEN_API FilePath              user_cache_dir();
 INGEN_API FilePath              user_config_dir();
 INGEN_API FilePath              user_data_dir();
 INGEN_API std::vector<FilePath> system_config_dirs();
@@ -0,0 +1,256 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2017 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ingen/AtomProtocol.hpp>
+
+#include <ingen/URIMap.hpp>
+#include <lv2/atom/atom.h>
+#include <lv2/atom/util.h>
+#include <lv2/urid/urid.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace ingen {
+
+AtomProtocol::AtomProtocol(URIMap& map)
+	: _map{map}
+	, _atom_Literal{map.map_uri(LV2_ATOM__Literal)}
+	, _atom_Object{map.map_uri(LV2_ATOM__Object)}
+	, _atom_Property{map.map_uri(LV2_ATOM__Property)}
+	, _atom_Sequence{map.map_uri(LV2_ATOM__Sequence)}
+	, _atom_Tuple{map.map_uri(LV2_ATOM__Tuple)}
+	, _atom_URID{map.map_uri(LV2_ATOM__URID)}
+	, _atom_Vector{map.map_uri(LV2_ATOM__Vector)}
+{}
+
+/** Call `func` on every URID in `atom`, including nested atoms.
+ *
+ * The type of an atom is passed to `func` before its body is inspected, so
+ * `func` may rewrite URIDs in place.  Object IDs, which may be blank node IDs
+ * rather than URIDs, are passed to `id_func` instead.  Returns false if a
+ * child does not fit within its parent.
+ */
+template<typename Func, typename IdFunc>
+bool
+AtomProtocol::walk(LV2_Atom& atom, Func& func, IdFunc& id_func) const
+{
+	func(atom.type);
+
+	auto* const    body = reinterpret_cast<uint8_t*>(&atom + 1);
+	const uint32_t size = atom.size;
+
+	// Walk a property body at `offset`, returning its padded size or 0
+	const auto walk_property = [&](const uint32_t offset) -> uint32_t {
+		if (size - offset < sizeof(LV2_Atom_Property_Body)) {
+			return 0U;
+		}
+
+		auto* const prop = reinterpret_cast<LV2_Atom_Property_Body*>(body + offset);
+		if (prop->value.size >
+		    size - offset - sizeof(LV2_Atom_Property_Body)) {
+			return 0U;
+		}
+
+		func(prop->key);
+		func(prop->context);
+		if (!walk(prop->value, func, id_func)) {
+			return 0U;
+		}
+
+		return lv2_atom_pad_size(sizeof(LV2_Atom_Property_Body) +
+		                         prop->value.size);
+	};
+
+	if (atom.type == _atom_URID) {
+		if (size < sizeof(uint32_t)) {
+			return false;
+		}
+
+		func(*reinterpret_cast<uint32_t*>(body));
+	} else if (atom.type == _atom_Literal) {
+		if (size < sizeof(LV2_Atom_Literal_Body)) {
+			return false;
+		}
+
+		auto* const lit = reinterpret_cast<LV2_Atom_Literal_Body*>(body);
+		func(lit->datatype);
+		func(lit->lang);
+	} else if (atom.type == _atom_Property) {
+		return size == 0U || walk_property(0U);
+	} else if (atom.type == _atom_Object) {
+		if (size < sizeof(LV2_Atom_Object_Body)) {
+			return false;
+		}
+
+		auto* const obj = reinterpret_cast<LV2_Atom_Object_Body*>(body);
+		id_func(obj->id);
+		func(obj->otype);
+		for (uint32_t offset = sizeof(LV2_Atom_Object_Body); offset < size;) {
+			const uint32_t prop_size = walk_property(offset);
+			if (!prop_size) {
+				return false;
+			}
+
+			offset += prop_size;
+		}
+	} else if (atom.type == _atom_Tuple) {
+		for (uint32_t offset = 0U; offset < size;) {
+			auto* const child = reinterpret_cast<LV2_Atom*>(body + offset);
+			if (size - offset < sizeof(LV2_Atom) ||
+			    child->size > size - offset - sizeof(LV2_Atom) ||
+			    !walk(*child, func, id_func)) {
+				return false;
+			}
+
+			offset += lv2_atom_pad_size(sizeof(LV2_Atom) + child->size);
+		}
+	} else if (atom.type == _atom_Sequence) {
+		if (size < sizeof(LV2_Atom_Sequence_Body)) {
+			return false;
+		}
+
+		auto* const seq = reinterpret_cast<LV2_Atom_Sequence_Body*>(body);
+		func(seq->unit);
+		for (uint32_t offset = sizeof(LV2_Atom_Sequence_Body); offset < size;) {
+			auto* const ev = reinterpret_cast<LV2_Atom_Event*>(body + offset);
+			if (size - offset < sizeof(LV2_Atom_Event) ||
+			    ev->body.size > size - offset - sizeof(LV2_Atom_Event) ||
+			    !walk(ev->body, func, id_func)) {
+				return false;
+			}
+
+			offset += lv2_atom_pad_size(sizeof(LV2_Atom_Event) + ev->body.size);
+		}
+	} else if (atom.type == _atom_Vector) {
+		if (size < sizeof(LV2_Atom_Vector_Body)) {
+			return false;
+		}
+
+		auto* const vec = reinterpret_cast<LV2_Atom_Vector_Body*>(body);
+		func(vec->child_type);
+		if (vec->child_type == _atom_URID &&
+		    vec->child_size == sizeof(uint32_t)) {
+			auto* const children = reinterpret_cast<uint32_t*>(vec + 1);
+			const auto  n_children = static_cast<uint32_t>(
+			    (size - sizeof(LV2_Atom_Vector_Body)) / sizeof(uint32_t));
+			for (uint32_t i = 0U; i < n_children; ++i) {
+				func(children[i]);
+			}
+		}
+	}
+
+	return true;
+}
+
+void
+AtomProtocol::define(const LV2_URID urid)
+{
+	if (!urid || (urid < _sent.size() && _sent[urid])) {
+		return; // Null or already known to peer
+	}
+
+	const char* const uri = _map.unmap_uri(urid);
+	if (!uri) {
+		return; // Not a URI, sent as is
+	}
+
+	if (urid >= _sent.size()) {
+		_sent.resize(urid + 1U);
+	}
+	_sent[urid] = true;
+
+	// Append a definition frame with the URID and null-terminated URI
+	const auto     uri_len = static_cast<uint32_t>(strlen(uri));
+	const LV2_Atom header  = {
+		static_cast<uint32_t>(sizeof(urid) + uri_len + 1U), 0U};
+	const size_t offset = _frames.size();
+	_frames.resize(offset + lv2_atom_pad_size(sizeof(LV2_Atom) + header.size));
+
+	uint8_t* const frame = _frames.data() + offset;
+	memcpy(frame, &header, sizeof(header));
+	memcpy(frame + sizeof(header), &urid, sizeof(urid));
+	memcpy(frame + sizeof(header) + sizeof(urid), uri, uri_len);
+}
+
+const std::vector<uint8_t>&
+AtomProtocol::encode(const LV2_Atom* msg)
+{
+	// Copy message to aligned scratch space, since walk() takes a mutable atom
+	const uint32_t total = lv2_atom_pad_size(lv2_atom_total_size(msg));
+	_message.resize(total / sizeof(uint64_t));
+	memcpy(_message.data(), msg, lv2_atom_total_size(msg));
+
+	// Write definitions of any new URIDs, then the message itself
+	_frames.clear();
+	auto define_urid = [this](const uint32_t& urid) { define(urid); };
+	auto define_id   = [this](uint32_t& id) {
+		if (id && !_map.unmap_uri(id)) {
+			id |= blank_id_flag; // Blank node ID, sent as is
+		} else {
+			define(id);
+		}
+	};
+	walk(*reinterpret_cast<LV2_Atom*>(_message.data()), define_urid, define_id);
+
+	const size_t offset = _frames.size();
+	_frames.resize(offset + total);
+	memcpy(_frames.data() + offset, _message.data(), total);
+	return _frames;
+}
+
+bool
+AtomProtocol::decode(LV2_Atom& frame)
+{
+	if (frame.type == 0U) {
+		// Definition, map URI and record the local URID for the remote one
+		const auto* const body = reinterpret_cast<const char*>(&frame + 1);
+		if (frame.size <= sizeof(uint32_t) || body[frame.size - 1U] != '\0') {
+			return false;
+		}
+
+		uint32_t remote = 0U;
+		memcpy(&remote, body, sizeof(remote));
+		if (!remote || remote > max_remote_urid + _n_remote) {
+			return false;
+		}
+
+		if (remote >= _remote.size()) {
+			_remote.resize(remote + 1U);
+		}
+		_remote[remote] = _map.map_uri(body + sizeof(remote));
+		++_n_remote;
+		return true;
+	}
+
+	// Message, translate URIDs to local ones in place
+	auto to_local = [this](uint32_t& urid) {
+		urid = urid < _remote.size() ? _remote[urid] : 0U;
+	};
+	auto id_to_local = [&to_local](uint32_t& id) {
+		if (id & blank_id_flag) {
+			id &= ~blank_id_flag; // Blank node ID, sent as is
+		} else {
+			to_local(id);
+		}
+	};
+
+	return walk(frame, to_local, id_to_local);
+}
+
+} // namespace ingen
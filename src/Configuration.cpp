@@ -66,12 +66,17 @@ Configuration::Configuration(Forge& forge)
 	static const auto default_n_threads = static_cast<int32_t>(std::max(std::thread::hardware_concurrency(), 1U));
 
 	add("atomicBundles",  "atomic-bundles", 'a', "Execute bundles atomically", GLOBAL, forge.Bool, forge.make(false));
+	add("binary",         "binary",          0,  "Send binary atoms instead of Turtle to the engine", SESSION, forge.Bool, forge.make(false));
 	add("bufferSize",     "buffer-size",    'b', "Buffer size in samples", GLOBAL, forge.Int, forge.make(1024));
+	add("clientOverflow", "client-overflow", 0,  "Action when a client queue is full (block, drop, disconnect)", GLOBAL, forge.String, forge.alloc("block"));
+	add("clientQueue",    "client-queue",    0,  "Maximum number of messages queued for each client", GLOBAL, forge.Int, forge.make(4096));
 	add("clientPort",     "client-port",    'C', "Client port", GLOBAL, forge.Int, Atom());
 	add("connect",        "connect",        'c', "Connect to engine URI", SESSION, forge.String, forge.alloc("unix:///tmp/ingen.sock"));
 	add("engine",         "engine",         'e', "Run (JACK) engine", SESSION, forge.Bool, forge.make(false));
+	add("eventBudget",    "event-budget",    0,  "Percentage of each cycle for executing events", GLOBAL, forge.Int, forge.make(25));
 	add("enginePort",     "engine-port",    'E', "Engine listen port", GLOBAL, forge.Int, forge.make(16180));
 	add("socket",         "socket",         'S', "Engine socket path", GLOBAL, forge.String, forge.alloc("/tmp/ingen.sock"));
+	add("ioThreads",      "io-threads",      0,  "Number of threads reading from and writing to client sockets", GLOBAL, forge.Int, forge.make(2));
 	add("gui",            "gui",            'g', "Launch the GTK graphical interface", SESSION, forge.Bool, forge.make(false));
 	add("",               "help",           'h', "Print this help message", SESSION, forge.Bool, forge.make(false));
 	add("",               "version",        'V', "Print version information", SESSION, forge.Bool, forge.make(false));
@@ -83,7 +88,12 @@ Configuration::Configuration(Forge& forge)
 	add("save",           "save",           'o', "Save graph", SESSION, forge.String, Atom());
 	add("execute",        "execute",        'x', "File of commands to execute", SESSION, forge.String, Atom());
 	add("path",           "path",           'L', "Target path for loaded graph", SESSION, forge.String, Atom());
+	add("pluginCache",    "plugin-cache",    0,  "LV2 plugin discovery cache file (empty to disable)", GLOBAL, forge.String, Atom());
+	add("preProcessThreads", "pre-process-threads", 0, "Number of threads for parallel work at the end of bundles", GLOBAL, forge.Int, forge.make(std::min(default_n_threads, 4)));
 	add("queueSize",      "queue-size",     'q', "Event queue size", GLOBAL, forge.Int, forge.make(4096));
+	add("sampleAccurate", "sample-accurate", 0,  "Execute every queued value change", GLOBAL, forge.Bool, forge.make(false));
+	add("undoSize",       "undo-size",       0,  "Maximum size of undo history in KiB (0 for no limit)", GLOBAL, forge.Int, forge.make(16384));
+	add("undoEntries",    "undo-entries",    0,  "Maximum number of undo steps (0 for no limit)", GLOBAL, forge.Int, forge.make(0));
 	add("flushLog",       "flush-log",      'f', "Flush logs after every entry", GLOBAL, forge.Bool, forge.make(false));
 	add("dump",           "dump",           'd', "Print debug output", SESSION, forge.Bool, forge.make(false));
 	add("trace",          "trace",          't', "Show LV2 plugin trace messages", SESSION, forge.Bool, forge.make(false));
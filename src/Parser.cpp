@@ -44,10 +44,15 @@
 #include <cstring>
 #include <filesystem>
 #include <map>
+#include <memory>
+#include <optional>
 #include <set>
 #include <string>
 #include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
 #define NS_RDF "http://www.w3.org/1999/02/22-rdf-syntax-ns#"
 #define NS_RDFS "http://www.w3.org/2000/01/rdf-schema#"
@@ -100,6 +105,18 @@ get_path(const URI& base, const URI& uri)
 	                                     : std::optional<raul::Path>();
 }
 
+/** Return the path of a graph with an optional parent and symbol. */
+raul::Path
+make_graph_path(const std::optional<raul::Path>&   parent,
+                const std::optional<raul::Symbol>& symbol)
+{
+	if (parent && symbol) {
+		return parent->child(*symbol);
+	}
+
+	return parent ? *parent : raul::Path{"/"};
+}
+
 bool
 skip_property(const ingen::URIs& uris, const Sord::Node& predicate)
 {
@@ -107,6 +124,29 @@ skip_property(const ingen::URIs& uris, const Sord::Node& predicate)
 	        predicate == uris.ingen_block || predicate == uris.lv2_port);
 }
 
+/** Replace any properties in `props` that are given in `data`. */
+void
+replace_data(Properties&                      props,
+             Resource::Graph                  ctx,
+             const std::optional<Properties>& data)
+{
+	if (data) {
+		for (const auto& prop : *data) {
+			if (ctx == Resource::Graph::DEFAULT ||
+			    prop.second.context() == ctx) {
+				props.erase(prop.first);
+			}
+		}
+
+		for (const auto& prop : *data) {
+			if (ctx == Resource::Graph::DEFAULT ||
+			    prop.second.context() == ctx) {
+				props.emplace(prop);
+			}
+		}
+	}
+}
+
 Properties
 get_properties(ingen::World&                    world,
                Sord::Model&                     model,
@@ -132,41 +172,21 @@ get_properties(ingen::World&                    world,
 		}
 	}
 
-	// Replace any properties given in `data`
-	if (data) {
-		for (const auto& prop : *data) {
-			if (ctx == Resource::Graph::DEFAULT ||
-			    prop.second.context() == ctx) {
-				props.erase(prop.first);
-			}
-		}
-
-		for (const auto& prop : *data) {
-			if (ctx == Resource::Graph::DEFAULT ||
-			    prop.second.context() == ctx) {
-				props.emplace(prop);
-			}
-		}
-	}
-
+	replace_data(props, ctx, data);
 	return props;
 }
 
 using PortRecord = std::pair<raul::Path, Properties>;
 
 std::optional<PortRecord>
-get_port(ingen::World&     world,
-         Sord::Model&      model,
-         const Sord::Node& subject,
-         Resource::Graph   ctx,
-         const raul::Path& parent,
-         uint32_t*         index)
+make_port(ingen::World&      world,
+          Properties         props,
+          const std::string& subject,
+          const raul::Path&  parent,
+          uint32_t*          index)
 {
 	const URIs& uris = world.uris();
 
-	// Get all properties
-	Properties props = get_properties(world, model, subject, ctx);
-
 	// Get index if requested (for Graphs)
 	if (index) {
 		const auto i = props.find(uris.lv2_index);
@@ -184,12 +204,11 @@ get_port(ingen::World&     world,
 	if (s != props.end() && s->second.type() == world.forge().String) {
 		sym = s->second.ptr<char>();
 	} else {
-		const std::string subject_str = subject.to_string();
-		const size_t      last_slash  = subject_str.find_last_of('/');
+		const size_t last_slash = subject.find_last_of('/');
 
 		sym = ((last_slash == std::string::npos)
-		           ? subject_str
-		           : subject_str.substr(last_slash + 1));
+		           ? subject
+		           : subject.substr(last_slash + 1));
 	}
 
 	if (!raul::Symbol::is_valid(sym)) {
@@ -204,6 +223,21 @@ get_port(ingen::World&     world,
 	return make_pair(port_path, props);
 }
 
+std::optional<PortRecord>
+get_port(ingen::World&     world,
+         Sord::Model&      model,
+         const Sord::Node& subject,
+         Resource::Graph   ctx,
+         const raul::Path& parent,
+         uint32_t*         index)
+{
+	return make_port(world,
+	                 get_properties(world, model, subject, ctx),
+	                 subject.to_string(),
+	                 parent,
+	                 index);
+}
+
 std::optional<raul::Path>
 parse(World&                             world,
       Interface&                         target,
@@ -353,12 +387,7 @@ parse_graph(ingen::World&                      world,
 	const Sord::Node  nil;
 
 	// Build graph path and symbol
-	raul::Path graph_path{"/"};
-	if (parent && symbol) {
-		graph_path = parent->child(*symbol);
-	} else if (parent) {
-		graph_path = *parent;
-	}
+	const raul::Path graph_path = make_graph_path(parent, symbol);
 
 	// Create graph
 	const Properties props = get_properties(world, model, subject, ctx, data);
@@ -398,17 +427,24 @@ parse_graph(ingen::World&                      world,
 		return {graph_path}; // Not parsing graph internals, finished now
 	}
 
-	// For each block in this graph
-	for (auto n = model.find(subject, ingen_block, nil); !n.end(); ++n) {
-		const Sord::Node node     = n.get_object();
-		const URI        node_uri = node;
+	const auto block_path = [&graph_path](const Sord::Node& node) {
+		const URI node_uri = node;
 		assert(!node_uri.path().empty() && node_uri.path() != "/");
-		const raul::Path block_path = graph_path.child(
+		return graph_path.child(
 		    raul::Symbol(FilePath(node_uri.path()).stem().string()));
+	};
 
-		// Parse and create block
+	/* Create all blocks first, so the engine receives new blocks in a row and
+	   can instantiate them in parallel, then set their port properties. */
+	for (auto n = model.find(subject, ingen_block, nil); !n.end(); ++n) {
+		const Sord::Node node = n.get_object();
 		parse_block(
-		    world, target, model, base_uri, node, block_path, std::nullopt);
+		    world, target, model, base_uri, node, block_path(node), std::nullopt);
+	}
+
+	// For each block in this graph
+	for (auto n = model.find(subject, ingen_block, nil); !n.end(); ++n) {
+		const Sord::Node node = n.get_object();
 
 		// For each port on this block
 		for (auto p = model.find(node, lv2_port, nil); !p.end(); ++p) {
@@ -425,7 +461,7 @@ parse_graph(ingen::World&                      world,
 
 			// Get all properties
 			std::optional<PortRecord> port_record =
-			    get_port(world, model, port, subctx, block_path, nullptr);
+			    get_port(world, model, port, subctx, block_path(node), nullptr);
 			if (!port_record) {
 				world.log().error("Invalid port %1%\n", port);
 				return {};
@@ -518,6 +554,852 @@ parse_arcs(ingen::World&     world,
 	return true;
 }
 
+/** A streaming reader for a graph file, which does not build a model.
+ *
+ * The statements about each subject are collected in a small record, and
+ * messages are sent as soon as what they describe is complete.  A subject is
+ * complete when the reader moves on to another, since Ingen writes files one
+ * subject at a time.  Only blank nodes used as property values, like MIDI
+ * bindings, are put in a model, which is used to forge them as before.
+ *
+ * Sent subjects are erased, leaving a small tombstone with the path they were
+ * sent to, so a subject continued later in the file can still be updated.  A
+ * block is known by its own prototype or type, so it may be sent before the
+ * graph links to it.
+ *
+ * Messages are sent in the same order as parse_graph(): the graph, its ports
+ * by index, all blocks in a row, then block port properties and arcs once
+ * every block has been sent.
+ */
+class GraphStream
+{
+public:
+	GraphStream(ingen::World&                    world,
+	            ingen::Interface&                target,
+	            URI                              base_uri,
+	            raul::Path                       graph_path,
+	            const std::optional<Properties>& data);
+
+	/// Read a graph file and send its contents, return true on success
+	bool read_file(const URI& file_uri);
+
+private:
+	enum class Role { NONE, GRAPH, GRAPH_PORT, BLOCK, BLOCK_PORT, ARC };
+
+	using Blank = std::pair<URI, std::string>;
+
+	struct Subject {
+		Role                      role{Role::NONE};
+		std::string               parent;    ///< Block of a block port
+		Properties                props;     ///< Properties not yet sent
+		std::vector<Blank>        blanks;    ///< Blank values not yet sent
+		std::vector<std::string>  ports;     ///< Ports of a graph or block
+		std::vector<std::string>  blocks;    ///< Blocks of a graph
+		std::vector<std::string>  arcs;      ///< Arcs of a graph
+		std::vector<std::string>  heads;     ///< Heads of an arc
+		std::vector<std::string>  tails;     ///< Tails of an arc
+		std::string               prototype; ///< Prototype of a block
+		std::optional<raul::Path> path;      ///< Path once sent
+		Resource::Graph           ctx{Resource::Graph::DEFAULT};
+		bool                      is_graph{false};
+		bool                      is_block{false};
+		bool                      complete{false};
+		bool                      sent{false};
+	};
+
+	/// What remains of a sent subject once it is erased
+	struct Tombstone {
+		Role                      role;
+		std::string               parent;
+		std::optional<raul::Path> path;
+		Resource::Graph           ctx;
+	};
+
+	static SerdStatus on_base(void* handle, const SerdNode* uri);
+
+	static SerdStatus
+	on_prefix(void* handle, const SerdNode* name, const SerdNode* uri);
+
+	static SerdStatus on_statement(void*              handle,
+	                               SerdStatementFlags flags,
+	                               const SerdNode*    graph,
+	                               const SerdNode*    subject,
+	                               const SerdNode*    predicate,
+	                               const SerdNode*    object,
+	                               const SerdNode*    object_datatype,
+	                               const SerdNode*    object_lang);
+
+	static SerdStatus on_end(void* handle, const SerdNode* node);
+
+	void add_statement(SerdStatementFlags flags,
+	                   const SordNode*    subject,
+	                   const SordNode*    predicate,
+	                   const SordNode*    object);
+
+	bool set_role(const std::string& key, Role role, const std::string& parent);
+	bool revive(const std::string& key);
+	void complete(const std::string& key);
+	void update(const std::string& key);
+	void finish();
+
+	void send_graph();
+	void send_graph_ports();
+	void send_block(const std::string& key);
+	void send_block_port(const std::string& key);
+	void send_arc(const std::string& key);
+	void send_late(Subject& subject);
+	void send_rest();
+
+	void release(const std::string& key);
+	void collect();
+
+	SordModel* blank_model();
+	Atom       read_atom(const SordNode* node, SordModel* model);
+	Properties properties(Subject& subject, Resource::Graph ctx);
+
+	void mark_sent(Subject&                         subject,
+	               const std::optional<raul::Path>& path,
+	               Resource::Graph                  ctx);
+
+	bool blocks_sent() const;
+
+	ingen::World&                            _world;
+	ingen::Interface&                        _target;
+	const URI                                _base_uri;
+	const std::string                        _graph_key;
+	const raul::Path                         _graph_path;
+	const std::optional<Properties>          _data;
+	AtomForge                                _forge;
+	SerdEnv*                                 _env{nullptr};
+	std::unordered_map<std::string, Subject>   _subjects;
+	std::unordered_map<std::string, Tombstone> _erased; ///< Sent and erased
+	std::unique_ptr<Sord::Model>             _blanks;   ///< Blank values
+	std::string                              _current;  ///< Top-level subject
+	std::vector<std::string>                 _anon;     ///< Open anonymous nodes
+	std::vector<std::string>                 _released; ///< Sent, to be erased
+	size_t                                   _n_unsent_blocks{0U};
+	bool                                     _ports_sent{false};
+	bool                                     _failed{false};
+};
+
+std::string
+node_key(const SordNode* node)
+{
+	const auto* const str =
+	    reinterpret_cast<const char*>(sord_node_get_string(node));
+
+	return (sord_node_get_type(node) == SORD_BLANK) ? std::string("_:") + str
+	                                                : std::string(str);
+}
+
+GraphStream::GraphStream(ingen::World&                    world,
+                         ingen::Interface&                target,
+                         URI                              base_uri,
+                         raul::Path                       graph_path,
+                         const std::optional<Properties>& data)
+	: _world(world)
+	, _target(target)
+	, _base_uri(std::move(base_uri))
+	, _graph_key(_base_uri.string())
+	, _graph_path(std::move(graph_path))
+	, _data(data)
+	, _forge(world.uri_map().urid_map())
+{
+	_subjects[_graph_key].role = Role::GRAPH;
+}
+
+bool
+GraphStream::read_file(const URI& file_uri)
+{
+	const SerdNode base = serd_node_from_string(
+	    SERD_URI, reinterpret_cast<const uint8_t*>(_base_uri.c_str()));
+
+	_env = serd_env_new(&base);
+
+	SerdReader* const reader = serd_reader_new(SERD_TURTLE,
+	                                           this,
+	                                           nullptr,
+	                                           on_base,
+	                                           on_prefix,
+	                                           on_statement,
+	                                           on_end);
+
+	const SerdStatus st = serd_reader_read_file(
+	    reader, reinterpret_cast<const uint8_t*>(file_uri.c_str()));
+
+	serd_reader_free(reader);
+	serd_env_free(_env);
+	_env = nullptr;
+
+	if (st) {
+		_world.log().error("Error reading %1% (%2%)\n",
+		                   file_uri,
+		                   reinterpret_cast<const char*>(serd_strerror(st)));
+	}
+
+	finish();
+
+	return !_failed && _subjects[_graph_key].sent;
+}
+
+SerdStatus
+GraphStream::on_base(void* handle, const SerdNode* uri)
+{
+	return serd_env_set_base_uri(static_cast<GraphStream*>(handle)->_env, uri);
+}
+
+SerdStatus
+GraphStream::on_prefix(void* handle, const SerdNode* name, const SerdNode* uri)
+{
+	return serd_env_set_prefix(
+	    static_cast<GraphStream*>(handle)->_env, name, uri);
+}
+
+SerdStatus
+GraphStream::on_statement(void*              handle,
+                          SerdStatementFlags flags,
+                          const SerdNode*,
+                          const SerdNode* subject,
+                          const SerdNode* predicate,
+                          const SerdNode* object,
+                          const SerdNode* object_datatype,
+                          const SerdNode* object_lang)
+{
+	auto* const      self  = static_cast<GraphStream*>(handle);
+	SordWorld* const world = self->_world.rdf_world()->c_obj();
+
+	SordNode* const s =
+	    sord_node_from_serd_node(world, self->_env, subject, nullptr, nullptr);
+	SordNode* const p =
+	    sord_node_from_serd_node(world, self->_env, predicate, nullptr, nullptr);
+	SordNode* const o = sord_node_from_serd_node(
+	    world, self->_env, object, object_datatype, object_lang);
+
+	SerdStatus st = SERD_SUCCESS;
+	if (s && p && o) {
+		self->add_statement(flags, s, p, o);
+		self->collect();
+	} else {
+		st = SERD_ERR_BAD_CURIE;
+	}
+
+	sord_node_free(world, o);
+	sord_node_free(world, p);
+	sord_node_free(world, s);
+	return st;
+}
+
+SerdStatus
+GraphStream::on_end(void* handle, const SerdNode* node)
+{
+	auto* const       self = static_cast<GraphStream*>(handle);
+	const std::string key =
+	    std::string("_:") + reinterpret_cast<const char*>(node->buf);
+
+	if (!self->_anon.empty() && self->_anon.back() == key) {
+		self->_anon.pop_back();
+		if (self->_subjects.count(key)) {
+			self->complete(key); // Arc, blank values are not subjects
+			self->collect();
+		}
+	}
+
+	return SERD_SUCCESS;
+}
+
+void
+GraphStream::add_statement(SerdStatementFlags flags,
+                           const SordNode*    subject,
+                           const SordNode*    predicate,
+                           const SordNode*    object)
+{
+	const URIs&       uris = _world.uris();
+	const std::string key  = node_key(subject);
+	const std::string okey = node_key(object);
+	const URI         pred(
+	    reinterpret_cast<const char*>(sord_node_get_string(predicate)));
+
+	// Top-level subjects are complete when the next one starts
+	if (_anon.empty() && key != _current) {
+		if (!_current.empty()) {
+			complete(_current);
+		}
+		_current = key;
+	}
+
+	if (flags & SERD_ANON_S_BEGIN) {
+		_anon.push_back(key);
+	}
+
+	if (flags & SERD_ANON_O_BEGIN) {
+		_anon.push_back(okey);
+	}
+
+	if (sord_node_get_type(subject) == SORD_BLANK && pred != uris.ingen_head &&
+	    pred != uris.ingen_tail) {
+		// Part of a blank value, forged later from the model
+		const SordQuad quad = {subject, predicate, object, nullptr};
+		sord_add(blank_model(), quad);
+		return;
+	}
+
+	if (!revive(key)) {
+		return;
+	}
+
+	Subject& rec = _subjects[key];
+	rec.complete = false; // May continue a subject that was complete
+
+	if (pred == uris.ingen_head) {
+		rec.heads.push_back(okey);
+	} else if (pred == uris.ingen_tail) {
+		rec.tails.push_back(okey);
+	} else if (pred == uris.ingen_block) {
+		if (key == _graph_key && set_role(okey, Role::BLOCK, key)) {
+			rec.blocks.push_back(okey);
+		}
+	} else if (pred == uris.lv2_port) {
+		const Role role =
+		    (key == _graph_key) ? Role::GRAPH_PORT : Role::BLOCK_PORT;
+		if (set_role(okey, role, key)) {
+			rec.ports.push_back(okey);
+		}
+	} else if (pred == uris.ingen_arc) {
+		if (key == _graph_key && set_role(okey, Role::ARC, key)) {
+			rec.arcs.push_back(okey);
+		}
+	} else if (pred != INGEN__file) {
+		if (sord_node_get_type(object) == SORD_BLANK) {
+			rec.blanks.emplace_back(pred, okey);
+		} else {
+			rec.props.emplace(pred, read_atom(object, nullptr));
+		}
+
+		if (pred == uris.rdf_type && okey == INGEN__Graph) {
+			rec.is_graph = true;
+		} else if (pred == uris.rdf_type && okey == INGEN__Block) {
+			rec.is_block = true;
+		} else if (pred == uris.lv2_prototype ||
+		           (pred == uris.ingen_prototype && rec.prototype.empty())) {
+			rec.prototype = okey;
+		}
+	}
+}
+
+/** Set the role of a subject, return false if it already has one. */
+bool
+GraphStream::set_role(const std::string& key,
+                      Role               role,
+                      const std::string& parent)
+{
+	if (_erased.count(key)) {
+		return false;
+	}
+
+	Subject& rec = _subjects[key];
+	if (rec.role != Role::NONE) {
+		return false;
+	}
+
+	rec.role   = role;
+	rec.parent = parent;
+	if (role == Role::BLOCK) {
+		++_n_unsent_blocks;
+	}
+
+	update(key);
+	return true;
+}
+
+/** Restore an erased subject, return false if statements about it are lost.
+ *
+ * A subject that was sent to a path is restored as sent, so anything more
+ * about it is sent by send_late() when it is complete again.
+ */
+bool
+GraphStream::revive(const std::string& key)
+{
+	const auto e = _erased.find(key);
+	if (e == _erased.end()) {
+		return true;
+	}
+
+	if (!e->second.path) {
+		_world.log().error("Ignored statement about %1% after it was sent\n",
+		                   key);
+		return false;
+	}
+
+	Subject& rec = _subjects[key];
+	rec.role     = e->second.role;
+	rec.parent   = e->second.parent;
+	rec.path     = e->second.path;
+	rec.ctx      = e->second.ctx;
+	rec.sent     = true;
+	_erased.erase(e);
+	return true;
+}
+
+void
+GraphStream::complete(const std::string& key)
+{
+	const auto s = _subjects.find(key);
+	if (s != _subjects.end() && !s->second.complete) {
+		s->second.complete = true;
+		update(key);
+	}
+}
+
+void
+GraphStream::update(const std::string& key)
+{
+	Subject& rec = _subjects[key];
+	if (!rec.complete || _failed) {
+		return;
+	}
+
+	if (rec.sent) {
+		send_late(rec);
+		if (rec.role == Role::GRAPH) {
+			send_graph_ports(); // Send anything added by the continuation
+			send_rest();
+		} else if (rec.ports.empty()) {
+			release(key); // Erase a revived subject again
+		}
+		return;
+	}
+
+	if (rec.role == Role::NONE && (rec.is_block || !rec.prototype.empty())) {
+		// A block, which the graph may not have linked to yet
+		Subject& graph = _subjects[_graph_key];
+		rec.role       = Role::BLOCK;
+		rec.parent     = _graph_key;
+		graph.blocks.push_back(key);
+		++_n_unsent_blocks;
+	}
+
+	switch (rec.role) {
+	case Role::NONE:
+		break; // Not (yet) known to be a part of the graph
+	case Role::GRAPH:
+		send_graph();
+		break;
+	case Role::GRAPH_PORT:
+		send_graph_ports();
+		break;
+	case Role::BLOCK:
+		if (_ports_sent) {
+			send_block(key);
+		}
+		break;
+	case Role::BLOCK_PORT:
+		if (blocks_sent() && _subjects[rec.parent].path) {
+			send_block_port(key);
+		}
+		break;
+	case Role::ARC:
+		if (blocks_sent()) {
+			send_arc(key);
+		}
+		break;
+	}
+}
+
+/** Complete everything the file refers to but did not describe. */
+void
+GraphStream::finish()
+{
+	_anon.clear();
+
+	if (!_current.empty()) {
+		complete(_current);
+	}
+
+	const Subject& graph = _subjects[_graph_key];
+	for (const auto* keys : {&graph.ports, &graph.blocks}) {
+		for (size_t i = 0U; i < keys->size(); ++i) {
+			complete((*keys)[i]);
+		}
+	}
+
+	for (const auto& b : graph.blocks) {
+		for (const auto& p : _subjects[b].ports) {
+			complete(p);
+		}
+	}
+
+	for (const auto& a : graph.arcs) {
+		complete(a);
+	}
+
+	collect();
+}
+
+void
+GraphStream::send_graph()
+{
+	Subject&   graph = _subjects[_graph_key];
+	Properties props = properties(graph, Resource::Graph::INTERNAL);
+	replace_data(props, Resource::Graph::INTERNAL, _data);
+
+	_target.put(path_to_uri(_graph_path), props, Resource::Graph::INTERNAL);
+	mark_sent(graph, _graph_path, Resource::Graph::INTERNAL);
+	send_graph_ports();
+}
+
+void
+GraphStream::send_graph_ports()
+{
+	const Subject& graph = _subjects[_graph_key];
+	if (!graph.sent) {
+		return;
+	}
+
+	// Wait until every port is complete, so they can be sent by index
+	for (const auto& key : graph.ports) {
+		const Subject& port = _subjects[key];
+		if (!port.sent && !port.complete) {
+			return;
+		}
+	}
+
+	using PortRecords = std::map<uint32_t, std::pair<Subject*, PortRecord>>;
+	PortRecords ports;
+	for (const auto& key : graph.ports) {
+		Subject& port = _subjects[key];
+		if (port.sent) {
+			continue;
+		}
+
+		// Get all properties
+		uint32_t                  index = 0;
+		std::optional<PortRecord> port_record =
+		    make_port(_world,
+		              properties(port, Resource::Graph::INTERNAL),
+		              key,
+		              _graph_path,
+		              &index);
+		if (!port_record) {
+			_world.log().error("Invalid port %1%\n", key);
+			_failed = true;
+			return;
+		}
+
+		// Store port information in ports map
+		if (ports.find(index) == ports.end()) {
+			ports.emplace(index, std::make_pair(&port, *port_record));
+		} else {
+			_world.log().error("Ignored port %1% with duplicate index %2%\n",
+			                   key,
+			                   index);
+			mark_sent(port, std::nullopt, Resource::Graph::INTERNAL);
+			release(key);
+		}
+	}
+
+	// Create ports in order by index
+	for (const auto& p : ports) {
+		const PortRecord& record = p.second.second;
+		_target.put(path_to_uri(record.first),
+		            record.second,
+		            Resource::Graph::INTERNAL);
+		mark_sent(*p.second.first, record.first, Resource::Graph::INTERNAL);
+	}
+
+	for (const auto& key : graph.ports) {
+		if (_subjects[key].sent) {
+			release(key);
+		}
+	}
+
+	if (!_ports_sent) {
+		// Now send any blocks that were waiting for the ports
+		_ports_sent = true;
+		for (size_t i = 0U; i < graph.blocks.size(); ++i) {
+			update(graph.blocks[i]);
+		}
+		send_rest();
+	}
+}
+
+void
+GraphStream::send_block(const std::string& key)
+{
+	const URIs& uris  = _world.uris();
+	Subject&    block = _subjects[key];
+
+	const URI block_uri{key};
+	assert(!block_uri.path().empty() && block_uri.path() != "/");
+	const raul::Path path = _graph_path.child(
+	    raul::Symbol(FilePath(block_uri.path()).stem().string()));
+
+	const auto* type_uri =
+	    reinterpret_cast<const uint8_t*>(block.prototype.c_str());
+
+	if (block.prototype.empty()) {
+		_world.log().error("Block %1% (%2%) missing mandatory lv2:prototype\n",
+		                   key,
+		                   path);
+		mark_sent(block, path, Resource::Graph::DEFAULT);
+	} else if (!serd_uri_string_has_scheme(type_uri) ||
+	           !strncmp(reinterpret_cast<const char*>(type_uri), "file:", 5)) {
+		// Prototype is a file, subgraph
+		SerdURI base_uri_parts;
+		serd_uri_parse(reinterpret_cast<const uint8_t*>(_base_uri.c_str()),
+		               &base_uri_parts);
+
+		SerdURI  ignored;
+		SerdNode sub_uri =
+		    serd_node_new_uri_from_string(type_uri, &base_uri_parts, &ignored);
+
+		const std::string sub_uri_str =
+		    reinterpret_cast<const char*>(sub_uri.buf);
+		const URI sub_file{sub_uri_str + "/main.ttl"};
+		serd_node_free(&sub_uri);
+
+		GraphStream sub{_world, _target, sub_file, path, std::nullopt};
+		sub.read_file(sub_file);
+
+		_target.put(path_to_uri(path),
+		            properties(block, Resource::Graph::EXTERNAL),
+		            Resource::Graph::EXTERNAL);
+		mark_sent(block, path, Resource::Graph::EXTERNAL);
+	} else {
+		// Prototype is non-file URI, plugin
+		Properties props = properties(block, Resource::Graph::DEFAULT);
+		props.emplace(uris.rdf_type, uris.forge.make_urid(uris.ingen_Block));
+		_target.put(path_to_uri(path), props);
+		mark_sent(block, path, Resource::Graph::DEFAULT);
+	}
+
+	if (block.ports.empty()) {
+		release(key);
+	}
+
+	--_n_unsent_blocks;
+	send_rest();
+}
+
+void
+GraphStream::send_block_port(const std::string& key)
+{
+	Subject&       port  = _subjects[key];
+	const Subject& block = _subjects[port.parent];
+
+	const Resource::Graph ctx =
+	    block.is_graph ? Resource::Graph::EXTERNAL : Resource::Graph::DEFAULT;
+
+	// Get all properties
+	std::optional<PortRecord> port_record =
+	    make_port(_world, properties(port, ctx), key, *block.path, nullptr);
+	if (!port_record) {
+		_world.log().error("Invalid port %1%\n", key);
+		_failed = true;
+		return;
+	}
+
+	// Create port and/or set all port properties
+	_target.put(path_to_uri(port_record->first), port_record->second, ctx);
+	mark_sent(port, port_record->first, ctx);
+	release(key);
+}
+
+void
+GraphStream::send_arc(const std::string& key)
+{
+	Subject& arc = _subjects[key];
+	mark_sent(arc, std::nullopt, Resource::Graph::DEFAULT);
+	release(key);
+
+	if (arc.tails.empty()) {
+		_world.log().error("Arc has no tail\n");
+		return;
+	}
+
+	if (arc.heads.empty()) {
+		_world.log().error("Arc has no head\n");
+		return;
+	}
+
+	const std::optional<raul::Path> tail_path =
+	    get_path(_base_uri, URI(arc.tails.front()));
+	if (!tail_path) {
+		_world.log().error("Arc tail has invalid URI\n");
+		return;
+	}
+
+	const std::optional<raul::Path> head_path =
+	    get_path(_base_uri, URI(arc.heads.front()));
+	if (!head_path) {
+		_world.log().error("Arc head has invalid URI\n");
+		return;
+	}
+
+	if (arc.tails.size() > 1) {
+		_world.log().error("Arc has multiple tails\n");
+		return;
+	}
+
+	if (arc.heads.size() > 1) {
+		_world.log().error("Arc has multiple heads\n");
+		return;
+	}
+
+	_target.connect(_graph_path.child(*tail_path),
+	                _graph_path.child(*head_path));
+}
+
+/** Send properties of an already sent subject that were described later. */
+void
+GraphStream::send_late(Subject& subject)
+{
+	if (subject.path && (!subject.props.empty() || !subject.blanks.empty())) {
+		_target.delta(path_to_uri(*subject.path),
+		              {},
+		              properties(subject, subject.ctx),
+		              subject.ctx);
+	}
+
+	subject.props.clear();
+	subject.blanks.clear();
+}
+
+/** Send complete block ports and arcs once all blocks have been sent. */
+void
+GraphStream::send_rest()
+{
+	if (!blocks_sent()) {
+		return;
+	}
+
+	const Subject& graph = _subjects[_graph_key];
+	for (const auto& b : graph.blocks) {
+		const Subject& block = _subjects[b];
+		for (size_t i = 0U; i < block.ports.size(); ++i) {
+			update(block.ports[i]);
+		}
+	}
+
+	for (size_t i = 0U; i < graph.arcs.size(); ++i) {
+		update(graph.arcs[i]);
+	}
+}
+
+/** Erase a sent subject at the next collect(). */
+void
+GraphStream::release(const std::string& key)
+{
+	_released.push_back(key);
+}
+
+/** Erase released subjects, and blocks whose ports have all been erased. */
+void
+GraphStream::collect()
+{
+	while (!_released.empty()) {
+		const std::unordered_set<std::string> keys(_released.begin(),
+		                                           _released.end());
+		_released.clear();
+
+		std::set<std::string> parents;
+		for (const auto& key : keys) {
+			const auto s = _subjects.find(key);
+			if (s != _subjects.end()) {
+				const Subject& rec = s->second;
+				parents.insert(rec.parent);
+				_erased[key] = {rec.role, rec.parent, rec.path, rec.ctx};
+				_subjects.erase(s);
+			}
+		}
+
+		const auto is_released = [&keys](const std::string& key) {
+			return keys.count(key) > 0;
+		};
+
+		for (const auto& p : parents) {
+			const auto s = _subjects.find(p);
+			if (s == _subjects.end()) {
+				continue; // Parent was erased first, a revived subject
+			}
+
+			Subject& parent = s->second;
+			for (auto* list : {&parent.ports, &parent.blocks, &parent.arcs}) {
+				list->erase(
+				    std::remove_if(list->begin(), list->end(), is_released),
+				    list->end());
+			}
+
+			if (parent.role == Role::BLOCK && parent.sent &&
+			    parent.ports.empty()) {
+				release(p);
+			}
+		}
+	}
+}
+
+bool
+GraphStream::blocks_sent() const
+{
+	const auto g = _subjects.find(_graph_key);
+	return _ports_sent && g->second.complete && !_n_unsent_blocks;
+}
+
+SordModel*
+GraphStream::blank_model()
+{
+	if (!_blanks) {
+		_blanks = std::make_unique<Sord::Model>(
+		    *_world.rdf_world(), _base_uri.string(), SORD_SPO, false);
+	}
+
+	return _blanks->c_obj();
+}
+
+Atom
+GraphStream::read_atom(const SordNode* node, SordModel* model)
+{
+	_forge.clear();
+	_forge.read(*_world.rdf_world(), model, node);
+
+	const LV2_Atom* atom = _forge.atom();
+	return Forge::alloc(atom->size, atom->type, LV2_ATOM_BODY_CONST(atom));
+}
+
+Properties
+GraphStream::properties(Subject& subject, Resource::Graph ctx)
+{
+	Properties props;
+	for (const auto& p : subject.props) {
+		props.emplace(p.first, Property(p.second, ctx));
+	}
+
+	SordWorld* const world = _world.rdf_world()->c_obj();
+	for (const auto& b : subject.blanks) {
+		const std::string id   = b.second.substr(2);
+		SordNode* const   node = sord_new_blank(
+		    world, reinterpret_cast<const uint8_t*>(id.c_str()));
+
+		props.emplace(b.first, Property(read_atom(node, blank_model()), ctx));
+		sord_node_free(world, node);
+	}
+
+	return props;
+}
+
+void
+GraphStream::mark_sent(Subject&                         subject,
+                       const std::optional<raul::Path>& path,
+                       Resource::Graph                  ctx)
+{
+	subject.sent = true;
+	subject.path = path;
+	subject.ctx  = ctx;
+
+	// Free properties, which are not needed any more
+	subject.props.clear();
+	subject.blanks.clear();
+}
+
 std::optional<raul::Path>
 parse(ingen::World&                      world,
       ingen::Interface&                  target,
@@ -662,20 +1544,6 @@ Parser::parse_file(ingen::World&                      world,
 		file_path = manifest_path;
 	}
 
-	// Initialise parsing environment
-	const URI      file_uri  = URI(file_path);
-	const auto*    uri_c_str = reinterpret_cast<const uint8_t*>(uri.c_str());
-	const SerdNode base_node = serd_node_from_string(SERD_URI, uri_c_str);
-	SerdEnv*       env       = serd_env_new(&base_node);
-
-	// Load graph into model
-	Sord::Model model(*world.rdf_world(),
-	                  uri.string(),
-	                  SORD_SPO | SORD_PSO,
-	                  false);
-	model.load_file(env, SERD_TURTLE, file_uri);
-	serd_env_free(env);
-
 	world.log().info("Loading %1% from %2%\n", uri, file_path);
 	if (parent) {
 		world.log().info("Parent: %1%\n", parent->c_str());
@@ -684,14 +1552,28 @@ Parser::parse_file(ingen::World&                      world,
 		world.log().info("Symbol: %1%\n", symbol->c_str());
 	}
 
-	Sord::Node subject(*world.rdf_world(), Sord::Node::URI, uri.string());
-	std::optional<raul::Path> parsed_path = parse(
-	    world, target, model, model.base_uri(), subject, parent, symbol, data);
+	/* Send everything as one bundle, so the engine can treat the load as a
+	   single transaction and compile each graph once at the end. */
+	target.bundle_begin();
+
+	// Stream the graph from the file rather than loading it into a model
+	const raul::Path graph_path = make_graph_path(parent, symbol);
+	GraphStream      stream{world, target, uri, graph_path, data};
+
+	std::optional<raul::Path> parsed_path;
+	if (stream.read_file(URI(file_path))) {
+		parsed_path = graph_path;
+	}
 
 	if (parsed_path) {
 		target.set_property(path_to_uri(*parsed_path),
 		                    URI(INGEN__file),
 		                    world.forge().alloc_uri(uri.string()));
+	}
+
+	target.bundle_end();
+
+	if (parsed_path) {
 		return true;
 	}
 
@@ -727,7 +1609,9 @@ Parser::parse_string(ingen::World&                      world,
 	world.log().info("Parsing string (base %1%)\n", base_uri);
 
 	Sord::Node subject;
+	target.bundle_begin();
 	parse(world, target, model, actual_base, subject, parent, symbol, data);
+	target.bundle_end();
 	return {actual_base};
 }
 
@@ -0,0 +1,107 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2017 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ingen/ShmReader.hpp>
+
+#include <ingen/AtomProtocol.hpp>
+#include <ingen/AtomReader.hpp>
+#include <ingen/Log.hpp>
+#include <ingen/ShmTransport.hpp>
+#include <ingen/URIMap.hpp>
+#include <ingen/World.hpp>
+#include <lv2/atom/atom.h>
+#include <raul/Socket.hpp>
+
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+namespace ingen {
+
+ShmReader::ShmReader(World&                        world,
+                     Interface&                    iface,
+                     std::shared_ptr<ShmSession>   session,
+                     ShmRing&                      ring,
+                     std::shared_ptr<raul::Socket> sock,
+                     HangupHandler                 on_hangup)
+	: _world(world)
+	, _iface(iface)
+	, _session(std::move(session))
+	, _ring(ring)
+	, _socket(std::move(sock))
+	, _on_hangup(std::move(on_hangup))
+	, _thread(&ShmReader::run, this)
+{}
+
+ShmReader::~ShmReader()
+{
+	_exit_flag = true;
+	_socket->shutdown();
+	_thread.join();
+}
+
+void
+ShmReader::run()
+{
+	AtomProtocol protocol{_world.uri_map()};
+	AtomReader   ar(_world.uri_map(), _world.uris(), _world.log(), _iface);
+
+	// Frame buffer, 64-bit aligned like atoms in memory
+	std::vector<uint64_t> buf(1U);
+
+	while (!_exit_flag) {
+		while (LV2_Atom* const frame = _ring.read(buf)) {
+			if (!protocol.decode(*frame)) {
+				_world.log().error("Malformed message\n");
+			} else if (frame->type) {
+				// Call _iface methods based on atom content
+				ar.write(frame);
+			}
+		}
+
+		if (!_ring.sleep()) {
+			continue; // More arrived while announcing sleep
+		}
+
+		// Wait for a wakeup, and drain it since it carries no data
+		struct pollfd pfd{};
+		pfd.fd     = _socket->fd();
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+
+		char          wakeups[64];
+		const ssize_t ret = recv(_socket->fd(), wakeups, sizeof(wakeups), 0);
+		if (ret == 0 || (ret < 0 && errno != EINTR)) {
+			break; // Hangup
+		}
+	}
+
+	if (!_exit_flag && _on_hangup) {
+		_on_hangup();
+	}
+}
+
+} // namespace ingen
@@ -0,0 +1,486 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2017 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ingen/ShmTransport.hpp>
+
+#include <lv2/atom/atom.h>
+#include <lv2/atom/util.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace ingen {
+namespace {
+
+/// Header at the start of shared regions, to check what a descriptor is
+struct RegionHeader {
+	char     magic[8];
+	uint32_t version;
+	uint32_t capacity;
+};
+
+constexpr char     session_magic[8] = {'i', 'n', 'g', 'e', 'n', 'S', 'S', '\0'};
+constexpr char     values_magic[8]  = {'i', 'n', 'g', 'e', 'n', 'S', 'V', '\0'};
+constexpr uint32_t shm_version      = 1U;
+
+/// Maximum number of entries probed for a key, which bounds realtime writes
+constexpr uint32_t max_probes = 32U;
+
+/// Maximum number of attempts to read a value that is being written
+constexpr uint32_t max_read_attempts = 1024U;
+
+/// Maximum number of descriptors passed in a single message
+constexpr size_t max_fds = 4U;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(std::atomic<float>::is_always_lock_free);
+
+/// Round `size` up to a multiple of the cache line size
+constexpr size_t
+align(const size_t size)
+{
+	return (size + 63U) & ~size_t{63U};
+}
+
+void
+init_header(ShmRegion& region, const char* magic, const uint32_t capacity)
+{
+	auto* const header = new (region.data()) RegionHeader{};
+	memcpy(header->magic, magic, sizeof(header->magic));
+	header->version  = shm_version;
+	header->capacity = capacity;
+}
+
+bool
+check_header(const ShmRegion& region, const char* magic, uint32_t& capacity)
+{
+	if (region.size() < align(sizeof(RegionHeader))) {
+		return false;
+	}
+
+	const auto* const header = static_cast<const RegionHeader*>(region.data());
+	capacity                 = header->capacity;
+	return !memcmp(header->magic, magic, sizeof(header->magic)) &&
+	       header->version == shm_version;
+}
+
+size_t
+session_size()
+{
+	return align(sizeof(RegionHeader)) +
+	       2U * align(ShmRing::memory_size(ShmSession::ring_capacity));
+}
+
+void*
+ring_memory(const ShmRegion& region, const unsigned index)
+{
+	return static_cast<uint8_t*>(region.data()) + align(sizeof(RegionHeader)) +
+	       index * align(ShmRing::memory_size(ShmSession::ring_capacity));
+}
+
+/// Control message buffer, aligned for the headers in it
+union ControlBuffer {
+	char    buf[CMSG_SPACE(max_fds * sizeof(int))];
+	cmsghdr align;
+};
+
+} // namespace
+
+std::unique_ptr<ShmRegion>
+ShmRegion::create(const char* const name, const size_t size)
+{
+	const int fd = memfd_create(name, MFD_CLOEXEC);
+	if (fd < 0) {
+		return nullptr;
+	}
+
+	if (ftruncate(fd, static_cast<off_t>(size))) {
+		close(fd);
+		return nullptr;
+	}
+
+	void* const data =
+	    mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED) {
+		close(fd);
+		return nullptr;
+	}
+
+	return std::unique_ptr<ShmRegion>{new ShmRegion(fd, data, size)};
+}
+
+std::unique_ptr<ShmRegion>
+ShmRegion::attach(const int fd, const bool writable)
+{
+	struct stat st{};
+	if (fstat(fd, &st) || st.st_size <= 0) {
+		close(fd);
+		return nullptr;
+	}
+
+	const auto  size = static_cast<size_t>(st.st_size);
+	void* const data = mmap(nullptr,
+	                        size,
+	                        writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+	                        MAP_SHARED,
+	                        fd,
+	                        0);
+	if (data == MAP_FAILED) {
+		close(fd);
+		return nullptr;
+	}
+
+	return std::unique_ptr<ShmRegion>{new ShmRegion(fd, data, size)};
+}
+
+ShmRegion::~ShmRegion()
+{
+	munmap(_data, _size);
+	close(_fd);
+}
+
+size_t
+ShmRing::memory_size(const uint32_t capacity)
+{
+	return sizeof(Header) + capacity;
+}
+
+ShmRing::ShmRing(void* const mem, const uint32_t capacity, const bool init)
+	: _header(static_cast<Header*>(mem))
+	, _data(static_cast<uint8_t*>(mem) + sizeof(Header))
+	, _capacity(capacity)
+{
+	assert(!(capacity & (capacity - 1U)));
+
+	if (init) {
+		_header = new (mem) Header{};
+
+		// The reader waits for a wakeup until the first write
+		_header->sleeping.store(1U);
+	}
+}
+
+bool
+ShmRing::write(const void* const buf, const uint32_t size)
+{
+	const uint32_t w = _header->write_head.load(std::memory_order_relaxed);
+	const uint32_t r = _header->read_head.load(std::memory_order_acquire);
+	if (_capacity - (w - r) < size) {
+		return false;
+	}
+
+	const uint32_t offset = w & (_capacity - 1U);
+	const uint32_t first  = std::min(size, _capacity - offset);
+	memcpy(_data + offset, buf, first);
+	memcpy(_data, static_cast<const uint8_t*>(buf) + first, size - first);
+
+	// Sequentially consistent, so either this or sleep() sees the other
+	_header->write_head.store(w + size);
+	return true;
+}
+
+LV2_Atom*
+ShmRing::read(std::vector<uint64_t>& buf)
+{
+	const uint32_t r     = _header->read_head.load(std::memory_order_relaxed);
+	const uint32_t w     = _header->write_head.load(std::memory_order_acquire);
+	const uint32_t space = w - r;
+	if (space < sizeof(LV2_Atom)) {
+		return nullptr;
+	}
+
+	LV2_Atom header{0U, 0U};
+	copy_out(r, &header, sizeof(header));
+
+	const uint32_t body_size =
+	    header.size < _capacity ? lv2_atom_pad_size(header.size) : _capacity;
+
+	const uint32_t frame_size = sizeof(LV2_Atom) + body_size;
+	if (frame_size > space) {
+		// Writers only write whole frames, so the ring is corrupt
+		_header->read_head.store(w, std::memory_order_release);
+		return nullptr;
+	}
+
+	buf.resize(1U + body_size / sizeof(uint64_t));
+	copy_out(r, buf.data(), frame_size);
+	_header->read_head.store(r + frame_size, std::memory_order_release);
+
+	return reinterpret_cast<LV2_Atom*>(buf.data());
+}
+
+bool
+ShmRing::sleep()
+{
+	_header->sleeping.store(1U);
+	if (_header->write_head.load() !=
+	    _header->read_head.load(std::memory_order_relaxed)) {
+		_header->sleeping.store(0U);
+		return false;
+	}
+
+	return true;
+}
+
+bool
+ShmRing::wake()
+{
+	return _header->sleeping.exchange(0U);
+}
+
+void
+ShmRing::copy_out(const uint32_t head, void* const buf, const uint32_t size) const
+{
+	const uint32_t offset = head & (_capacity - 1U);
+	const uint32_t first  = std::min(size, _capacity - offset);
+	memcpy(buf, _data + offset, first);
+	memcpy(static_cast<uint8_t*>(buf) + first, _data, size - first);
+}
+
+ShmSession::ShmSession(std::unique_ptr<ShmRegion> region, const bool init)
+	: _region(std::move(region))
+	, _to_engine(ring_memory(*_region, 0U), ring_capacity, init)
+	, _to_client(ring_memory(*_region, 1U), ring_capacity, init)
+{}
+
+std::unique_ptr<ShmSession>
+ShmSession::create()
+{
+	auto region = ShmRegion::create("ingen-session", session_size());
+	if (!region) {
+		return nullptr;
+	}
+
+	init_header(*region, session_magic, ring_capacity);
+	return std::unique_ptr<ShmSession>{new ShmSession(std::move(region), true)};
+}
+
+std::unique_ptr<ShmSession>
+ShmSession::attach(const int fd)
+{
+	auto     region   = ShmRegion::attach(fd, true);
+	uint32_t capacity = 0U;
+	if (!region || region->size() < session_size() ||
+	    !check_header(*region, session_magic, capacity) ||
+	    capacity != ring_capacity) {
+		return nullptr;
+	}
+
+	return std::unique_ptr<ShmSession>{new ShmSession(std::move(region), false)};
+}
+
+ShmValues::ShmValues(std::unique_ptr<ShmRegion> region, const uint32_t capacity)
+	: _region(std::move(region))
+	, _entries(reinterpret_cast<Entry*>(static_cast<uint8_t*>(_region->data()) +
+	                                    align(sizeof(RegionHeader))))
+	, _capacity(capacity)
+{}
+
+std::unique_ptr<ShmValues>
+ShmValues::create(const uint32_t capacity)
+{
+	// Use a power of two, so probing can wrap around with a mask
+	uint32_t size = 1U;
+	while (size < capacity) {
+		size <<= 1U;
+	}
+
+	auto region = ShmRegion::create(
+		"ingen-values", align(sizeof(RegionHeader)) + size * sizeof(Entry));
+	if (!region) {
+		return nullptr;
+	}
+
+	init_header(*region, values_magic, size);
+
+	auto* const entries = reinterpret_cast<Entry*>(
+		static_cast<uint8_t*>(region->data()) + align(sizeof(RegionHeader)));
+	for (uint32_t i = 0U; i < size; ++i) {
+		new (&entries[i]) Entry{};
+	}
+
+	return std::unique_ptr<ShmValues>{new ShmValues(std::move(region), size)};
+}
+
+std::unique_ptr<ShmValues>
+ShmValues::attach(const int fd)
+{
+	auto     region   = ShmRegion::attach(fd, false);
+	uint32_t capacity = 0U;
+	if (!region || !check_header(*region, values_magic, capacity) ||
+	    !capacity || (capacity & (capacity - 1U)) ||
+	    region->size() <
+	        align(sizeof(RegionHeader)) + size_t{capacity} * sizeof(Entry)) {
+		return nullptr;
+	}
+
+	return std::unique_ptr<ShmValues>{new ShmValues(std::move(region), capacity)};
+}
+
+ShmValues::Entry*
+ShmValues::find(const uint64_t key, const bool insert) const
+{
+	const uint32_t mask     = _capacity - 1U;
+	const uint32_t n_probes = std::min(max_probes, _capacity);
+	for (uint32_t i = 0U; i < n_probes; ++i) {
+		Entry&   entry     = _entries[(key + i) & mask];
+		uint64_t entry_key = entry.key.load(std::memory_order_acquire);
+		if (!entry_key) {
+			if (!insert) {
+				return nullptr;
+			}
+
+			if (entry.key.compare_exchange_strong(entry_key, key)) {
+				return &entry;
+			}
+		}
+
+		if (entry_key == key) {
+			return &entry;
+		}
+	}
+
+	return nullptr; // Table is full around this key
+}
+
+void
+ShmValues::write(const uint64_t key, const float value, const bool is_peak)
+{
+	Entry* const entry = find(key, true);
+	if (!entry) {
+		return;
+	}
+
+	const uint32_t seq = entry->seq.load(std::memory_order_relaxed);
+	entry->seq.store(seq + 1U, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	(is_peak ? entry->peak : entry->value).store(value, std::memory_order_relaxed);
+	entry->seq.store(seq + 2U, std::memory_order_release);
+}
+
+bool
+ShmValues::read(const uint64_t key, float& value, float& peak) const
+{
+	const Entry* const entry = find(key, false);
+	if (!entry) {
+		return false;
+	}
+
+	/* Give up eventually rather than spin forever, since the writer may have
+	   died in the middle of a write and left the sequence odd. */
+	for (uint32_t i = 0U; i < max_read_attempts; ++i) {
+		const uint32_t seq = entry->seq.load(std::memory_order_acquire);
+		if (seq & 1U) {
+			continue; // Being written
+		}
+
+		value = entry->value.load(std::memory_order_relaxed);
+		peak  = entry->peak.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (entry->seq.load(std::memory_order_relaxed) == seq) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool
+shm_send_fds(const int sock, const int* const fds, const size_t n_fds)
+{
+	assert(n_fds <= max_fds);
+
+	char  byte = 0;
+	iovec iov{&byte, 1U};
+
+	ControlBuffer control{};
+	msghdr        msg{};
+	msg.msg_iov        = &iov;
+	msg.msg_iovlen     = 1U;
+	msg.msg_control    = control.buf;
+	msg.msg_controllen = CMSG_SPACE(n_fds * sizeof(int));
+
+	cmsghdr* const cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level    = SOL_SOCKET;
+	cmsg->cmsg_type     = SCM_RIGHTS;
+	cmsg->cmsg_len      = CMSG_LEN(n_fds * sizeof(int));
+	memcpy(CMSG_DATA(cmsg), fds, n_fds * sizeof(int));
+
+	return sendmsg(sock, &msg, MSG_NOSIGNAL) == 1;
+}
+
+size_t
+shm_recv_fds(const int sock, int* const fds, const size_t n_fds)
+{
+	assert(n_fds <= max_fds);
+
+	char  byte = 0;
+	iovec iov{&byte, 1U};
+
+	ControlBuffer control{};
+	msghdr        msg{};
+	msg.msg_iov        = &iov;
+	msg.msg_iovlen     = 1U;
+	msg.msg_control    = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+
+	if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) != 1) {
+		return 0U;
+	}
+
+	size_t n = 0U;
+	for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+		if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS) {
+			const size_t count = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+			for (size_t i = 0U; i < count; ++i) {
+				int fd = -1;
+				memcpy(&fd, CMSG_DATA(c) + i * sizeof(int), sizeof(int));
+				if (n < n_fds) {
+					fds[n++] = fd;
+				} else {
+					close(fd); // More than expected, don't leak it
+				}
+			}
+		}
+	}
+
+	return n;
+}
+
+void
+shm_wake(const int sock)
+{
+	// If this would block, the reader has plenty of wakeups pending anyway
+	const char byte = 0;
+	send(sock, &byte, 1U, MSG_NOSIGNAL | MSG_DONTWAIT);
+}
+
+} // namespace ingen
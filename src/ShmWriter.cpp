@@ -0,0 +1,86 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2017 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ingen/ShmWriter.hpp>
+
+#include <ingen/AtomProtocol.hpp>
+#include <ingen/AtomWriter.hpp>
+#include <ingen/ShmTransport.hpp>
+#include <ingen/URI.hpp>
+#include <lv2/atom/atom.h>
+#include <raul/Socket.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+
+namespace ingen {
+
+namespace {
+
+/// Time to wait for a full ring to drain before giving up on the reader
+constexpr auto full_timeout = std::chrono::seconds{1};
+
+/// Time to sleep between attempts to write to a full ring
+constexpr auto full_retry = std::chrono::milliseconds{1};
+
+} // namespace
+
+ShmWriter::ShmWriter(URIMap&                       map,
+                     URIs&                         uris,
+                     URI                           uri,
+                     std::shared_ptr<ShmSession>   session,
+                     ShmRing&                      ring,
+                     std::shared_ptr<raul::Socket> sock)
+	: AtomWriter(map, uris, *this)
+	, _session(std::move(session))
+	, _ring(ring)
+	, _socket(std::move(sock))
+	, _protocol(map)
+	, _uri(std::move(uri))
+{}
+
+bool
+ShmWriter::write(const LV2_Atom* msg, int32_t)
+{
+	const auto& frames = _protocol.encode(msg);
+	const auto  size   = static_cast<uint32_t>(frames.size());
+	if (size > ShmSession::ring_capacity) {
+		return false; // Would never fit
+	}
+
+	/* Frames are written all at once, so the reader never sees part of a
+	   message.  A reader that doesn't keep up stalls this writer for a
+	   while, like a full socket would, and is then considered gone. */
+	const auto deadline = std::chrono::steady_clock::now() + full_timeout;
+	while (!_ring.write(frames.data(), size)) {
+		if (std::chrono::steady_clock::now() > deadline) {
+			return false;
+		}
+
+		std::this_thread::sleep_for(full_retry);
+	}
+
+	if (_ring.wake()) {
+		shm_wake(_socket->fd());
+	}
+
+	return true;
+}
+
+} // namespace ingen
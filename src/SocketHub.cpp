@@ -0,0 +1,735 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2017 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ingen/SocketHub.hpp>
+
+#include "ingen_config.h"
+
+#include <ingen/AtomForge.hpp>
+#include <ingen/AtomProtocol.hpp>
+#include <ingen/AtomReader.hpp>
+#include <ingen/Log.hpp>
+#include <ingen/ShmTransport.hpp>
+#include <ingen/URIMap.hpp>
+#include <ingen/World.hpp>
+#include <lv2/atom/atom.h>
+#include <lv2/atom/util.h>
+#include <lv2/urid/urid.h>
+#include <raul/Socket.hpp>
+#include <serd/serd.h>
+#include <sord/sord.h>
+#include <sord/sordmm.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace ingen {
+
+namespace {
+
+/// Maximum time an I/O thread sleeps before checking for exit
+constexpr int poll_timeout_ms = 100;
+
+/// Size of a single read from a socket
+constexpr size_t read_size = 4096U;
+
+/// Maximum number of reads from one connection before serving others
+constexpr unsigned max_reads = 16U;
+
+/// Events polled for on connections, which are re-armed after every event
+constexpr uint32_t connection_events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+
+SerdStatus
+copy_prefix(void* handle, const SerdNode* name, const SerdNode* uri)
+{
+	return serd_env_set_prefix(static_cast<SerdEnv*>(handle), name, uri);
+}
+
+/// Return true iff `c` may be part of a name or number next to a '.'
+bool
+is_name_char(const char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+	       (c >= '0' && c <= '9') || c == '_' || c == '-' || c == ':' ||
+	       c == '%' || (static_cast<unsigned char>(c) & 0x80U);
+}
+
+/** Finds the ends of Turtle statements in a stream without parsing them.
+ *
+ * A statement ends at a '.' outside of IRIs, literals, and comments, which
+ * is not within a name or number.  The null bytes that end bundles in the
+ * socket protocol also end a statement.
+ */
+class TurtleScanner
+{
+public:
+	/** Scan `buf` from `pos` for the end of the next statement.
+	 *
+	 * If a statement is complete, `end` is set to its end, `pos` to where
+	 * the next one starts, and true is returned.  Otherwise, `pos` is set to
+	 * where scanning should resume when more input has arrived.
+	 */
+	bool scan(const std::string& buf, size_t& pos, size_t& end);
+
+private:
+	enum class State { TOP, IRI, STRING, LONG_STRING, COMMENT };
+
+	State    _state{State::TOP};
+	char     _quote{'\0'};
+	bool     _escape{false};
+	unsigned _n_quotes{0U};
+};
+
+bool
+TurtleScanner::scan(const std::string& buf, size_t& pos, size_t& end)
+{
+	const size_t size = buf.size();
+	for (size_t i = pos; i < size; ++i) {
+		const char c = buf[i];
+		switch (_state) {
+		case State::TOP:
+			if (c == '\0') {
+				end = i;
+				pos = i + 1;
+				return true;
+			}
+
+			if (c == '.') {
+				if (i > 0 && is_name_char(buf[i - 1])) {
+					if (i + 1 == size) {
+						pos = i; // Need the next character to decide
+						return false;
+					}
+
+					if (is_name_char(buf[i + 1])) {
+						break; // Within a name or number like "1.5"
+					}
+				}
+
+				end = pos = i + 1;
+				return true;
+			}
+
+			if (c == '<') {
+				_state = State::IRI;
+			} else if (c == '#') {
+				_state = State::COMMENT;
+			} else if (c == '"' || c == '\'') {
+				if (i + 1 == size || (buf[i + 1] == c && i + 2 == size)) {
+					pos = i; // Need more quotes to know the kind of string
+					return false;
+				}
+
+				_quote = c;
+				if (buf[i + 1] != c) {
+					_state = State::STRING;
+				} else if (buf[i + 2] == c) {
+					_state    = State::LONG_STRING;
+					_n_quotes = 0U;
+					i += 2;
+				} else {
+					++i; // Empty string
+				}
+			}
+			break;
+
+		case State::IRI:
+			if (c == '>') {
+				_state = State::TOP;
+			}
+			break;
+
+		case State::STRING:
+			if (_escape) {
+				_escape = false;
+			} else if (c == '\\') {
+				_escape = true;
+			} else if (c == _quote) {
+				_state = State::TOP;
+			}
+			break;
+
+		case State::LONG_STRING:
+			if (_escape) {
+				_escape   = false;
+				_n_quotes = 0U;
+			} else if (c == '\\') {
+				_escape   = true;
+				_n_quotes = 0U;
+			} else if (c != _quote) {
+				_n_quotes = 0U;
+			} else if (++_n_quotes == 3U) {
+				_state = State::TOP;
+			}
+			break;
+
+		case State::COMMENT:
+			if (c == '\n' || c == '\r') {
+				_state = State::TOP;
+			}
+			break;
+		}
+	}
+
+	pos = size;
+	return false;
+}
+
+} // namespace
+
+/** A connection read by a SocketHub.
+ *
+ * All reading and parsing happens with the mutex held, so a connection is
+ * only ever handled by one thread at a time.
+ */
+class SocketHub::Connection
+{
+public:
+	Connection(World&                        world,
+	           std::shared_ptr<raul::Socket> sock,
+	           Interface&                    iface,
+	           const ShmValues*              values,
+	           FormatHandler                 on_format,
+	           HangupHandler                 on_hangup);
+
+	Connection(const Connection&)            = delete;
+	Connection& operator=(const Connection&) = delete;
+	Connection(Connection&&)                 = delete;
+	Connection& operator=(Connection&&)      = delete;
+
+	~Connection();
+
+	int         fd() const { return _socket->fd(); }
+	std::mutex& mutex() { return _mutex; }
+
+	/// Read available input and handle complete messages, false on hangup
+	bool read();
+
+	/// Start handling messages in the given format
+	void start(SocketFormat format);
+
+	/// Take the hangup handler, to be called once this is destroyed
+	HangupHandler take_hangup_handler() { return std::move(_on_hangup); }
+
+private:
+	bool read_format();
+	bool read_atoms();
+	bool read_shm();
+	bool read_turtle();
+	void handle_frame(LV2_Atom& frame);
+	void parse_turtle(const std::string& str);
+	void compact();
+
+	static SerdStatus set_base_uri(Connection* conn, const SerdNode* uri_node);
+
+	static SerdStatus set_prefix(Connection*     conn,
+	                             const SerdNode* name,
+	                             const SerdNode* uri_node);
+
+	static SerdStatus write_statement(Connection*        conn,
+	                                  SerdStatementFlags flags,
+	                                  const SerdNode*    graph,
+	                                  const SerdNode*    subject,
+	                                  const SerdNode*    predicate,
+	                                  const SerdNode*    object,
+	                                  const SerdNode*    object_datatype,
+	                                  const SerdNode*    object_lang);
+
+	World&                                _world;
+	std::shared_ptr<raul::Socket>         _socket;
+	const ShmValues*                      _values;
+	std::shared_ptr<ShmSession>           _session;
+	FormatHandler                         _on_format;
+	HangupHandler                         _on_hangup;
+	std::mutex                            _mutex;
+	SocketFormat                          _format{SocketFormat::TURTLE};
+	bool                                  _started{false};
+	std::string                           _buf;      ///< Unhandled input
+	size_t                                _begin{0U}; ///< Start of next message
+	size_t                                _scan{0U};  ///< Turtle scan position
+	std::string                           _message;  ///< Turtle message
+	std::vector<uint64_t>                 _frame;    ///< Aligned atom frame
+	TurtleScanner                         _scanner;
+	AtomProtocol                          _protocol;
+	AtomForge                             _forge;
+	AtomReader                            _reader;
+	std::unique_ptr<Sord::World>          _rdf_world;
+	SordModel*                            _model{nullptr};
+	SordInserter*                         _inserter{nullptr};
+	SerdReader*                           _serd_reader{nullptr};
+	SordNode*                             _base_uri{nullptr};
+	SordNode*                             _msg_node{nullptr};
+};
+
+SocketHub::Connection::Connection(World&                        world,
+                                  std::shared_ptr<raul::Socket> sock,
+                                  Interface&                    iface,
+                                  const ShmValues*              values,
+                                  FormatHandler                 on_format,
+                                  HangupHandler                 on_hangup)
+	: _world(world)
+	, _socket(std::move(sock))
+	, _values(values)
+	, _on_format(std::move(on_format))
+	, _on_hangup(std::move(on_hangup))
+	, _frame(1U)
+	, _protocol(world.uri_map())
+	, _forge(world.uri_map().urid_map())
+	, _reader(world.uri_map(), world.uris(), world.log(), iface)
+{}
+
+SocketHub::Connection::~Connection()
+{
+	if (_rdf_world) {
+		serd_reader_free(_serd_reader);
+		sord_inserter_free(_inserter);
+		sord_free(_model);
+		sord_node_free(_rdf_world->c_obj(), _msg_node);
+		sord_node_free(_rdf_world->c_obj(), _base_uri);
+	}
+}
+
+SerdStatus
+SocketHub::Connection::set_base_uri(Connection* conn, const SerdNode* uri_node)
+{
+	return sord_inserter_set_base_uri(conn->_inserter, uri_node);
+}
+
+SerdStatus
+SocketHub::Connection::set_prefix(Connection*     conn,
+                                  const SerdNode* name,
+                                  const SerdNode* uri_node)
+{
+	return sord_inserter_set_prefix(conn->_inserter, name, uri_node);
+}
+
+SerdStatus
+SocketHub::Connection::write_statement(Connection*        conn,
+                                       SerdStatementFlags flags,
+                                       const SerdNode*    graph,
+                                       const SerdNode*    subject,
+                                       const SerdNode*    predicate,
+                                       const SerdNode*    object,
+                                       const SerdNode*    object_datatype,
+                                       const SerdNode*    object_lang)
+{
+	if (!conn->_msg_node) {
+		conn->_msg_node =
+		    sord_node_from_serd_node(conn->_rdf_world->c_obj(),
+		                             conn->_rdf_world->prefixes().c_obj(),
+		                             subject,
+		                             nullptr,
+		                             nullptr);
+	}
+
+	return sord_inserter_write_statement(conn->_inserter,
+	                                     flags,
+	                                     graph,
+	                                     subject,
+	                                     predicate,
+	                                     object,
+	                                     object_datatype,
+	                                     object_lang);
+}
+
+bool
+SocketHub::Connection::read()
+{
+	char buf[read_size];
+	for (unsigned n = 0U; n < max_reads; ++n) {
+		const ssize_t c = recv(fd(), buf, sizeof(buf), MSG_DONTWAIT);
+		if (c == 0) {
+			return false; // Hangup
+		}
+
+		if (c < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			// Wait for more input unless the socket failed
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+
+		_buf.append(buf, static_cast<size_t>(c));
+		if ((!_started && !read_format()) ||
+		    (_started && _format == SocketFormat::ATOM && !read_atoms()) ||
+		    (_started && _format == SocketFormat::SHM && !read_shm()) ||
+		    (_started && _format == SocketFormat::TURTLE && !read_turtle())) {
+			return false;
+		}
+	}
+
+	return true; // Possibly more input, but give other connections a turn
+}
+
+void
+SocketHub::Connection::start(const SocketFormat format)
+{
+	_format  = format;
+	_started = true;
+
+	if (format == SocketFormat::TURTLE) {
+		/* Parse into a private RDF world like SocketReader does, so
+		   connections don't contend on the shared one. */
+		_rdf_world = std::make_unique<Sord::World>();
+
+		SerdEnv* const env = _rdf_world->prefixes().c_obj();
+		{
+			const std::lock_guard<std::mutex> lock{_world.rdf_mutex()};
+			serd_env_foreach(
+				_world.rdf_world()->prefixes().c_obj(), copy_prefix, env);
+		}
+
+		// Use <ingen:/> as base URI, so relative URIs are like bundle paths
+		_base_uri = sord_new_uri(_rdf_world->c_obj(),
+		                         reinterpret_cast<const uint8_t*>("ingen:/"));
+
+		serd_env_set_base_uri(env, sord_node_to_serd_node(_base_uri));
+
+		_model       = sord_new(_rdf_world->c_obj(), SORD_SPO, false);
+		_inserter    = sord_inserter_new(_model, env);
+		_serd_reader = serd_reader_new(
+			SERD_TURTLE, this, nullptr,
+			reinterpret_cast<SerdBaseSink>(set_base_uri),
+			reinterpret_cast<SerdPrefixSink>(set_prefix),
+			reinterpret_cast<SerdStatementSink>(write_statement),
+			nullptr);
+	}
+
+	if (_on_format) {
+		_on_format(format, _session);
+	}
+}
+
+bool
+SocketHub::Connection::read_format()
+{
+	if (_buf.empty()) {
+		return true;
+	}
+
+	if (_buf[0] != '\0') {
+		start(SocketFormat::TURTLE);
+		return read_turtle();
+	}
+
+	static_assert(sizeof(shm_protocol_hello) == sizeof(atom_protocol_hello));
+	if (_buf.size() < sizeof(atom_protocol_hello)) {
+		return true; // Wait for the rest of the hello
+	}
+
+#if USE_SHM
+	if (_values &&
+	    !memcmp(_buf.data(), shm_protocol_hello, sizeof(shm_protocol_hello))) {
+		// Reply with the shared memory, the socket only carries wakeups after
+		_session = ShmSession::create();
+		if (!_session) {
+			_world.log().error("Failed to create shared memory (%1%)\n",
+			                   strerror(errno));
+			return false;
+		}
+
+		const int fds[] = {_session->fd(), _values->fd()};
+		if (!shm_send_fds(fd(), fds, 2U)) {
+			_world.log().error("Failed to send shared memory (%1%)\n",
+			                   strerror(errno));
+			return false;
+		}
+
+		start(SocketFormat::SHM);
+		return read_shm();
+	}
+#endif
+
+	if (memcmp(_buf.data(), atom_protocol_hello, sizeof(atom_protocol_hello))) {
+		_world.log().error("Unknown socket protocol\n");
+		return false;
+	}
+
+	_begin = sizeof(atom_protocol_hello);
+	start(SocketFormat::ATOM);
+	return read_atoms();
+}
+
+bool
+SocketHub::Connection::read_atoms()
+{
+	while (_buf.size() - _begin >= sizeof(LV2_Atom)) {
+		LV2_Atom header{0U, 0U};
+		memcpy(&header, _buf.data() + _begin, sizeof(header));
+		if (header.size > AtomProtocol::max_frame_size) {
+			_world.log().error("Message too large (%1% bytes)\n", header.size);
+			return false;
+		}
+
+		const uint32_t body_size  = lv2_atom_pad_size(header.size);
+		const size_t   frame_size = sizeof(LV2_Atom) + body_size;
+		if (_buf.size() - _begin < frame_size) {
+			break; // Wait for the rest of the frame
+		}
+
+		// Copy to 64-bit aligned memory like atoms in memory
+		_frame.resize(1U + body_size / sizeof(uint64_t));
+		memcpy(_frame.data(), _buf.data() + _begin, frame_size);
+		_begin += frame_size;
+
+		handle_frame(*reinterpret_cast<LV2_Atom*>(_frame.data()));
+	}
+
+	compact();
+	return true;
+}
+
+bool
+SocketHub::Connection::read_shm()
+{
+	// Input on the socket only wakes us up, messages are in the ring
+	_buf.clear();
+	_begin = 0U;
+
+#if USE_SHM
+	ShmRing& ring = _session->to_engine();
+	do {
+		while (LV2_Atom* const frame = ring.read(_frame)) {
+			handle_frame(*frame);
+		}
+	} while (!ring.sleep());
+#endif
+
+	return true;
+}
+
+void
+SocketHub::Connection::handle_frame(LV2_Atom& frame)
+{
+	if (!_protocol.decode(frame)) {
+		_world.log().error("Malformed message\n");
+	} else if (frame.type) {
+		_reader.write(&frame);
+	}
+}
+
+bool
+SocketHub::Connection::read_turtle()
+{
+	size_t end = 0U;
+	while (_scanner.scan(_buf, _scan, end)) {
+		_message.assign(_buf, _begin, end - _begin);
+		_begin = _scan;
+		parse_turtle(_message);
+	}
+
+	if (_buf.size() - _begin > AtomProtocol::max_frame_size) {
+		_world.log().error("Message too large (%1% bytes)\n",
+		                   _buf.size() - _begin);
+		return false;
+	}
+
+	compact();
+	return true;
+}
+
+void
+SocketHub::Connection::parse_turtle(const std::string& str)
+{
+	const SerdStatus st = serd_reader_read_string(
+		_serd_reader, reinterpret_cast<const uint8_t*>(str.c_str()));
+
+	if (st > SERD_FAILURE) {
+		_world.log().error("Read error: %1%\n", serd_strerror(st));
+	} else if (_msg_node) {
+		// Build an atom from the message and call _iface methods based on it
+		_forge.read(*_rdf_world, _model, _msg_node);
+		_reader.write(_forge.atom());
+		_forge.clear();
+	}
+
+	if (_msg_node) {
+		sord_node_free(_rdf_world->c_obj(), _msg_node);
+		_msg_node = nullptr;
+	}
+
+	// Messages are independent, so drop the statements of this one
+	SordIter* const i = sord_begin(_model);
+	while (!sord_iter_end(i)) {
+		sord_erase(_model, i);
+	}
+	sord_iter_free(i);
+}
+
+void
+SocketHub::Connection::compact()
+{
+	_buf.erase(0U, _begin);
+	_scan -= std::min(_scan, _begin);
+	_begin = 0U;
+}
+
+SocketHub::SocketHub(World&                 world,
+                     const unsigned         n_threads,
+                     const ShmValues* const values)
+	: _world(world)
+	, _values(values)
+	, _epoll(epoll_create1(EPOLL_CLOEXEC))
+{
+	if (_epoll < 0) {
+		_world.log().error("Failed to create epoll instance (%1%)\n",
+		                   strerror(errno));
+		return;
+	}
+
+	for (unsigned i = 0U; i < std::max(1U, n_threads); ++i) {
+		_threads.emplace_back(&SocketHub::run, this);
+	}
+}
+
+SocketHub::~SocketHub()
+{
+	_exit_flag = true;
+	for (auto& thread : _threads) {
+		thread.join();
+	}
+
+	Connections connections;
+	{
+		const std::lock_guard<std::mutex> lock{_mutex};
+		connections.swap(_connections);
+	}
+
+	for (auto& c : connections) {
+		const HangupHandler on_hangup = c.second->take_hangup_handler();
+		c.second.reset();
+		if (on_hangup) {
+			on_hangup();
+		}
+	}
+
+	if (_epoll >= 0) {
+		::close(_epoll);
+	}
+}
+
+void
+SocketHub::add(std::shared_ptr<raul::Socket> sock,
+               Interface&                    iface,
+               FormatHandler                 on_format,
+               HangupHandler                 on_hangup)
+{
+	auto conn = std::make_unique<Connection>(_world,
+	                                         std::move(sock),
+	                                         iface,
+	                                         _values,
+	                                         std::move(on_format),
+	                                         std::move(on_hangup));
+
+	Connection* const c = conn.get();
+	{
+		const std::lock_guard<std::mutex> lock{_mutex};
+		_connections.emplace(c, std::move(conn));
+	}
+
+	epoll_event event{};
+	event.events   = connection_events;
+	event.data.ptr = c;
+	if (epoll_ctl(_epoll, EPOLL_CTL_ADD, c->fd(), &event)) {
+		_world.log().error("Failed to poll socket (%1%)\n", strerror(errno));
+		remove(c);
+	}
+}
+
+size_t
+SocketHub::size() const
+{
+	const std::lock_guard<std::mutex> lock{_mutex};
+	return _connections.size();
+}
+
+void
+SocketHub::run()
+{
+	while (!_exit_flag) {
+		epoll_event event{};
+		const int   n = epoll_wait(_epoll, &event, 1, poll_timeout_ms);
+		if (n < 0 && errno != EINTR) {
+			_world.log().error("Poll error: %1%\n", strerror(errno));
+			break;
+		}
+
+		if (n == 1) {
+			handle(static_cast<Connection*>(event.data.ptr));
+		}
+	}
+}
+
+void
+SocketHub::handle(Connection* const conn)
+{
+	bool open = false;
+	{
+		const std::lock_guard<std::mutex> lock{conn->mutex()};
+		open = conn->read();
+	}
+
+	if (!open) {
+		remove(conn);
+		return;
+	}
+
+	// Re-arm, since only one thread at a time may handle a connection
+	epoll_event event{};
+	event.events   = connection_events;
+	event.data.ptr = conn;
+	epoll_ctl(_epoll, EPOLL_CTL_MOD, conn->fd(), &event);
+}
+
+void
+SocketHub::remove(Connection* const conn)
+{
+	epoll_ctl(_epoll, EPOLL_CTL_DEL, conn->fd(), nullptr);
+
+	std::unique_ptr<Connection> owned;
+	{
+		const std::lock_guard<std::mutex> lock{_mutex};
+
+		const auto i = _connections.find(conn);
+		if (i != _connections.end()) {
+			owned = std::move(i->second);
+			_connections.erase(i);
+		}
+	}
+
+	if (owned) {
+		const HangupHandler on_hangup = owned->take_hangup_handler();
+		owned.reset();
+		if (on_hangup) {
+			on_hangup();
+		}
+	}
+}
+
+} // namespace ingen
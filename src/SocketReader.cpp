@@ -17,10 +17,13 @@
 #include <ingen/SocketReader.hpp>
 
 #include <ingen/AtomForge.hpp>
+#include <ingen/AtomProtocol.hpp>
 #include <ingen/AtomReader.hpp>
 #include <ingen/Log.hpp>
 #include <ingen/URIMap.hpp>
 #include <ingen/World.hpp>
+#include <lv2/atom/atom.h>
+#include <lv2/atom/util.h>
 #include <lv2/urid/urid.h>
 #include <raul/Socket.hpp>
 #include <serd/serd.h>
@@ -29,21 +32,47 @@
 
 #include <cerrno>
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <mutex>
 #include <poll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <utility>
+#include <vector>
 
 namespace ingen {
 
+namespace {
+
+SerdStatus
+copy_prefix(void* handle, const SerdNode* name, const SerdNode* uri)
+{
+	return serd_env_set_prefix(static_cast<SerdEnv*>(handle), name, uri);
+}
+
+} // namespace
+
+SocketReader::SocketReader(ingen::World&                 world,
+                           Interface&                    iface,
+                           std::shared_ptr<raul::Socket> sock,
+                           SocketFormat                  format)
+    : _world(world)
+    , _iface(iface)
+    , _socket(std::move(sock))
+    , _format(format)
+    , _thread(&SocketReader::run, this)
+{}
+
 SocketReader::SocketReader(ingen::World&                 world,
                            Interface&                    iface,
-                           std::shared_ptr<raul::Socket> sock)
+                           std::shared_ptr<raul::Socket> sock,
+                           FormatHandler                 on_format)
     : _world(world)
     , _iface(iface)
     , _socket(std::move(sock))
+    , _format(SocketFormat::TURTLE)
+    , _on_format(std::move(on_format))
     , _thread(&SocketReader::run, this)
 {}
 
@@ -81,7 +110,7 @@ SocketReader::write_statement(SocketReader*      iface,
 {
 	if (!iface->_msg_node) {
 		iface->_msg_node = sord_node_from_serd_node(
-			iface->_world.rdf_world()->c_obj(), iface->_env, subject, nullptr, nullptr);
+			iface->_sord_world, iface->_env, subject, nullptr, nullptr);
 	}
 
 	return sord_inserter_write_statement(
@@ -112,31 +141,126 @@ SocketReader::c_err(void* stream)
 	return self->_socket_error;
 }
 
+bool
+SocketReader::recv_all(void* buf, size_t len)
+{
+	const ssize_t c = recv(_socket->fd(), buf, len, MSG_WAITALL);
+	if (c < 0) {
+		_socket_error = errno;
+	}
+
+	return c == static_cast<ssize_t>(len);
+}
+
 void
 SocketReader::run()
 {
-	Sord::World*  world = _world.rdf_world();
-	LV2_URID_Map& map   = _world.uri_map().urid_map();
+	if (_on_format) {
+		/* A client requests binary atoms by starting with a null byte, which
+		   is never the start of a Turtle message.  Nothing is sent to a client
+		   before it speaks, so the first byte decides without a timeout. */
+		char first = 0;
+		if (recv(_socket->fd(), &first, 1, MSG_PEEK) != 1) {
+			on_hangup();
+			_socket.reset();
+			return;
+		}
 
-	// Set up a forge to build LV2 atoms from model
-	SordNode*  base_uri = nullptr;
-	SordModel* model    = nullptr;
-	AtomForge  forge(map);
+		if (first == '\0') {
+			char hello[sizeof(atom_protocol_hello)] = {};
+			if (!recv_all(hello, sizeof(hello)) ||
+			    memcmp(hello, atom_protocol_hello, sizeof(hello))) {
+				_world.log().error("Unknown socket protocol\n");
+				on_hangup();
+				_socket.reset();
+				return;
+			}
+
+			_format = SocketFormat::ATOM;
+		}
+
+		_on_format(_format);
+	}
+
+	if (_format == SocketFormat::ATOM) {
+		read_atoms();
+	} else {
+		read_turtle();
+	}
+
+	_socket.reset();
+}
+
+void
+SocketReader::read_atoms()
+{
+	AtomProtocol protocol{_world.uri_map()};
+	AtomReader   ar(_world.uri_map(), _world.uris(), _world.log(), _iface);
+
+	// Frame buffer, 64-bit aligned like atoms in memory
+	std::vector<uint64_t> buf(1U);
+
+	while (!_exit_flag && !_socket_error) {
+		LV2_Atom header{0U, 0U};
+		if (!recv_all(&header, sizeof(header))) {
+			on_hangup();
+			break; // Hangup
+		}
+
+		if (header.size > AtomProtocol::max_frame_size) {
+			_world.log().error("Message too large (%1% bytes)\n", header.size);
+			on_hangup();
+			break;
+		}
+
+		const uint32_t body_size = lv2_atom_pad_size(header.size);
+		buf.resize(1U + body_size / sizeof(uint64_t));
+
+		auto* const frame = reinterpret_cast<LV2_Atom*>(buf.data());
+		*frame            = header;
+		if (body_size && !recv_all(frame + 1, body_size)) {
+			on_hangup();
+			break; // Hangup
+		}
+
+		if (!protocol.decode(*frame)) {
+			_world.log().error("Malformed message\n");
+		} else if (frame->type) {
+			// Call _iface methods based on atom content
+			ar.write(frame);
+		}
+	}
+}
+
+void
+SocketReader::read_turtle()
+{
+	/* Parse into a private RDF world, so connections don't contend on the
+	   shared one.  Only the (thread-safe) URI map is shared. */
+	Sord::World   world;
+	LV2_URID_Map& map = _world.uri_map().urid_map();
+
+	_sord_world = world.c_obj();
+	_env        = world.prefixes().c_obj();
 	{
-		// Lock RDF world
+		// Start with the standard prefixes, which clients may rely on
 		const std::lock_guard<std::mutex> lock{_world.rdf_mutex()};
+		serd_env_foreach(
+			_world.rdf_world()->prefixes().c_obj(), copy_prefix, _env);
+	}
 
-		// Use <ingen:/> as base URI, so relative URIs are like bundle paths
-		base_uri = sord_new_uri(world->c_obj(),
-		                        reinterpret_cast<const uint8_t*>("ingen:/"));
+	// Use <ingen:/> as base URI, so relative URIs are like bundle paths
+	SordNode* const base_uri = sord_new_uri(
+		world.c_obj(), reinterpret_cast<const uint8_t*>("ingen:/"));
 
-		// Make a model and reader to parse the next Turtle message
-		_env = world->prefixes().c_obj();
-		model = sord_new(world->c_obj(), SORD_SPO, false);
+	// Make a model and reader to parse the next Turtle message
+	SordModel* const model = sord_new(world.c_obj(), SORD_SPO, false);
 
-		// Create an inserter for writing incoming triples to model
-		_inserter = sord_inserter_new(model, _env);
-	}
+	// Create an inserter for writing incoming triples to model
+	_inserter = sord_inserter_new(model, _env);
+
+	// Set up a forge to build LV2 atoms from model
+	AtomForge forge(map);
 
 	SerdReader* reader = serd_reader_new(
 		SERD_TURTLE, this, nullptr,
@@ -174,9 +298,6 @@ SocketReader::run()
 			continue; // No data, shouldn't happen
 		}
 
-		// Lock RDF world
-		const std::lock_guard<std::mutex> lock{_world.rdf_mutex()};
-
 		// Read until the next '.'
 		const SerdStatus st = serd_reader_read_chunk(reader);
 		if (st == SERD_FAILURE || !_msg_node) {
@@ -189,26 +310,28 @@ SocketReader::run()
 		}
 
 		// Build an LV2_Atom at chunk.buf from the message
-		forge.read(*world, model, _msg_node);
+		forge.read(world, model, _msg_node);
 
 		// Call _iface methods based on atom content
 		ar.write(forge.atom());
 
 		// Reset everything for the next iteration
 		forge.clear();
-		sord_node_free(world->c_obj(), _msg_node);
+		sord_node_free(world.c_obj(), _msg_node);
 		_msg_node = nullptr;
 	}
 
-	// Lock RDF world
-	const std::lock_guard<std::mutex> lock{_world.rdf_mutex()};
-
 	// Destroy everything
 	sord_inserter_free(_inserter);
 	serd_reader_end_stream(reader);
 	serd_reader_free(reader);
 	sord_free(model);
-	_socket.reset();
+	sord_node_free(world.c_obj(), _msg_node);
+	sord_node_free(world.c_obj(), base_uri);
+	_msg_node   = nullptr;
+	_inserter   = nullptr;
+	_env        = nullptr;
+	_sord_world = nullptr;
 }
 
 } // namespace ingen
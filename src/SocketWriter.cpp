@@ -16,12 +16,19 @@
 
 #include <ingen/SocketWriter.hpp>
 
+#include <ingen/AtomProtocol.hpp>
+#include <ingen/AtomWriter.hpp>
 #include <ingen/Message.hpp>
 #include <ingen/TurtleWriter.hpp>
 #include <ingen/URI.hpp>
+#include <lv2/atom/atom.h>
 #include <raul/Socket.hpp>
 
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <utility>
@@ -36,30 +43,101 @@ namespace ingen {
 SocketWriter::SocketWriter(URIMap&                       map,
                            URIs&                         uris,
                            const URI&                    uri,
-                           std::shared_ptr<raul::Socket> sock)
+                           std::shared_ptr<raul::Socket> sock,
+                           SocketFormat                  format)
 	: TurtleWriter(map, uris, uri)
 	, _socket(std::move(sock))
+	, _protocol(format == SocketFormat::ATOM ? new AtomProtocol(map) : nullptr)
 {}
 
 void
 SocketWriter::message(const Message& message)
 {
+	if (_protocol) {
+		AtomWriter::message(message); // Binary, so skip Turtle templates
+		return;
+	}
+
 	TurtleWriter::message(message);
-	if (std::get_if<BundleEnd>(&message)) {
-		// Send a null byte to indicate end of bundle
-		const char end[] = { 0 };
-		send(_socket->fd(), end, 1, MSG_NOSIGNAL);
+	if (std::get_if<BundleBegin>(&message)) {
+		++_bundle_depth;
+	} else if (std::get_if<BundleEnd>(&message)) {
+		// Send a null byte to indicate the end of the outermost bundle
+		if (_bundle_depth == 0 || --_bundle_depth == 0) {
+			const char end[] = { 0 };
+			text_sink(end, 1);
+		}
+	}
+}
+
+bool
+SocketWriter::write(const LV2_Atom* msg, int32_t default_id)
+{
+	if (!_protocol) {
+		return TurtleWriter::write(msg, default_id);
 	}
+
+	const auto& frames = _protocol->encode(msg);
+	return text_sink(frames.data(), frames.size()) == frames.size();
 }
 
 size_t
 SocketWriter::text_sink(const void* buf, size_t len)
 {
-	const ssize_t ret = send(_socket->fd(), buf, len, MSG_NOSIGNAL);
-	if (ret < 0) {
-		return 0;
+	const auto* const data = static_cast<const char*>(buf);
+	if (!_nonblocking) {
+		size_t offset = 0U;
+		while (offset < len) {
+			const ssize_t ret =
+			    send(_socket->fd(), data + offset, len - offset, MSG_NOSIGNAL);
+			if (ret <= 0) {
+				break;
+			}
+
+			offset += static_cast<size_t>(ret);
+		}
+
+		return offset;
+	}
+
+	// Send what the socket accepts now, if nothing is waiting to be sent
+	size_t offset = 0U;
+	if (_unsent.empty()) {
+		const ssize_t ret =
+		    send(_socket->fd(), data, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+			return 0U; // Connection failed
+		}
+
+		offset = ret < 0 ? 0U : static_cast<size_t>(ret);
+	}
+
+	// Keep the rest for flush()
+	_unsent.append(data + offset, len - offset);
+	return len;
+}
+
+bool
+SocketWriter::flush()
+{
+	while (!_unsent.empty()) {
+		const ssize_t ret = send(_socket->fd(),
+		                         _unsent.data(),
+		                         _unsent.size(),
+		                         MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			return false;
+		}
+
+		if (ret <= 0) {
+			_unsent.clear(); // Connection failed, so drop output
+			break;
+		}
+
+		_unsent.erase(0U, static_cast<size_t>(ret));
 	}
-	return ret;
+
+	return true;
 }
 
 } // namespace ingen
@@ -16,27 +16,38 @@
 
 #include <ingen/TurtleWriter.hpp>
 
+#include <ingen/Atom.hpp>
+#include <ingen/AtomForge.hpp>
 #include <ingen/AtomWriter.hpp>
+#include <ingen/Message.hpp>
+#include <ingen/Properties.hpp>
+#include <ingen/Resource.hpp>
 #include <ingen/URI.hpp>
 #include <ingen/URIMap.hpp>
+#include <ingen/URIs.hpp>
 #include <ingen/ingen.h>
 #include <lv2/atom/atom.h>
+#include <lv2/atom/forge.h>
+#include <lv2/urid/urid.h>
 #include <serd/serd.h>
 #include <sratom/sratom.h>
 
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
 #include <utility>
+#include <variant>
+#include <vector>
 
 #define USTR(s) reinterpret_cast<const uint8_t*>(s)
 
 namespace ingen {
 namespace {
 
-size_t
-c_text_sink(const void* buf, size_t len, void* stream)
-{
-	auto* writer = static_cast<TurtleWriter*>(stream);
-	return writer->text_sink(buf, len);
-}
+/// Maximum number of message shapes to keep templates for
+constexpr size_t max_templates = 1024U;
 
 SerdStatus
 write_prefix(void* handle, const SerdNode* name, const SerdNode* uri)
@@ -45,6 +56,20 @@ write_prefix(void* handle, const SerdNode* name, const SerdNode* uri)
 	return SERD_SUCCESS;
 }
 
+bool
+is_label_char(const char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+	       (c >= '0' && c <= '9') || c == '_' || c == '-';
+}
+
+void
+append_number(std::string& str, const uint32_t n)
+{
+	char buf[16];
+	str.append(buf, static_cast<size_t>(snprintf(buf, sizeof(buf), "%u", n)));
+}
+
 } // namespace
 
 TurtleWriter::TurtleWriter(URIMap& map, URIs& uris, URI uri)
@@ -54,6 +79,7 @@ TurtleWriter::TurtleWriter(URIMap& map, URIs& uris, URI uri)
     , _base{serd_node_from_string(SERD_URI, USTR("ingen:/"))}
     , _env{serd_env_new(&_base)}
     , _uri{std::move(uri)}
+    , _uris{uris}
 {
 	// Use <ingen:/> as base URI, so relative URIs are like bundle paths
 
@@ -80,15 +106,15 @@ TurtleWriter::TurtleWriter(URIMap& map, URIs& uris, URI uri)
 		static_cast<SerdStyle>(SERD_STYLE_RESOLVED|SERD_STYLE_ABBREVIATED|SERD_STYLE_CURIED),
 		_env,
 		&_base_uri,
-		c_text_sink,
+		write_text,
 		this);
 
-	// Configure sratom to write directly to the writer (and thus text_sink)
+	// Configure sratom to write to the writer (and thus text_sink)
 	sratom_set_sink(_sratom,
 	                reinterpret_cast<const char*>(_base.buf),
-	                reinterpret_cast<SerdStatementSink>(serd_writer_write_statement),
-	                reinterpret_cast<SerdEndSink>(serd_writer_end_anon),
-	                _writer);
+	                reinterpret_cast<SerdStatementSink>(write_statement),
+	                reinterpret_cast<SerdEndSink>(end_anon),
+	                this);
 }
 
 TurtleWriter::~TurtleWriter()
@@ -110,7 +136,279 @@ TurtleWriter::write(const LV2_Atom* msg, int32_t)
 	sratom_write(_sratom, &_map.urid_unmap(), 0,
 	             nullptr, nullptr, msg->type, msg->size, LV2_ATOM_BODY_CONST(msg));
 	serd_writer_finish(_writer);
+	_steady = true;
+	return true;
+}
+
+void
+TurtleWriter::message(const Message& message)
+{
+	/* Templates are only learned once a message has been written, since
+	   the first message starts differently after the prefixes. */
+	if (!_steady || !shape(message)) {
+		AtomWriter::message(message);
+		return;
+	}
+
+	auto t = _templates.find(_key);
+	if (t == _templates.end()) {
+		if (_templates.size() >= max_templates) {
+			_templates.clear();
+		}
+
+		t = _templates.emplace(_key, Template{}).first;
+		learn(t->second, message);
+	} else if (t->second.usable) {
+		write_template(t->second);
+	} else {
+		AtomWriter::message(message);
+	}
+}
+
+size_t
+TurtleWriter::write_text(const void* buf, size_t len, void* stream)
+{
+	auto* const writer = static_cast<TurtleWriter*>(stream);
+	if (writer->_capture) {
+		writer->_capture->append(static_cast<const char*>(buf), len);
+		return len;
+	}
+
+	return writer->text_sink(buf, len);
+}
+
+SerdStatus
+TurtleWriter::write_statement(TurtleWriter*      writer,
+                              SerdStatementFlags flags,
+                              const SerdNode*    graph,
+                              const SerdNode*    subject,
+                              const SerdNode*    predicate,
+                              const SerdNode*    object,
+                              const SerdNode*    object_datatype,
+                              const SerdNode*    object_lang)
+{
+	if (writer->_counting) {
+		// Only note the label sratom chose for the top object
+		if (writer->_label.empty()) {
+			writer->_label.assign(reinterpret_cast<const char*>(subject->buf),
+			                      subject->n_bytes);
+		}
+		return SERD_SUCCESS;
+	}
+
+	return serd_writer_write_statement(writer->_writer,
+	                                   flags,
+	                                   graph,
+	                                   subject,
+	                                   predicate,
+	                                   object,
+	                                   object_datatype,
+	                                   object_lang);
+}
+
+SerdStatus
+TurtleWriter::end_anon(TurtleWriter* writer, const SerdNode* node)
+{
+	return writer->_counting ? SERD_SUCCESS
+	                         : serd_writer_end_anon(writer->_writer, node);
+}
+
+/** Set _key to the shape of a message and _values to its values.
+ *
+ * Messages have the same shape if they only differ in the values of their
+ * numeric and boolean properties, and in their blank node labels.  Returns
+ * false if the message can't be written with a template.
+ */
+bool
+TurtleWriter::shape(const Message& message)
+{
+	_key.clear();
+	_values.clear();
+
+	const auto add_header = [this](const char            kind,
+	                               const int32_t&        seq,
+	                               const URI&            subject,
+	                               const Resource::Graph ctx) {
+		_key += kind;
+		_key += static_cast<char>('0' + static_cast<int>(ctx));
+		if (seq) {
+			// Written first by AtomWriter::forge_request()
+			_key += '#';
+			_values.emplace_back(_uris.atom_Int.urid(), &seq);
+		}
+		_key += subject.c_str();
+		_key += '\n';
+	};
+
+	if (const auto* const msg = std::get_if<SetProperty>(&message)) {
+		add_header('S', msg->seq, msg->subject, msg->ctx);
+		_key += msg->predicate.c_str();
+		_key += ' ';
+		return add_value(msg->value);
+	}
+
+	if (const auto* const msg = std::get_if<Delta>(&message)) {
+		add_header('D', msg->seq, msg->uri, msg->ctx);
+		for (const Properties* props : {&msg->remove, &msg->add}) {
+			for (const auto& p : *props) {
+				_key += p.first.c_str();
+				_key += ' ';
+				if (!add_value(p.second)) {
+					return false;
+				}
+			}
+			_key += '\n';
+		}
+		return true;
+	}
+
+	return false;
+}
+
+/** Add a value to the shape of a message, or return false if unsupported.
+ *
+ * Numbers and booleans are holes in the template, URIs are part of it.
+ */
+bool
+TurtleWriter::add_value(const Atom& value)
+{
+	const LV2_URID type = value.type();
+	append_number(_key, type);
+	_key += ' ';
+
+	if (type == _uris.atom_Float) {
+		if (!std::isfinite(value.get<float>())) {
+			return false; // Not written as a number by sratom
+		}
+	} else if (type == _uris.atom_URID) {
+		append_number(_key, value.get<LV2_URID>());
+		_key += '\n';
+		return true;
+	} else if (type == _uris.atom_URI) {
+		_key += value.ptr<char>();
+		_key += '\n';
+		return true;
+	} else if (type != _uris.atom_Int && type != _uris.atom_Bool) {
+		return false;
+	}
+
+	_key += '\n';
+	_values.emplace_back(type, value.get_body());
 	return true;
 }
 
+/** Append the lexical form of a value like sratom writes it. */
+void
+TurtleWriter::literal(std::string& out, const Value& value) const
+{
+	const LV2_URID    type = value.first;
+	const void* const body = value.second;
+
+	if (type == _uris.atom_Bool) {
+		out += *static_cast<const int32_t*>(body) ? "true" : "false";
+		return;
+	}
+
+	SerdNode node =
+		(type == _uris.atom_Float)
+			? serd_node_new_decimal(*static_cast<const float*>(body), 8)
+			: serd_node_new_integer(*static_cast<const int32_t*>(body));
+
+	out.append(reinterpret_cast<const char*>(node.buf), node.n_bytes);
+	serd_node_free(&node);
+}
+
+/** Write a message as usual, and make a template from the output. */
+void
+TurtleWriter::learn(Template& tmpl, const Message& message)
+{
+	std::string text;
+	_capture = &text;
+	AtomWriter::message(message);
+	_capture = nullptr;
+	text_sink(text.data(), text.size());
+
+	// Cut out the label of the message object, which changes every time
+	size_t pos = text.find("_:");
+	if (pos == std::string::npos) {
+		return;
+	}
+
+	pos += 2U;
+	tmpl.text.emplace_back(text, 0U, pos);
+	while (pos < text.size() && is_label_char(text[pos])) {
+		++pos;
+	}
+
+	// Cut out the values in order, which must be where they are expected
+	std::string lexical;
+	for (const Value& value : _values) {
+		const bool quoted = value.first != _uris.atom_Bool;
+
+		lexical.assign(1U, quoted ? '"' : ' ');
+		literal(lexical, value);
+		if (quoted) {
+			lexical += '"';
+		}
+
+		const size_t found = text.find(lexical, pos);
+		if (found == std::string::npos) {
+			tmpl.text.clear();
+			return; // Written differently, so always use the usual way
+		}
+
+		tmpl.text.emplace_back(text, pos, found + 1U - pos);
+		pos = found + lexical.size() - (quoted ? 1U : 0U);
+	}
+
+	tmpl.text.emplace_back(text, pos);
+
+	/* Make an atom with as many blank objects as the message, which is
+	   written to advance the blank node counter of sratom by as much. */
+	const unsigned n_blanks = std::holds_alternative<Delta>(message) ? 3U : 1U;
+
+	AtomForge            forge{_map.urid_map()};
+	LV2_Atom_Forge_Frame frame;
+	lv2_atom_forge_object(&forge, &frame, 0, _uris.patch_Patch);
+	for (unsigned i = 1U; i < n_blanks; ++i) {
+		LV2_Atom_Forge_Frame child;
+		lv2_atom_forge_key(&forge, _uris.patch_add);
+		lv2_atom_forge_object(&forge, &child, 0, 0);
+		lv2_atom_forge_pop(&forge, &child);
+	}
+	lv2_atom_forge_pop(&forge, &frame);
+
+	const LV2_Atom* const atom = forge.atom();
+	const size_t          size = sizeof(LV2_Atom) + atom->size;
+	tmpl.blanks.resize((size + sizeof(uint64_t) - 1U) / sizeof(uint64_t));
+	memcpy(tmpl.blanks.data(), atom, size);
+	tmpl.usable = true;
+}
+
+/** Write a message by filling in a template. */
+void
+TurtleWriter::write_template(const Template& tmpl)
+{
+	// Let sratom count the blank nodes of this message and name the top one
+	const auto* const blanks =
+		reinterpret_cast<const LV2_Atom*>(tmpl.blanks.data());
+
+	_label.clear();
+	_counting = true;
+	sratom_write(_sratom, &_map.urid_unmap(), 0, nullptr, nullptr,
+	             blanks->type, blanks->size, LV2_ATOM_BODY_CONST(blanks));
+	_counting = false;
+
+	_text.clear();
+	_text += tmpl.text[0];
+	_text += _label;
+	for (size_t i = 0U; i < _values.size(); ++i) {
+		_text += tmpl.text[i + 1U];
+		literal(_text, _values[i]);
+	}
+	_text += tmpl.text.back();
+
+	text_sink(_text.data(), _text.size());
+}
+
 } // namespace ingen
@@ -99,6 +99,8 @@ URIs::URIs(Forge& ingen_forge, URIMap* map, LilvWorld* lworld)
 	, ingen_broadcast       (forge, map, lworld, INGEN__broadcast)
 	, ingen_canvasX         (forge, map, lworld, INGEN__canvasX)
 	, ingen_canvasY         (forge, map, lworld, INGEN__canvasY)
+	, ingen_catalogVersion  (forge, map, lworld, INGEN__catalogVersion)
+	, ingen_deferredEvents  (forge, map, lworld, INGEN__deferredEvents)
 	, ingen_enabled         (forge, map, lworld, INGEN__enabled)
 	, ingen_externalContext (forge, map, lworld, INGEN__externalContext)
 	, ingen_file            (forge, map, lworld, INGEN__file)
@@ -106,6 +108,7 @@ URIs::URIs(Forge& ingen_forge, URIMap* map, LilvWorld* lworld)
 	, ingen_incidentTo      (forge, map, lworld, INGEN__incidentTo)
 	, ingen_internalContext (forge, map, lworld, INGEN__internalContext)
 	, ingen_loadedBundle    (forge, map, lworld, INGEN__loadedBundle)
+	, ingen_maxQueueDepth   (forge, map, lworld, INGEN__maxQueueDepth)
 	, ingen_maxRunLoad      (forge, map, lworld, INGEN__maxRunLoad)
 	, ingen_meanRunLoad     (forge, map, lworld, INGEN__meanRunLoad)
 	, ingen_minRunLoad      (forge, map, lworld, INGEN__minRunLoad)
@@ -113,7 +116,11 @@ URIs::URIs(Forge& ingen_forge, URIMap* map, LilvWorld* lworld)
 	, ingen_polyphonic      (forge, map, lworld, INGEN__polyphonic)
 	, ingen_polyphony       (forge, map, lworld, INGEN__polyphony)
 	, ingen_prototype       (forge, map, lworld, INGEN__prototype)
+	, ingen_queueDepth      (forge, map, lworld, INGEN__queueDepth)
+	, ingen_spareVoices     (forge, map, lworld, INGEN__spareVoices)
 	, ingen_sprungLayout    (forge, map, lworld, INGEN__sprungLayout)
+	, ingen_subscribe       (forge, map, lworld, INGEN__subscribe)
+	, ingen_subscribeProperty (forge, map, lworld, INGEN__subscribeProperty)
 	, ingen_tail            (forge, map, lworld, INGEN__tail)
 	, ingen_uiEmbedded      (forge, map, lworld, INGEN__uiEmbedded)
 	, ingen_value           (forge, map, lworld, INGEN__value)
@@ -29,6 +29,7 @@
 #include <ingen/client/BlockModel.hpp>
 #include <ingen/client/GraphModel.hpp>
 #include <ingen/client/ObjectModel.hpp>
+#include <ingen/client/PluginCache.hpp>
 #include <ingen/client/PluginModel.hpp>
 #include <ingen/client/PortModel.hpp>
 #include <ingen/client/SigClientInterface.hpp>
@@ -255,6 +256,18 @@ ClientStore::operator()(const Put& msg)
 	const auto& uri        = msg.uri;
 	const auto& properties = msg.properties;
 
+	if (uri == plugins_uri()) {
+		const auto v = properties.find(_uris.ingen_catalogVersion);
+		if (_plugin_cache && v != properties.end() &&
+		    v->second.type() == _uris.forge.String) {
+			const std::string version = v->second.ptr<char>();
+			if (!_plugin_cache->load(version, *this)) {
+				_plugin_cache->save(version, *_plugins);
+			}
+		}
+		return;
+	}
+
 	bool is_block  = false;
 	bool is_graph  = false;
 	bool is_output = false;
@@ -0,0 +1,283 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2017 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ingen/client/PluginCache.hpp>
+
+#include <ingen/Atom.hpp>
+#include <ingen/FilePath.hpp>
+#include <ingen/Forge.hpp>
+#include <ingen/Interface.hpp>
+#include <ingen/Properties.hpp>
+#include <ingen/URI.hpp>
+#include <ingen/URIMap.hpp>
+#include <ingen/URIs.hpp>
+#include <ingen/client/ClientStore.hpp>
+#include <ingen/client/PluginModel.hpp>
+#include <ingen/paths.hpp>
+#include <lv2/atom/atom.h>
+#include <serd/serd.h>
+#include <sratom/sratom.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#define NS_XSD "http://www.w3.org/2001/XMLSchema#"
+#define USTR(s) reinterpret_cast<const uint8_t*>(s)
+
+namespace ingen::client {
+namespace {
+
+/// Plugin properties read from a catalog file
+struct Catalog {
+	Forge&                    forge;
+	std::map<URI, Properties> plugins;
+};
+
+SerdStatus
+read_statement(void*              handle,
+               SerdStatementFlags,
+               const SerdNode*,
+               const SerdNode*    subject,
+               const SerdNode*    predicate,
+               const SerdNode*    object,
+               const SerdNode*    datatype,
+               const SerdNode*)
+{
+	auto& catalog = *static_cast<Catalog*>(handle);
+	if (subject->type != SERD_URI || predicate->type != SERD_URI) {
+		return SERD_SUCCESS;
+	}
+
+	const char* const str  = reinterpret_cast<const char*>(object->buf);
+	const std::string type = datatype
+		? reinterpret_cast<const char*>(datatype->buf) : "";
+
+	Forge& forge = catalog.forge;
+	Atom   value;
+	if (object->type == SERD_URI) {
+		value = forge.make_urid(URI(str));
+	} else if (type == LV2_ATOM__URI) {
+		value = forge.alloc_uri(str);
+	} else if (type == NS_XSD "integer") {
+		value = forge.make(static_cast<int32_t>(strtol(str, nullptr, 10)));
+	} else if (type == NS_XSD "decimal") {
+		value = forge.make(strtof(str, nullptr));
+	} else if (type == NS_XSD "boolean") {
+		value = forge.make(!strcmp(str, "true"));
+	} else {
+		value = forge.alloc(str);
+	}
+
+	catalog.plugins[URI(reinterpret_cast<const char*>(subject->buf))].emplace(
+		URI(reinterpret_cast<const char*>(predicate->buf)), value);
+
+	return SERD_SUCCESS;
+}
+
+} // namespace
+
+PluginCache::PluginCache(URIMap& map, URIs& uris, FilePath dir)
+	: _map(map)
+	, _uris(uris)
+	, _dir(std::move(dir))
+{}
+
+FilePath
+PluginCache::path(const std::string& version) const
+{
+	// Versions come from the engine, so only allow what it generates
+	const bool valid =
+		!version.empty() && version.length() <= 16U &&
+		std::all_of(version.begin(), version.end(), [](const char c) {
+			return isxdigit(static_cast<unsigned char>(c));
+		});
+
+	return valid ? _dir / (version + ".ttl") : FilePath();
+}
+
+URI
+PluginCache::request_uri() const
+{
+	std::error_code                 ec;
+	FilePath                        newest;
+	std::filesystem::file_time_type newest_time;
+	for (const auto& e : std::filesystem::directory_iterator{_dir, ec}) {
+		const FilePath& file = e.path();
+		const auto      time = e.last_write_time(ec);
+		if (!ec && file.extension() == ".ttl" &&
+		    !path(file.stem().string()).empty() &&
+		    (newest.empty() || time > newest_time)) {
+			newest      = file;
+			newest_time = time;
+		}
+	}
+
+	return newest.empty() ? plugins_uri()
+	                      : plugins_uri(newest.stem().string());
+}
+
+bool
+PluginCache::load(const std::string& version, Interface& target) const
+{
+	const FilePath  file = path(version);
+	std::error_code ec;
+	if (file.empty() || !std::filesystem::exists(file, ec)) {
+		return false;
+	}
+
+	Catalog     catalog{_uris.forge, {}};
+	SerdReader* reader = serd_reader_new(
+		SERD_TURTLE, &catalog, nullptr, nullptr, nullptr, read_statement, nullptr);
+
+	const SerdStatus st = serd_reader_read_file(reader, USTR(file.c_str()));
+	serd_reader_free(reader);
+	if (st || catalog.plugins.empty()) {
+		return false; // Corrupt, so the caller will save over it
+	}
+
+	for (const auto& p : catalog.plugins) {
+		target.put(p.first, p.second);
+	}
+
+	// Mark as recently used so this version is requested next time
+	std::filesystem::last_write_time(
+		file, std::filesystem::file_time_type::clock::now(), ec);
+
+	return true;
+}
+
+bool
+PluginCache::save(const std::string&          version,
+                  const ClientStore::Plugins& plugins) const
+{
+	const FilePath file = path(version);
+	if (file.empty()) {
+		return false;
+	}
+
+	std::error_code ec;
+	std::filesystem::create_directories(_dir, ec);
+
+	// Write to a temporary file first so a catalog is never partial
+	FilePath tmp = file;
+	tmp += ".tmp";
+
+	std::unique_ptr<FILE, int (*)(FILE*)> out{fopen(tmp.c_str(), "w"),
+	                                          &fclose};
+	if (!out) {
+		return false;
+	}
+
+	SerdEnv*    env    = serd_env_new(nullptr);
+	SerdWriter* writer = serd_writer_new(SERD_TURTLE,
+	                                     SERD_STYLE_ABBREVIATED,
+	                                     env,
+	                                     nullptr,
+	                                     serd_file_sink,
+	                                     out.get());
+
+	Sratom* sratom = sratom_new(&_map.urid_map());
+	sratom_set_pretty_numbers(sratom, true);
+	sratom_set_sink(sratom,
+	                nullptr,
+	                reinterpret_cast<SerdStatementSink>(
+	                    serd_writer_write_statement),
+	                reinterpret_cast<SerdEndSink>(serd_writer_end_anon),
+	                writer);
+
+	const Forge& forge = _uris.forge;
+	for (const auto& p : plugins) {
+		const SerdNode subject =
+			serd_node_from_string(SERD_URI, USTR(p.first.c_str()));
+
+		const Properties::value_type* last = nullptr;
+		for (const auto& prop : p.second->properties()) {
+			const Atom&    value = prop.second;
+			const LV2_URID type  = value.type();
+			if ((type != forge.Int && type != forge.Float &&
+			     type != forge.Bool && type != forge.String &&
+			     type != forge.URID && type != forge.URI) ||
+			    (last && last->first == prop.first && last->second == value)) {
+				continue; // Not a simple value, or a duplicate
+			}
+
+			const SerdNode predicate =
+				serd_node_from_string(SERD_URI, USTR(prop.first.c_str()));
+
+			if (type == forge.URI) {
+				// Sratom writes URIs like URIDs, so type them to load them back
+				const SerdNode object =
+					serd_node_from_string(SERD_LITERAL, USTR(value.ptr<char>()));
+				const SerdNode datatype =
+					serd_node_from_string(SERD_URI, USTR(LV2_ATOM__URI));
+
+				serd_writer_write_statement(writer, 0, nullptr, &subject,
+				                            &predicate, &object, &datatype,
+				                            nullptr);
+			} else {
+				sratom_write(sratom, &_map.urid_unmap(), 0, &subject,
+				             &predicate, type, value.size(), value.get_body());
+			}
+			last = &prop;
+		}
+	}
+
+	serd_writer_finish(writer);
+	sratom_free(sratom);
+	serd_writer_free(writer);
+	serd_env_free(env);
+
+	if (fclose(out.release())) {
+		std::filesystem::remove(tmp, ec);
+		return false;
+	}
+
+	std::filesystem::rename(tmp, file, ec);
+	if (ec) {
+		std::filesystem::remove(tmp, ec);
+		return false;
+	}
+
+	// Remove the least recently used catalogs beyond the limit
+	std::vector<std::pair<std::filesystem::file_time_type, FilePath>> files;
+	for (const auto& e : std::filesystem::directory_iterator{_dir, ec}) {
+		if (e.path().extension() == ".ttl") {
+			files.emplace_back(e.last_write_time(ec), e.path());
+		}
+	}
+
+	if (files.size() > max_catalogs) {
+		std::sort(files.begin(), files.end());
+		for (size_t i = 0U; i < files.size() - max_catalogs; ++i) {
+			std::filesystem::remove(files[i].second, ec);
+		}
+	}
+
+	return true;
+}
+
+} // namespace ingen::client
@@ -44,10 +44,12 @@
 #include <ingen/URIs.hpp>
 #include <ingen/World.hpp>
 #include <ingen/client/ClientStore.hpp>
+#include <ingen/client/PluginCache.hpp>
 #include <ingen/client/PluginModel.hpp>
 #include <ingen/client/PortModel.hpp>
 #include <ingen/client/SigClientInterface.hpp>
 #include <ingen/fmt.hpp>
+#include <ingen/paths.hpp>
 #include <ingen/runtime_paths.hpp>
 #include <lilv/lilv.h>
 #include <lv2/urid/urid.h>
@@ -187,6 +189,14 @@ App::attach(const std::shared_ptr<ingen::Interface>& client)
 		_world.set_store(_store);
 	}
 
+	if (!_world.engine()) {
+		// Cache the plugins of remote engines to speed up reconnecting
+		_store->set_plugin_cache(std::make_shared<client::PluginCache>(
+			_world.uri_map(),
+			_world.uris(),
+			user_data_dir() / "ingen" / "plugins"));
+	}
+
 	if (_world.conf().option("dump").get<int32_t>()) {
 		_dumper = std::make_shared<StreamWriter>(_world.uri_map(),
 		                                         _world.uris(),
@@ -220,7 +230,8 @@ void
 App::request_plugins_if_necessary()
 {
 	if (!_requested_plugins) {
-		_world.interface()->get(URI("ingen:/plugins"));
+		const auto cache = _store ? _store->plugin_cache() : nullptr;
+		_world.interface()->get(cache ? cache->request_uri() : plugins_uri());
 		_requested_plugins = true;
 	}
 }
@@ -336,6 +347,11 @@ App::property_change(const URI&      subject,
 		_mean_run_load = value.get<float>();
 	} else if (key == uris().ingen_maxRunLoad && value.type() == forge().Float) {
 		_max_run_load = value.get<float>();
+	} else if (key == uris().ingen_deferredEvents && value.type() == forge().Int) {
+		_deferred_events = value.get<int32_t>();
+	} else if (key == uris().ingen_queueDepth ||
+	           key == uris().ingen_maxQueueDepth) {
+		return; // Only of interest to monitoring tools
 	} else {
 		_world.log().warn("Unknown engine property %1%\n", key);
 		return;
@@ -367,12 +383,18 @@ fraction_label(float f)
 std::string
 App::status_text() const
 {
-	return fmt(
+	std::string text = fmt(
 		"%2.1f kHz / %.1f ms, %s, %s DSP",
 		(_sample_rate / 1e3f),
 		(_block_length * 1e3f / static_cast<float>(_sample_rate)),
 		((_n_threads == 1) ? "1 thread" : fmt("%1% threads", _n_threads)),
 		fraction_label(_max_run_load));
+
+	if (_deferred_events > 0) {
+		text += fmt(", %1% deferred events", _deferred_events);
+	}
+
+	return text;
 }
 
 void
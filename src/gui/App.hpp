@@ -189,6 +189,7 @@ protected:
 	float       _mean_run_load{0.0f};
 	float       _min_run_load{0.0f};
 	float       _max_run_load{0.0f};
+	int32_t     _deferred_events{0};
 	std::string _status_text;
 
 	using ActivityPorts = std::unordered_map<Port*, bool>;
@@ -122,6 +122,24 @@
 #		endif
 #	endif
 
+// Linux epoll
+#	ifndef HAVE_EPOLL
+#		ifdef __has_include
+#			if __has_include("sys/epoll.h")
+#				define HAVE_EPOLL HAVE_SOCKET
+#			else
+#				define HAVE_EPOLL 0
+#			endif
+#		else
+#			define HAVE_EPOLL 0
+#		endif
+#	endif
+
+// Shared memory transport (Linux memfd_create)
+#	ifndef HAVE_SHM
+#		define HAVE_SHM HAVE_EPOLL
+#	endif
+
 // Webkit
 #	ifndef HAVE_WEBKIT
 #		ifdef __has_include
@@ -180,6 +198,18 @@
 #	define USE_SOCKET 0
 #endif
 
+#if defined(HAVE_EPOLL)
+#	define USE_EPOLL HAVE_EPOLL
+#else
+#	define USE_EPOLL 0
+#endif
+
+#if defined(HAVE_SHM)
+#	define USE_SHM HAVE_SHM
+#else
+#	define USE_SHM 0
+#endif
+
 #if defined(HAVE_VASPRINTF)
 #	define USE_VASPRINTF HAVE_VASPRINTF
 #else
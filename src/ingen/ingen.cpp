@@ -33,6 +33,9 @@
 #if USE_SOCKET
 #include "ingen/client/SocketClient.hpp"
 #endif
+#if USE_SHM
+#include "ingen/client/ShmClient.hpp"
+#endif
 
 #include <chrono>
 #include <csignal>
@@ -138,6 +141,9 @@ run(int argc, char** argv)
 #if USE_SOCKET
 	client::SocketClient::register_factories(*world);
 #endif
+#if USE_SHM
+	client::ShmClient::register_factories(*world);
+#endif
 
 	// Load GUI if requested
 	if (conf.option("gui").get<int32_t>()) {
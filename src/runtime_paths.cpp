@@ -138,6 +138,20 @@ ingen_module_path(const std::string& name)
 		ingen_module_dirs());
 }
 
+FilePath
+user_cache_dir()
+{
+	if (const char* xdg_cache_home = getenv("XDG_CACHE_HOME")) {
+		return {xdg_cache_home};
+	}
+
+	if (const char* home = getenv("HOME")) {
+		return FilePath(home) / ".cache";
+	}
+
+	return {};
+}
+
 FilePath
 user_config_dir()
 {
@@ -21,12 +21,20 @@
 #include "PluginImpl.hpp"
 #include "PortType.hpp"
 #include "ThreadManager.hpp"
+#include "ingen_config.h"
 
+#include <ingen/Atom.hpp>
+#include <ingen/Configuration.hpp>
+#include <ingen/FilePath.hpp>
+#include <ingen/Forge.hpp>
 #include <ingen/LV2Features.hpp>
 #include <ingen/Log.hpp>
+#include <ingen/Properties.hpp>
 #include <ingen/URI.hpp>
+#include <ingen/URIMap.hpp>
 #include <ingen/URIs.hpp>
 #include <ingen/World.hpp>
+#include <ingen/runtime_paths.hpp>
 #include <internals/BlockDelay.hpp>
 #include <internals/Controller.hpp>
 #include <internals/Note.hpp>
@@ -35,19 +43,110 @@
 #include <lilv/lilv.h>
 
 #include <algorithm>
+#include <cinttypes>
+#include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iterator>
 #include <memory>
+#include <sstream>
 #include <string>
+#include <system_error>
 #include <utility>
 #include <vector>
 
 namespace ingen::server {
+namespace {
+
+/// First line of a discovery cache, which is discarded if this differs
+const std::string discovery_cache_header =
+    std::string("ingen-lv2-discovery\t") + INGEN_VERSION;
+
+constexpr uint64_t fnv_offset = 14695981039346656037U;
+
+/// Return `hash` updated with `len` bytes at `buf` using 64-bit FNV-1a
+uint64_t
+fnv1a(uint64_t hash, const void* buf, const size_t len)
+{
+	const auto* const bytes = static_cast<const uint8_t*>(buf);
+	for (size_t i = 0U; i < len; ++i) {
+		hash = (hash ^ bytes[i]) * 1099511628211U;
+	}
+	return hash;
+}
+
+/** Return a hash of the names, sizes, and times of the files in a bundle.
+ *
+ * This is zero if the bundle can not be read, which matches nothing.
+ */
+uint64_t
+bundle_stamp(const std::string& dir)
+{
+	namespace fs = std::filesystem;
+
+	std::error_code ec;
+	uint64_t        stamp = 0U;
+	for (fs::directory_iterator i{dir, ec}, end; !ec && i != end;
+	     i.increment(ec)) {
+		const std::string name = i->path().filename().string();
+		const auto        time = static_cast<int64_t>(
+		    i->last_write_time(ec).time_since_epoch().count());
+		const auto size = static_cast<uint64_t>(
+		    i->is_regular_file(ec) ? i->file_size(ec) : 0U);
+
+		// Sum the entries so that the order of iteration doesn't matter
+		uint64_t hash = fnv1a(fnv_offset, name.data(), name.size());
+		hash          = fnv1a(hash, &time, sizeof(time));
+		stamp += fnv1a(hash, &size, sizeof(size));
+	}
+
+	return ec ? 0U : stamp;
+}
+
+std::string
+bundle_path(const LilvPlugin* plugin)
+{
+	const LilvNode* const bundle = lilv_plugin_get_bundle_uri(plugin);
+	char* const path = lilv_file_uri_parse(lilv_node_as_uri(bundle), nullptr);
+
+	std::string result{path ? path : ""};
+	lilv_free(path);
+	return result;
+}
+
+/// Split a line into tab-separated fields, including empty ones
+std::vector<std::string>
+split_fields(const std::string& line)
+{
+	std::vector<std::string> fields;
+	for (size_t start = 0U;;) {
+		const size_t end = line.find('\t', start);
+		fields.push_back(line.substr(start, end - start));
+		if (end == std::string::npos) {
+			return fields;
+		}
+		start = end + 1U;
+	}
+}
+
+} // namespace
 
 BlockFactory::BlockFactory(ingen::World& world)
 	: _world(world)
 {
+	const Atom& cache = world.conf().option("plugin-cache");
+	if (cache.is_valid()) {
+		_discovery_cache = FilePath{cache.ptr<char>()};
+	} else if (!user_cache_dir().empty()) {
+		_discovery_cache = user_cache_dir() / "ingen" / "lv2-discovery";
+	}
+
 	load_internal_plugins();
+	load_discovery_cache();
 }
 
 const BlockFactory::Plugins&
@@ -74,6 +173,7 @@ BlockFactory::refresh()
 	}
 
 	// Re-load plugins
+	_catalog_version.clear();
 	load_lv2_plugins();
 
 	// Add any new plugins to response
@@ -102,6 +202,50 @@ BlockFactory::plugin(const URI& uri)
 	return ((i != _plugins.end()) ? i->second.get() : nullptr);
 }
 
+const std::string&
+BlockFactory::catalog_version()
+{
+	if (!_catalog_version.empty()) {
+		return _catalog_version;
+	}
+
+	// Hash with 64-bit FNV-1a, each field followed by a null byte
+	uint64_t   hash = fnv_offset;
+	const auto add  = [&hash](const void* buf, const size_t len) {
+		hash = fnv1a(fnv1a(hash, buf, len), "", 1U);
+	};
+
+	const auto add_uri = [&add](const char* uri) {
+		add(uri, uri ? strlen(uri) : 0U);
+	};
+
+	// URIDs are local to this process, so hash the URIs they stand for
+	const URIMap& map  = _world.uri_map();
+	const URIs&   uris = _world.uris();
+	for (const auto& p : plugins()) {
+		const PluginImpl& plugin = *p.second;
+		add_uri(plugin.uri().c_str());
+		add_uri(map.unmap_uri(plugin.type().get<LV2_URID>()));
+		add_uri(plugin.is_zombie() ? "zombie" : "");
+
+		for (const auto& prop : plugin.properties()) {
+			const Atom& value = prop.second;
+			add_uri(prop.first.c_str());
+			add_uri(map.unmap_uri(value.type()));
+			if (value.type() == uris.atom_URID) {
+				add_uri(map.unmap_uri(value.get<LV2_URID>()));
+			} else {
+				add(value.get_body(), value.size());
+			}
+		}
+	}
+
+	char str[17];
+	snprintf(str, sizeof(str), "%016" PRIx64, hash);
+	_catalog_version = str;
+	return _catalog_version;
+}
+
 void
 BlockFactory::load_internal_plugins()
 {
@@ -138,11 +282,98 @@ BlockFactory::load_plugin(const URI& uri)
 	if (plug) {
 		auto* const ingen_plugin = new LV2Plugin(_world, plug);
 		_plugins.emplace(uri, ingen_plugin);
+		_catalog_version.clear();
 	}
 	lilv_node_free(node);
 }
 
+void
+BlockFactory::load_discovery_cache()
+{
+	std::ifstream file{_discovery_cache};
+	std::string   line;
+	if (_discovery_cache.empty() || !std::getline(file, line) ||
+	    line != discovery_cache_header) {
+		return;
+	}
+
+	// Each line is: URI, bundle, stamp, minor, micro, problem, features
+	while (std::getline(file, line)) {
+		const std::vector<std::string> fields = split_fields(line);
+		if (fields.size() != 7U || fields[0].empty()) {
+			continue;
+		}
+
+		Discovery discovery;
+		discovery.bundle  = fields[1];
+		discovery.stamp   = strtoull(fields[2].c_str(), nullptr, 16);
+		discovery.minor   =
+		    static_cast<int32_t>(strtol(fields[3].c_str(), nullptr, 10));
+		discovery.micro   =
+		    static_cast<int32_t>(strtol(fields[4].c_str(), nullptr, 10));
+		discovery.problem = fields[5];
+
+		std::istringstream features{fields[6]};
+		std::string        feature;
+		while (features >> feature) {
+			discovery.features.push_back(feature);
+		}
+
+		_discoveries.emplace(URI{fields[0]}, std::move(discovery));
+	}
+}
+
+void
+BlockFactory::save_discovery_cache() const
+{
+	if (_discovery_cache.empty()) {
+		return;
+	}
+
+	// Write to a temporary file and rename it so readers never see a partial
+	std::error_code ec;
+	std::filesystem::create_directories(_discovery_cache.parent_path(), ec);
+
+	const FilePath tmp{_discovery_cache.string() + ".tmp"};
+	{
+		std::ofstream file{tmp};
+		file << discovery_cache_header << '\n';
+		for (const auto& d : _discoveries) {
+			const Discovery& discovery = d.second;
+
+			char stamp[17];
+			snprintf(stamp, sizeof(stamp), "%016" PRIx64, discovery.stamp);
+
+			file << d.first << '\t' << discovery.bundle << '\t' << stamp
+			     << '\t' << discovery.minor << '\t' << discovery.micro << '\t'
+			     << discovery.problem << '\t';
+			for (size_t i = 0U; i < discovery.features.size(); ++i) {
+				file << (i ? " " : "") << discovery.features[i];
+			}
+			file << '\n';
+		}
+
+		if (!file.flush()) {
+			_world.log().warn("Failed to write plugin cache %1%\n",
+			                  tmp.string());
+			std::filesystem::remove(tmp, ec);
+			return;
+		}
+	}
+
+	std::filesystem::rename(tmp, _discovery_cache, ec);
+	if (ec) {
+		_world.log().warn("Failed to write plugin cache %1% (%2%)\n",
+		                  _discovery_cache.string(),
+		                  ec.message());
+		std::filesystem::remove(tmp, ec);
+	}
+}
+
 /** Loads information about all LV2 plugins into internal plugin database.
+ *
+ * Checking whether a plugin is supported makes lilv load its data files, so
+ * the results are reused from the discovery cache for unchanged bundles.
  */
 void
 BlockFactory::load_lv2_plugins()
@@ -158,67 +389,117 @@ BlockFactory::load_lv2_plugins()
 		    lilv_new_uri(_world.lilv_world(), uri.c_str()), lilv_node_free));
 	}
 
+	const URIs&                     uris = _world.uris();
+	std::map<std::string, uint64_t> stamps;
+	Discoveries                     discoveries;
+	bool                            changed = false;
+
 	const LilvPlugins* plugins = lilv_world_get_all_plugins(_world.lilv_world());
 	LILV_FOREACH (plugins, i, plugins) {
 		const LilvPlugin* lv2_plug = lilv_plugins_get(plugins, i);
 		const URI         uri(lilv_node_as_uri(lilv_plugin_get_uri(lv2_plug)));
 
-		// Ignore plugins that require features Ingen doesn't support
-		LilvNodes* features  = lilv_plugin_get_required_features(lv2_plug);
-		bool       supported = true;
-		LILV_FOREACH (nodes, f, features) {
-			const char* feature = lilv_node_as_uri(lilv_nodes_get(features, f));
-			if (!_world.lv2_features().is_supported(feature)) {
-				supported = false;
-				_world.log().warn("Ignoring <%1%>; required feature <%2%>\n",
-				                  uri, feature);
-				break;
-			}
+		// Stamp each bundle once, since a bundle may have many plugins
+		const std::string bundle = bundle_path(lv2_plug);
+		auto              s      = stamps.find(bundle);
+		if (s == stamps.end()) {
+			s = stamps.emplace(bundle, bundle_stamp(bundle)).first;
 		}
-		lilv_nodes_free(features);
-		if (!supported) {
-			continue;
+
+		const auto c      = _discoveries.find(uri);
+		const bool cached = (c != _discoveries.end() && s->second &&
+		                     c->second.bundle == bundle &&
+		                     c->second.stamp == s->second);
+
+		Discovery discovery;
+		if (cached) {
+			discovery = c->second;
+		} else {
+			changed          = true;
+			discovery.bundle = bundle;
+			discovery.stamp  = s->second;
+
+			LilvNodes* features = lilv_plugin_get_required_features(lv2_plug);
+			LILV_FOREACH (nodes, f, features) {
+				discovery.features.emplace_back(
+				    lilv_node_as_uri(lilv_nodes_get(features, f)));
+			}
+			lilv_nodes_free(features);
+
+			const uint32_t n_ports = lilv_plugin_get_num_ports(lv2_plug);
+			if (!lilv_plugin_get_port_by_index(lv2_plug, 0)) {
+				discovery.problem = "missing or corrupt ports";
+			}
+
+			for (uint32_t p = 0; discovery.problem.empty() && p < n_ports; ++p) {
+				const LilvPort* port = lilv_plugin_get_port_by_index(lv2_plug, p);
+				const bool      supported =
+				    std::any_of(types.begin(),
+				                types.end(),
+				                [&lv2_plug, &port](const auto& t) {
+					                return lilv_port_is_a(lv2_plug, port, t.get());
+				                });
+
+				if (!supported &&
+				    !lilv_port_has_property(lv2_plug,
+				                            port,
+				                            uris.lv2_connectionOptional)) {
+					discovery.problem =
+					    std::string("unsupported port <") +
+					    lilv_node_as_string(lilv_port_get_symbol(lv2_plug, port)) +
+					    ">";
+				}
+			}
 		}
 
-		// Ignore plugins that are missing ports
-		if (!lilv_plugin_get_port_by_index(lv2_plug, 0)) {
-			_world.log().warn("Ignoring <%1%>; missing or corrupt ports\n",
-			                  uri);
+		auto& d = discoveries.emplace(uri, std::move(discovery)).first->second;
+
+		// Ignore plugins that require features Ingen doesn't support
+		const auto f = std::find_if(
+		    d.features.begin(), d.features.end(), [this](const auto& feature) {
+			    return !_world.lv2_features().is_supported(feature);
+		    });
+		if (f != d.features.end()) {
+			_world.log().warn("Ignoring <%1%>; required feature <%2%>\n",
+			                  uri, *f);
 			continue;
 		}
 
-		const uint32_t n_ports = lilv_plugin_get_num_ports(lv2_plug);
-		for (uint32_t p = 0; p < n_ports; ++p) {
-			const LilvPort* port = lilv_plugin_get_port_by_index(lv2_plug, p);
-			supported =
-			    std::any_of(types.begin(),
-			                types.end(),
-			                [&lv2_plug, &port](const auto& t) {
-				                return lilv_port_is_a(lv2_plug, port, t.get());
-			                });
-
-			if (!supported &&
-			    !lilv_port_has_property(lv2_plug,
-			                            port,
-			                            _world.uris().lv2_connectionOptional)) {
-				_world.log().warn("Ignoring <%1%>; unsupported port <%2%>\n",
-				                  uri,
-				                  lilv_node_as_string(
-					                  lilv_port_get_symbol(lv2_plug, port)));
-				break;
-			}
-		}
-		if (!supported) {
+		// Ignore plugins that are missing ports or have unsupported ones
+		if (!d.problem.empty()) {
+			_world.log().warn("Ignoring <%1%>; %2%\n", uri, d.problem);
 			continue;
 		}
 
 		auto p = _plugins.find(uri);
 		if (p == _plugins.end()) {
 			auto* const plugin = new LV2Plugin(_world, lv2_plug);
-			_plugins.emplace(uri, plugin);
+			if (cached && d.minor >= 0 && d.micro >= 0) {
+				// The version is in the data files which lilv hasn't loaded
+				plugin->set_property(uris.lv2_minorVersion,
+				                     _world.forge().make(d.minor));
+				plugin->set_property(uris.lv2_microVersion,
+				                     _world.forge().make(d.micro));
+			}
+			p = _plugins.emplace(uri, plugin).first;
 		} else if (lilv_plugin_verify(lv2_plug)) {
 			p->second->set_is_zombie(false);
 		}
+
+		if (!cached) {
+			const Atom& minor = p->second->get_property(uris.lv2_minorVersion);
+			const Atom& micro = p->second->get_property(uris.lv2_microVersion);
+			if (minor.type() == uris.atom_Int && micro.type() == uris.atom_Int) {
+				d.minor = minor.get<int32_t>();
+				d.micro = micro.get<int32_t>();
+			}
+		}
+	}
+
+	// Save the cache if anything was discovered or has gone away
+	if (changed || discoveries.size() != _discoveries.size()) {
+		_discoveries = std::move(discoveries);
+		save_discovery_cache();
 	}
 
 	_world.log().info("Loaded %1% plugins\n", _plugins.size());
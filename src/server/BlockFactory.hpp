@@ -17,12 +17,16 @@
 #ifndef INGEN_ENGINE_BLOCKFACTORY_HPP
 #define INGEN_ENGINE_BLOCKFACTORY_HPP
 
+#include <ingen/FilePath.hpp>
 #include <ingen/URI.hpp>
 #include <raul/Noncopyable.hpp>
 
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <set>
+#include <string>
+#include <vector>
 
 namespace ingen {
 
@@ -56,12 +60,42 @@ public:
 
 	PluginImpl* plugin(const URI& uri);
 
+	/** Return a hash of all plugins and their properties as a hex string.
+	 *
+	 * This changes whenever the plugins sent to clients would, and is the
+	 * same for the same plugins in another process, so clients can use it
+	 * to cache the plugin catalog.
+	 */
+	const std::string& catalog_version();
+
 private:
+	/** What discovery found out about an LV2 plugin.
+	 *
+	 * Finding this out requires lilv to parse the plugin's data files, so it
+	 * is cached on disk and reused while the plugin's bundle is unchanged.
+	 */
+	struct Discovery {
+		std::string              bundle;    ///< Bundle directory
+		uint64_t                 stamp{0U}; ///< Bundle contents, see bundle_stamp
+		std::vector<std::string> features;  ///< Required features
+		std::string              problem;   ///< Why it is unusable, or empty
+		int32_t                  minor{-1}; ///< lv2:minorVersion, or -1
+		int32_t                  micro{-1}; ///< lv2:microVersion, or -1
+	};
+
+	using Discoveries = std::map<URI, Discovery>;
+
 	void load_lv2_plugins();
 	void load_internal_plugins();
 
+	void load_discovery_cache();
+	void save_discovery_cache() const;
+
 	Plugins       _plugins;
+	Discoveries   _discoveries;
 	ingen::World& _world;
+	FilePath      _discovery_cache; ///< Empty if disabled
+	std::string   _catalog_version; ///< Cached, empty if outdated
 	bool          _has_loaded{false};
 };
 
@@ -18,20 +18,101 @@
 
 #include "BlockFactory.hpp"
 #include "PluginImpl.hpp"
+#include "PortImpl.hpp"
 
 #include <ingen/Interface.hpp>
+#include <ingen/Message.hpp>
+#include <ingen/Node.hpp>
+#include <ingen/Store.hpp>
+#include <ingen/URI.hpp>
+#include <ingen/ingen.h>
+#include <ingen/paths.hpp>
+#include <raul/Path.hpp>
 
+#include <algorithm>
 #include <cstddef>
+#include <cstring>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <utility>
+#include <variant>
 
 namespace ingen::server {
 
+namespace {
+
+/** Return true iff `path` is `root` or a descendant of it. */
+bool
+in_subtree(std::string_view root, std::string_view path)
+{
+	if (root == "/" || path == root) {
+		return true;
+	}
+
+	return path.size() > root.size() && path[root.size()] == '/' &&
+	       path.substr(0, root.size()) == root;
+}
+
+bool
+path_wanted(const std::vector<std::string>& roots, std::string_view path)
+{
+	if (roots.empty()) {
+		return true;
+	}
+
+	return std::any_of(roots.begin(), roots.end(), [path](const auto& root) {
+		return in_subtree(root, path);
+	});
+}
+
+/** Return true iff a message about `uri` passes the path filter.
+ *
+ * Only graph objects can be filtered, anything else (plugins, clients, the
+ * engine) is always delivered.
+ */
+bool
+uri_wanted(const std::vector<std::string>& roots, const URI& uri)
+{
+	static constexpr std::string_view main_prefix{"ingen:/main"};
+
+	if (roots.empty()) {
+		return true;
+	}
+
+	const std::string_view str{uri.c_str()};
+	if (str.substr(0, main_prefix.size()) != main_prefix) {
+		return true;
+	}
+
+	const std::string_view rest = str.substr(main_prefix.size());
+	if (rest.empty()) {
+		return path_wanted(roots, "/");
+	}
+
+	return rest[0] != '/' || path_wanted(roots, rest);
+}
+
+bool
+property_wanted(const std::vector<std::string>& properties, const char* key)
+{
+	if (properties.empty()) {
+		return true;
+	}
+
+	return std::any_of(properties.begin(),
+	                   properties.end(),
+	                   [key](const auto& p) { return p == key; });
+}
+
+} // namespace
+
 Broadcaster::~Broadcaster()
 {
 	const std::lock_guard<std::mutex> lock{_clients_mutex};
 	_clients.clear();
 	_broadcastees.clear();
+	_subscriptions.clear();
 }
 
 /** Register a client to receive messages over the notification band.
@@ -53,6 +134,8 @@ Broadcaster::unregister_client(const std::shared_ptr<Interface>& client)
 	const std::lock_guard<std::mutex> lock{_clients_mutex};
 	const size_t erased = _clients.erase(client);
 	_broadcastees.erase(client);
+	_subscriptions.erase(client);
+	_must_broadcast.store(!_broadcastees.empty());
 	return (erased > 0);
 }
 
@@ -60,6 +143,7 @@ void
 Broadcaster::set_broadcast(const std::shared_ptr<Interface>& client,
                            bool                              broadcast)
 {
+	const std::lock_guard<std::mutex> lock{_clients_mutex};
 	if (broadcast) {
 		_broadcastees.insert(client);
 	} else {
@@ -68,6 +152,182 @@ Broadcaster::set_broadcast(const std::shared_ptr<Interface>& client,
 	_must_broadcast.store(!_broadcastees.empty());
 }
 
+raul::Path
+Broadcaster::subscribe(const std::shared_ptr<Interface>& client,
+                       Filter                            filter,
+                       const URI&                        uri)
+{
+	std::string entry{uri.string()};
+	if (filter == Filter::PATH) {
+		if (!uri_is_path(uri)) {
+			return raul::Path{"/"};
+		}
+
+		entry = uri_to_path(uri).string();
+	}
+
+	const std::lock_guard<std::mutex> lock{_clients_mutex};
+
+	Subscription& sub = _subscriptions[client];
+	auto& list = (filter == Filter::PATH) ? sub.paths : sub.properties;
+
+	// Only widening an existing path filter leaves other subtrees alone
+	const bool narrows = list.empty();
+	if (std::find(list.begin(), list.end(), entry) == list.end()) {
+		list.push_back(entry);
+	}
+
+	return (filter == Filter::PATH && !narrows) ? raul::Path{entry}
+	                                            : raul::Path{"/"};
+}
+
+raul::Path
+Broadcaster::unsubscribe(const std::shared_ptr<Interface>& client,
+                         Filter                            filter,
+                         const URI*                        uri)
+{
+	const std::lock_guard<std::mutex> lock{_clients_mutex};
+
+	const auto s = _subscriptions.find(client);
+	if (s == _subscriptions.end()) {
+		return raul::Path{"/"};
+	}
+
+	Subscription& sub  = s->second;
+	auto&         list = (filter == Filter::PATH) ? sub.paths : sub.properties;
+	raul::Path    root{"/"};
+	if (!uri) {
+		list.clear();
+	} else {
+		const bool        is_path = filter == Filter::PATH && uri_is_path(*uri);
+		const std::string entry   = is_path ? uri_to_path(*uri).string()
+		                                    : uri->string();
+
+		list.erase(std::remove(list.begin(), list.end(), entry), list.end());
+		if (is_path && !list.empty()) {
+			root = raul::Path{entry};
+		}
+	}
+
+	if (sub.paths.empty() && sub.properties.empty()) {
+		_subscriptions.erase(s);
+	}
+
+	return root;
+}
+
+bool
+Broadcaster::is_subscribed(const raul::Path& path) const
+{
+	const std::lock_guard<std::mutex> lock{_clients_mutex};
+
+	return wants_port(path);
+}
+
+bool
+Broadcaster::wants_port(const raul::Path& path) const
+{
+	for (const auto& c : _broadcastees) {
+		const auto s = _subscriptions.find(c);
+		if (s == _subscriptions.end()) {
+			return true;
+		}
+
+		const Subscription& sub = s->second;
+		if (path_wanted(sub.paths, path.c_str()) &&
+		    (property_wanted(sub.properties, INGEN__value) ||
+		     property_wanted(sub.properties, INGEN__activity))) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void
+Broadcaster::subscribe_ports(Store& store, const raul::Path& root) const
+{
+	const auto top = store.find(root);
+	if (top == store.end()) {
+		return;
+	}
+
+	const auto                        last = store.find_descendants_end(top);
+	const std::lock_guard<std::mutex> lock{_clients_mutex};
+
+	for (auto o = top; o != last; ++o) {
+		if (o->second->graph_type() == Node::GraphType::PORT) {
+			auto* const port = static_cast<PortImpl*>(o->second.get());
+			port->set_subscribed(wants_port(o->first));
+		}
+	}
+}
+
+bool
+Broadcaster::wants(const Subscription& sub, const Message& msg)
+{
+	const auto& paths = sub.paths;
+
+	if (const auto* const m = std::get_if<SetProperty>(&msg)) {
+		return property_wanted(sub.properties, m->predicate.c_str()) &&
+		       uri_wanted(paths, m->subject);
+	}
+
+	if (const auto* const m = std::get_if<Put>(&msg)) {
+		return uri_wanted(paths, m->uri);
+	}
+
+	if (const auto* const m = std::get_if<Delta>(&msg)) {
+		return uri_wanted(paths, m->uri);
+	}
+
+	if (const auto* const m = std::get_if<Del>(&msg)) {
+		return uri_wanted(paths, m->uri);
+	}
+
+	if (const auto* const m = std::get_if<Copy>(&msg)) {
+		return uri_wanted(paths, m->old_uri) || uri_wanted(paths, m->new_uri);
+	}
+
+	if (const auto* const m = std::get_if<Connect>(&msg)) {
+		return path_wanted(paths, m->tail.c_str()) ||
+		       path_wanted(paths, m->head.c_str());
+	}
+
+	if (const auto* const m = std::get_if<Disconnect>(&msg)) {
+		return path_wanted(paths, m->tail.c_str()) ||
+		       path_wanted(paths, m->head.c_str());
+	}
+
+	if (const auto* const m = std::get_if<DisconnectAll>(&msg)) {
+		return path_wanted(paths, m->graph.c_str()) ||
+		       path_wanted(paths, m->path.c_str());
+	}
+
+	if (const auto* const m = std::get_if<Move>(&msg)) {
+		return path_wanted(paths, m->old_path.c_str()) ||
+		       path_wanted(paths, m->new_path.c_str());
+	}
+
+	return true;
+}
+
+void
+Broadcaster::message(const Message& msg)
+{
+	const std::lock_guard<std::mutex> lock{_clients_mutex};
+	for (const auto& c : _clients) {
+		if (c == _ignore_client) {
+			continue;
+		}
+
+		const auto s = _subscriptions.find(c);
+		if (s == _subscriptions.end() || wants(s->second, msg)) {
+			c->message(msg);
+		}
+	}
+}
+
 void
 Broadcaster::send_plugins(const BlockFactory::Plugins& plugins)
 {
@@ -23,11 +23,21 @@
 #include <ingen/Message.hpp>
 #include <ingen/URI.hpp>
 #include <raul/Noncopyable.hpp>
+#include <raul/Path.hpp>
 
 #include <atomic>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <set>
+#include <string>
+#include <vector>
+
+namespace ingen {
+
+class Store;
+
+} // namespace ingen
 
 namespace ingen::server {
 
@@ -50,6 +60,46 @@ public:
 	void
 	set_broadcast(const std::shared_ptr<Interface>& client, bool broadcast);
 
+	/** Kind of subscription filter a client may set. */
+	enum class Filter {
+		PATH,     ///< Only receive messages about a graph subtree
+		PROPERTY, ///< Only receive property sets of a given predicate
+	};
+
+	/** Add a filter to the subscription of a client.
+	 *
+	 * A client without any filter of a kind receives every message, so the
+	 * first subscription narrows the stream, and later ones widen it again.
+	 *
+	 * @return The root of the subtree whose port subscriptions may change.
+	 */
+	raul::Path subscribe(const std::shared_ptr<Interface>& client,
+	               Filter                            filter,
+	               const URI&                        uri);
+
+	/** Remove a filter from the subscription of a client.
+	 *
+	 * If `uri` is null, all filters of the given kind are removed.
+	 *
+	 * @return The root of the subtree whose port subscriptions may change.
+	 */
+	raul::Path unsubscribe(const std::shared_ptr<Interface>& client,
+	                 Filter                            filter,
+	                 const URI*                        uri);
+
+	/** Return true iff any broadcasting client wants values of a port.
+	 *
+	 * This is used to decide which ports calculate notifications in the
+	 * audio thread, it is called only in the pre-processor.
+	 */
+	bool is_subscribed(const raul::Path& path) const;
+
+	/** Update the subscribed flag of every port at or under `root`.
+	 *
+	 * The store mutex must be held by the caller.
+	 */
+	void subscribe_ports(Store& store, const raul::Path& root) const;
+
 	/** Ignore a client when broadcasting.
 	 *
 	 * This is used to prevent feeding back updates to the client that
@@ -96,24 +146,30 @@ public:
 	static void
 	send_plugins_to(Interface*, const BlockFactory::Plugins& plugins);
 
-	void message(const Message& msg) override {
-		const std::lock_guard<std::mutex> lock{_clients_mutex};
-		for (const auto& c : _clients) {
-			if (c != _ignore_client) {
-				c->message(msg);
-			}
-		}
-	}
+	void message(const Message& msg) override;
 
 	URI uri() const override { return URI("ingen:/broadcaster"); }
 
 private:
 	friend class Transfer;
 
-	using Clients = std::set<std::shared_ptr<Interface>>;
+	/** Graph subtrees and predicates a client is interested in. */
+	struct Subscription {
+		std::vector<std::string> paths;
+		std::vector<std::string> properties;
+	};
+
+	using Clients       = std::set<std::shared_ptr<Interface>>;
+	using Subscriptions = std::map<std::shared_ptr<Interface>, Subscription>;
+
+	static bool wants(const Subscription& sub, const Message& msg);
+
+	/** Like is_subscribed(), but the clients mutex must be held. */
+	bool wants_port(const raul::Path& path) const;
 
-	std::mutex                           _clients_mutex;
+	mutable std::mutex                   _clients_mutex;
 	Clients                              _clients;
+	Subscriptions                        _subscriptions;
 	std::set<std::shared_ptr<Interface>> _broadcastees;
 	std::atomic<bool>                    _must_broadcast{false};
 	unsigned                             _bundle_depth{0};
@@ -190,7 +190,8 @@ Buffer::port_data(PortType port_type, SampleCount offset)
 {
 	switch (port_type) {
 	case PortType::CONTROL:
-		return &_value_buffer->get<LV2_Atom_Float>()->body;
+		return _value_buffer ? &_value_buffer->get<LV2_Atom_Float>()->body
+		                     : nullptr;
 	case PortType::CV:
 	case PortType::AUDIO:
 		if (_type == _factory.uris().atom_Float) {
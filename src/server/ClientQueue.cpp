@@ -0,0 +1,416 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2016 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ClientQueue.hpp"
+
+#include "ingen_config.h"
+
+#include <ingen/Interface.hpp>
+#include <ingen/Log.hpp>
+#include <ingen/Message.hpp>
+#include <ingen/URI.hpp>
+#include <ingen/URIs.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <utility>
+#include <variant>
+
+#if USE_EPOLL
+#    include <sys/epoll.h>
+#    include <unistd.h>
+#endif
+
+namespace ingen::server {
+namespace {
+
+/// Maximum time the poller sleeps before checking whether to exit
+constexpr int poll_timeout_ms = 100;
+
+bool
+same_uri(const URI& lhs, const URI& rhs)
+{
+	return !strcmp(lhs.c_str(), rhs.c_str());
+}
+
+size_t
+property_key(const SetProperty& set)
+{
+	const std::hash<std::string_view> hash;
+
+	return (hash(set.subject.c_str()) * 31U + hash(set.predicate.c_str())) *
+	           31U +
+	       static_cast<size_t>(set.ctx);
+}
+
+} // namespace
+
+ClientWriterPool::ClientWriterPool(unsigned n_threads)
+{
+	for (unsigned i = 0U; i < std::max(n_threads, 1U); ++i) {
+		_threads.emplace_back(&ClientWriterPool::run, this);
+	}
+
+#if USE_EPOLL
+	_epoll = epoll_create1(EPOLL_CLOEXEC);
+	if (_epoll >= 0) {
+		_poller = std::thread(&ClientWriterPool::poll, this);
+	}
+#endif
+}
+
+ClientWriterPool::~ClientWriterPool()
+{
+	{
+		const std::lock_guard<std::mutex> lock{_mutex};
+		_exit_flag = true;
+	}
+
+	_ready.notify_all();
+	for (auto& thread : _threads) {
+		thread.join();
+	}
+
+	if (_poller.joinable()) {
+		_poller.join();
+	}
+
+#if USE_EPOLL
+	if (_epoll >= 0) {
+		close(_epoll);
+	}
+#endif
+}
+
+void
+ClientWriterPool::schedule(std::weak_ptr<ClientQueue> queue)
+{
+	{
+		const std::lock_guard<std::mutex> lock{_mutex};
+		_queues.push_back(std::move(queue));
+	}
+
+	_ready.notify_one();
+}
+
+void
+ClientWriterPool::wait_writable(const int                    fd,
+                                std::shared_ptr<ClientQueue> queue)
+{
+#if USE_EPOLL
+	if (_epoll >= 0) {
+		{
+			const std::lock_guard<std::mutex> lock{_mutex};
+			_waiting[fd] = queue;
+		}
+
+		epoll_event event{};
+		event.events  = EPOLLOUT | EPOLLONESHOT;
+		event.data.fd = fd;
+		if (!epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &event)) {
+			return;
+		}
+
+		const std::lock_guard<std::mutex> lock{_mutex};
+		_waiting.erase(fd);
+	}
+#endif
+
+	schedule(queue); // Can't wait, so simply try again
+}
+
+void
+ClientWriterPool::poll()
+{
+#if USE_EPOLL
+	while (!_exit_flag) {
+		epoll_event event{};
+		if (epoll_wait(_epoll, &event, 1, poll_timeout_ms) != 1) {
+			continue;
+		}
+
+		const int                    fd = event.data.fd;
+		std::shared_ptr<ClientQueue> queue;
+		{
+			const std::lock_guard<std::mutex> lock{_mutex};
+			const auto                        w = _waiting.find(fd);
+			if (w != _waiting.end()) {
+				queue = std::move(w->second);
+				_waiting.erase(w);
+			}
+		}
+
+		// Writable, or failed, which the next write will notice
+		epoll_ctl(_epoll, EPOLL_CTL_DEL, fd, nullptr);
+		if (queue) {
+			schedule(queue);
+		}
+	}
+#endif
+}
+
+void
+ClientWriterPool::run()
+{
+	std::unique_lock<std::mutex> lock{_mutex};
+	while (true) {
+		_ready.wait(lock, [this] { return _exit_flag || !_queues.empty(); });
+		if (_exit_flag) {
+			return;
+		}
+
+		// Hold the queue while writing, unless its client is already gone
+		const std::shared_ptr<ClientQueue> queue = _queues.front().lock();
+		_queues.pop_front();
+		if (queue) {
+			lock.unlock();
+			queue->write();
+			lock.lock();
+		}
+	}
+}
+
+ClientQueue::ClientQueue(std::shared_ptr<Interface> sink,
+                         ClientWriterPool&          writers,
+                         const URIs&                uris,
+                         Log&                       log,
+                         size_t                     capacity,
+                         Overflow                   overflow,
+                         std::function<void()>      disconnect,
+                         Flush                      flush)
+	: _sink(std::move(sink))
+	, _writers(writers)
+	, _uris(uris)
+	, _log(log)
+	, _capacity(std::max(capacity, size_t{1U}))
+	, _overflow(overflow)
+	, _disconnect(std::move(disconnect))
+	, _flush(std::move(flush))
+{}
+
+ClientQueue::~ClientQueue()
+{
+	_log.info("Closed <%1%> (at most %2% messages queued)\n",
+	          _sink->uri(),
+	          _max_depth);
+}
+
+ClientQueue::Overflow
+ClientQueue::parse_overflow(const char* name)
+{
+	if (!strcmp(name, "drop")) {
+		return Overflow::DROP;
+	}
+
+	if (!strcmp(name, "disconnect")) {
+		return Overflow::DISCONNECT;
+	}
+
+	return Overflow::BLOCK;
+}
+
+void
+ClientQueue::message(const Message& message)
+{
+	Lock lock{_mutex};
+
+	const auto* const set     = std::get_if<SetProperty>(&message);
+	const bool        monitor = set && is_monitored(*set);
+	const size_t      key     = monitor ? property_key(*set) : 0U;
+	if (monitor) {
+		if (coalesce(*set, key)) {
+			return; // Replaced the value of a queued set
+		}
+	} else {
+		_latest.clear(); // Keep later values after this message
+	}
+
+	while (!_closed && _messages.size() >= _capacity) {
+		if (_overflow == Overflow::DISCONNECT) {
+			_log.warn("Disconnecting <%1%> with %2% queued messages\n",
+			          _sink->uri(),
+			          _messages.size());
+
+			_closed = true;
+			_messages.clear();
+			lock.unlock();
+			_disconnect();
+			return;
+		}
+
+		if (_overflow == Overflow::DROP && drop_oldest_value()) {
+			break;
+		}
+
+		_space.wait(lock);
+	}
+
+	if (_closed) {
+		return;
+	}
+
+	_messages.emplace_back(message);
+	_max_depth = std::max(_max_depth, _messages.size());
+	if (monitor) {
+		_latest[key] = _messages.size() - 1U;
+	}
+
+	if (!_scheduled) {
+		_scheduled = true;
+		lock.unlock();
+		_writers.schedule(weak_from_this());
+	}
+}
+
+size_t
+ClientQueue::depth() const
+{
+	const std::lock_guard<std::mutex> lock{_mutex};
+	return _messages.size();
+}
+
+size_t
+ClientQueue::max_depth() const
+{
+	const std::lock_guard<std::mutex> lock{_mutex};
+	return _max_depth;
+}
+
+bool
+ClientQueue::is_monitored(const SetProperty& set) const
+{
+	return set.seq == 0 && (same_uri(set.predicate, _uris.ingen_value) ||
+	                        same_uri(set.predicate, _uris.ingen_activity));
+}
+
+bool
+ClientQueue::coalesce(const SetProperty& set, const size_t key)
+{
+	const auto l = _latest.find(key);
+	if (l == _latest.end()) {
+		return false;
+	}
+
+	auto* const queued = std::get_if<SetProperty>(&_messages[l->second]);
+	if (!queued || !same_uri(queued->subject, set.subject) ||
+	    !same_uri(queued->predicate, set.predicate) ||
+	    queued->ctx != set.ctx) {
+		return false; // Hash collision
+	}
+
+	queued->value = set.value;
+	return true;
+}
+
+bool
+ClientQueue::drop_oldest_value()
+{
+	/* Only monitored values without a sequence number are dropped, since the
+	   client will see a later one anyway, while anything else would leave it
+	   with an inconsistent view of the engine or waiting for a response. */
+	const auto i = std::find_if(_messages.begin(),
+	                            _messages.end(),
+	                            [this](const Message& msg) {
+		                            const auto* const set =
+		                                std::get_if<SetProperty>(&msg);
+		                            return set && is_monitored(*set);
+	                            });
+
+	if (i == _messages.end()) {
+		return false;
+	}
+
+	if (_n_dropped++ == 0U) {
+		_log.warn("Dropping messages to <%1%> with %2% queued\n",
+		          _sink->uri(),
+		          _messages.size());
+	}
+
+	_messages.erase(i);
+	_latest.clear(); // Indices have shifted
+	return true;
+}
+
+void
+ClientQueue::write()
+{
+	// Finish writing what the client didn't accept last time first
+	if (!flush()) {
+		return;
+	}
+
+	Lock lock{_mutex};
+	if (_n_dropped) {
+		_log.info("Dropped %1% messages to <%2%> (at most %3% queued)\n",
+		          _n_dropped,
+		          _sink->uri(),
+		          _max_depth);
+		_n_dropped = 0U;
+	}
+
+	// Write everything queued so far without holding the lock
+	std::deque<Message> batch;
+	batch.swap(_messages);
+	_latest.clear();
+	lock.unlock();
+	_space.notify_all();
+
+	for (auto m = batch.begin(); m != batch.end(); ++m) {
+		_sink->message(*m);
+		if (!flush()) {
+			// Requeue the rest to write once the client has caught up
+			lock.lock();
+			_messages.insert(_messages.begin(), std::next(m), batch.end());
+			_latest.clear(); // Indices have shifted
+			return;
+		}
+	}
+
+	// Wait for another turn if more arrived meanwhile
+	lock.lock();
+	if (_messages.empty()) {
+		_scheduled = false;
+	} else {
+		lock.unlock();
+		_writers.schedule(weak_from_this());
+	}
+}
+
+/** Write what the sink buffered, or return false and wait until it can be.
+ *
+ * While waiting, the queue stays scheduled, so it is only written again once
+ * the writer pool finds the client writable.
+ */
+bool
+ClientQueue::flush()
+{
+	const int fd = _flush ? _flush() : -1;
+	if (fd < 0) {
+		return true;
+	}
+
+	_writers.wait_writable(fd, shared_from_this());
+	return false;
+}
+
+} // namespace ingen::server
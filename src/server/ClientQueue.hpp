@@ -0,0 +1,194 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2016 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INGEN_ENGINE_CLIENTQUEUE_HPP
+#define INGEN_ENGINE_CLIENTQUEUE_HPP
+
+#include <ingen/Interface.hpp>
+#include <ingen/Message.hpp>
+#include <ingen/URI.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ingen {
+
+class Log;
+class URIs;
+
+namespace server {
+
+class ClientQueue;
+
+/** A fixed set of threads that write queued messages to remote clients.
+ *
+ * A client queue is scheduled here whenever it has messages to write, and is
+ * only written by one thread at a time.  Each thread writes a single batch
+ * before moving on, so busy clients take turns with quiet ones.
+ *
+ * Where epoll is available, sockets are written without blocking.  When a
+ * client doesn't accept any more, its queue waits for the socket to become
+ * writable, which a separate thread polls for, so a stalled client never
+ * holds up a writer thread.
+ *
+ * \ingroup engine
+ */
+class ClientWriterPool
+{
+public:
+	explicit ClientWriterPool(unsigned n_threads);
+	~ClientWriterPool();
+
+	ClientWriterPool(const ClientWriterPool&)            = delete;
+	ClientWriterPool& operator=(const ClientWriterPool&) = delete;
+	ClientWriterPool(ClientWriterPool&&)                 = delete;
+	ClientWriterPool& operator=(ClientWriterPool&&)      = delete;
+
+	/** Write the messages queued for a client in some writer thread. */
+	void schedule(std::weak_ptr<ClientQueue> queue);
+
+	/** Schedule a client queue once `fd` can be written without blocking. */
+	void wait_writable(int fd, std::shared_ptr<ClientQueue> queue);
+
+private:
+	void run();
+	void poll();
+
+	using Waiting = std::map<int, std::shared_ptr<ClientQueue>>;
+
+	std::mutex                             _mutex;
+	std::condition_variable                _ready;
+	std::deque<std::weak_ptr<ClientQueue>> _queues;
+	Waiting                                _waiting; ///< By socket
+	int                                    _epoll{-1};
+	std::atomic<bool>                      _exit_flag{false};
+	std::vector<std::thread>               _threads;
+	std::thread                            _poller;
+};
+
+/** A bounded queue of messages to a remote client.
+ *
+ * Messages are written to the client by a ClientWriterPool, so a slow client
+ * only delays itself rather than the post-processor and every other client.
+ * What happens when the queue is full depends on the overflow policy.
+ *
+ * If the sink buffers output that it couldn't write without blocking, it is
+ * given a flush function, and the remaining messages wait in the queue until
+ * the client has accepted that output.
+ *
+ * Monitored values (ingen:value and ingen:activity) are coalesced: if a set
+ * of the same property is still waiting, and no other kind of message has
+ * been queued since, its value is replaced instead of queueing another.  A
+ * client that falls behind therefore receives the latest values rather than
+ * working through a backlog, while everything else stays strictly ordered.
+ *
+ * The queue depth can be queried, and clients receive their own with the
+ * engine properties.  The deepest the queue has been is also logged when it
+ * is closed, and whenever messages had to be dropped.
+ *
+ * \ingroup engine
+ */
+class ClientQueue : public Interface
+                  , public std::enable_shared_from_this<ClientQueue>
+{
+public:
+	/** What to do with a message when the queue is full. */
+	enum class Overflow {
+		BLOCK,     ///< Wait for the client to catch up
+		DROP,      ///< Drop the oldest monitored value, or wait if there is none
+		DISCONNECT ///< Discard all messages and disconnect the client
+	};
+
+	/** Write output that the sink has buffered.
+	 *
+	 * Returns -1 if everything has been written, otherwise the file
+	 * descriptor to wait on until more can be written.
+	 */
+	using Flush = std::function<int()>;
+
+	ClientQueue(std::shared_ptr<Interface> sink,
+	            ClientWriterPool&          writers,
+	            const URIs&                uris,
+	            Log&                       log,
+	            size_t                     capacity,
+	            Overflow                   overflow,
+	            std::function<void()>      disconnect,
+	            Flush                      flush);
+
+	~ClientQueue() override;
+
+	ClientQueue(const ClientQueue&)            = delete;
+	ClientQueue& operator=(const ClientQueue&) = delete;
+	ClientQueue(ClientQueue&&)                 = delete;
+	ClientQueue& operator=(ClientQueue&&)      = delete;
+
+	/** Parse an overflow policy name, returning BLOCK if it is unknown. */
+	static Overflow parse_overflow(const char* name);
+
+	URI uri() const override { return _sink->uri(); }
+
+	void message(const Message& message) override;
+
+	/** Return the number of messages currently queued. */
+	size_t depth() const;
+
+	/** Return the largest number of messages that have been queued. */
+	size_t max_depth() const;
+
+	/** Write a batch of queued messages, called by the writer pool. */
+	void write();
+
+private:
+	using Lock = std::unique_lock<std::mutex>;
+
+	bool is_monitored(const SetProperty& set) const;
+	bool coalesce(const SetProperty& set, size_t key);
+	bool drop_oldest_value();
+	bool flush();
+
+	using Latest = std::unordered_map<size_t, size_t>;
+
+	std::shared_ptr<Interface> _sink;
+	ClientWriterPool&          _writers;
+	const URIs&                _uris;
+	Log&                       _log;
+	const size_t               _capacity;
+	const Overflow             _overflow;
+	std::function<void()>      _disconnect;
+	Flush                      _flush;
+	mutable std::mutex         _mutex;
+	std::condition_variable    _space;
+	std::deque<Message>        _messages;
+	Latest                     _latest; ///< Key hash => index in _messages
+	size_t                     _max_depth{0};
+	size_t                     _n_dropped{0};
+	bool                       _closed{false};
+	bool                       _scheduled{false}; ///< In the writer pool
+};
+
+} // namespace server
+} // namespace ingen
+
+#endif // INGEN_ENGINE_CLIENTQUEUE_HPP
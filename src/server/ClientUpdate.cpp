@@ -26,6 +26,7 @@
 #include <ingen/Arc.hpp>
 #include <ingen/Forge.hpp>
 #include <ingen/Interface.hpp>
+#include <ingen/Node.hpp>
 #include <ingen/Properties.hpp>
 #include <ingen/Resource.hpp>
 #include <ingen/URI.hpp>
@@ -49,6 +50,24 @@ ClientUpdate::put(const URI&        uri,
 	puts.push_back(put);
 }
 
+void
+ClientUpdate::put_node(const Node* node)
+{
+	if (const auto* const graph = dynamic_cast<const GraphImpl*>(node)) {
+		put(graph->uri(),
+		    graph->properties(Resource::Graph::INTERNAL),
+		    Resource::Graph::INTERNAL);
+
+		put(graph->uri(),
+		    graph->properties(Resource::Graph::EXTERNAL),
+		    Resource::Graph::EXTERNAL);
+	} else if (const auto* const block = dynamic_cast<const BlockImpl*>(node)) {
+		put(block->uri(), block->properties());
+	} else if (const auto* const port = dynamic_cast<const PortImpl*>(node)) {
+		put_port(port);
+	}
+}
+
 void
 ClientUpdate::put_port(const PortImpl* port)
 {
@@ -82,13 +101,7 @@ ClientUpdate::put_block(const BlockImpl* block)
 void
 ClientUpdate::put_graph(const GraphImpl* graph)
 {
-	put(graph->uri(),
-	    graph->properties(Resource::Graph::INTERNAL),
-	    Resource::Graph::INTERNAL);
-
-	put(graph->uri(),
-	    graph->properties(Resource::Graph::EXTERNAL),
-	    Resource::Graph::EXTERNAL);
+	put_node(graph);
 
 	// Enqueue blocks
 	for (const auto& b : graph->blocks()) {
@@ -28,6 +28,7 @@
 namespace ingen {
 
 class Interface;
+class Node;
 class URIs;
 
 namespace server {
@@ -47,6 +48,9 @@ struct ClientUpdate {
 	         const Properties& props,
 	         Resource::Graph   ctx = Resource::Graph::DEFAULT);
 
+	/** Put a single graph, block, or port without its children. */
+	void put_node(const Node* node);
+
 	void put_port(const PortImpl* port);
 	void put_block(const BlockImpl* block);
 	void put_graph(const GraphImpl* graph);
@@ -19,12 +19,14 @@
 #include "BlockFactory.hpp"
 #include "Broadcaster.hpp"
 #include "BufferFactory.hpp"
+#include "ClientQueue.hpp"
 #include "ControlBindings.hpp"
 #include "DirectDriver.hpp"
 #include "Driver.hpp"
 #include "Event.hpp"
 #include "EventWriter.hpp"
 #include "GraphImpl.hpp"
+#include "IdleWorker.hpp"
 #include "LV2Options.hpp"
 #include "NodeImpl.hpp"
 #include "PortImpl.hpp"
@@ -53,6 +55,7 @@
 #include <ingen/Log.hpp>
 #include <ingen/Properties.hpp>
 #include <ingen/Resource.hpp>
+#include <ingen/ShmTransport.hpp>
 #include <ingen/Store.hpp>
 #include <ingen/StreamWriter.hpp>
 #include <ingen/Tee.hpp>
@@ -67,8 +70,10 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <functional>
 #include <limits>
 #include <memory>
 #include <string>
@@ -80,6 +85,18 @@ namespace ingen::server {
 thread_local unsigned ThreadManager::flags(0);
 bool                  ThreadManager::single_threaded(true);
 
+namespace {
+
+/** Return a non-negative undo stack limit option (zero means unlimited). */
+size_t
+undo_limit(ingen::World& world, const char* option)
+{
+	const int32_t value = world.conf().option(option).get<int32_t>();
+	return static_cast<size_t>(std::max(0, value));
+}
+
+} // namespace
+
 Engine::Engine(ingen::World& world)
 	: _world(world)
 	, _options(new LV2Options(world.uris()))
@@ -87,11 +104,18 @@ Engine::Engine(ingen::World& world)
 	, _maid(new raul::Maid)
 	, _worker(new Worker(world.log(), event_queue_size()))
 	, _sync_worker(new Worker(world.log(), event_queue_size(), true))
+	, _idle_worker(new IdleWorker(world.log()))
 	, _broadcaster(new Broadcaster())
 	, _control_bindings(new ControlBindings(*this))
 	, _block_factory(new BlockFactory(world))
-	, _undo_stack(new UndoStack(world.uris(), world.uri_map()))
-	, _redo_stack(new UndoStack(world.uris(), world.uri_map()))
+	, _undo_stack(new UndoStack(world.uris(),
+	                            world.uri_map(),
+	                            undo_limit(world, "undo-size") * 1024U,
+	                            undo_limit(world, "undo-entries")))
+	, _redo_stack(new UndoStack(world.uris(),
+	                            world.uri_map(),
+	                            undo_limit(world, "undo-size") * 1024U,
+	                            undo_limit(world, "undo-entries")))
 	, _post_processor(new PostProcessor(*this))
 	, _pre_processor(new PreProcessor(*this))
 	, _event_writer(new EventWriter(*this))
@@ -100,6 +124,9 @@ Engine::Engine(ingen::World& world)
 		new AtomReader(world.uri_map(), world.uris(), world.log(), *_interface))
 	, _rand_engine(reinterpret_cast<uintptr_t>(this))
 	, _atomic_bundles(world.conf().option("atomic-bundles").get<int32_t>())
+	, _event_budget(static_cast<uint32_t>(std::min(
+	      100, std::max(1, world.conf().option("event-budget").get<int32_t>()))))
+	, _coalesce_values(!world.conf().option("sample-accurate").get<int32_t>())
 {
 	if (!world.store()) {
 		world.set_store(std::make_shared<ingen::Store>());
@@ -116,6 +143,8 @@ Engine::Engine(ingen::World& world)
 		                                 is_threaded));
 	}
 
+	_notification_heap.reserve(_run_contexts.size());
+
 	_world.lv2_features().add_feature(_worker->schedule_feature());
 	_world.lv2_features().add_feature(_options);
 	_world.lv2_features().add_feature(
@@ -168,6 +197,9 @@ Engine::~Engine()
 		thread_ctx->join();
 	}
 
+	// Finish background work, which may use plugins
+	_idle_worker.reset();
+
 	const auto store = this->store();
 	if (store) {
 		for (auto& s : *store) {
@@ -184,7 +216,17 @@ Engine::~Engine()
 void
 Engine::listen()
 {
+#if USE_SHM
+	// Create before serving clients, which may request to share it
+	_shm_values = ShmValues::create(ShmValues::default_capacity);
+	if (!_shm_values) {
+		_world.log().warn("Failed to create shared port values\n");
+	}
+#endif
 #if USE_SOCKET
+	// Create before the listener, and destroy after the clients it serves
+	_client_writers = std::make_unique<ClientWriterPool>(static_cast<unsigned>(
+		_world.conf().option("io-threads").get<int32_t>()));
 	_listener = std::make_unique<SocketListener>(*this);
 #endif
 }
@@ -231,17 +273,74 @@ Engine::flush_events(const std::chrono::milliseconds& sleep_ms)
 }
 
 void
-Engine::emit_notifications(FrameTime end)
+Engine::begin_notifications()
 {
+	_notification_heap.clear();
 	for (const auto& ctx : _run_contexts) {
-		ctx->emit_notifications(end);
+		FrameTime time = 0;
+		if (ctx->next_notification_time(time)) {
+			_notification_heap.emplace_back(time, ctx.get());
+		}
+	}
+
+	std::make_heap(_notification_heap.begin(),
+	               _notification_heap.end(),
+	               std::greater<>());
+}
+
+void
+Engine::emit_notifications(FrameTime end)
+{
+	// Merge notifications from every context, earliest first
+	while (!_notification_heap.empty() &&
+	       _notification_heap.front().first < end) {
+		std::pop_heap(_notification_heap.begin(),
+		              _notification_heap.end(),
+		              std::greater<>());
+
+		RunContext* const ctx = _notification_heap.back().second;
+		ctx->emit_notification();
+
+		FrameTime time = 0;
+		if (ctx->next_notification_time(time)) {
+			_notification_heap.back().first = time;
+			std::push_heap(_notification_heap.begin(),
+			               _notification_heap.end(),
+			               std::greater<>());
+		} else {
+			_notification_heap.pop_back();
+		}
+	}
+}
+
+void
+Engine::emit_monitored_values()
+{
+	// Send the latest value of every port that has changed since last time
+	const URIs& uris = _world.uris();
+	for (PortImpl* port = _monitor_queue.take(); port;) {
+		MonitorSlot&    slot = port->monitor_slot();
+		PortImpl* const next = MonitorQueue::pop(slot);
+
+		const URIs::Quark* key   = nullptr;
+		float              value = 0.0f;
+		slot.read(key, value);
+
+		const Atom atom = uris.forge.make(value);
+		_broadcaster->set_property(port->uri(), *key, atom);
+		if (port->is_input() && key == &uris.ingen_value) {
+			// FIXME: not thread safe
+			port->set_property(uris.ingen_value, atom);
+		}
+
+		port = next;
 	}
 }
 
 bool
 Engine::pending_notifications()
 {
-	return std::any_of(_run_contexts.begin(),
+	return _monitor_queue.pending() || std::any_of(_run_contexts.begin(),
 	                   _run_contexts.end(),
 	                   [](const auto& ctx) {
 		                   return ctx->pending_notifications();
@@ -328,7 +427,9 @@ Engine::load_properties() const
 		     { uris.ingen_minRunLoad,
 	           uris.forge.make(_run_load.min / 100.0f) },
 		     { uris.ingen_maxRunLoad,
-		       uris.forge.make(_run_load.max / 100.0f) } };
+		       uris.forge.make(_run_load.max / 100.0f) },
+		     { uris.ingen_deferredEvents,
+		       uris.forge.make(static_cast<int32_t>(_reported_deferred)) } };
 }
 
 bool
@@ -337,7 +438,9 @@ Engine::main_iteration()
 	_post_processor->process();
 	_maid->cleanup();
 
-	if (_run_load.changed) {
+	const uint64_t n_deferred = _pre_processor->n_deferred();
+	if (_run_load.changed || n_deferred != _reported_deferred) {
+		_reported_deferred = n_deferred;
 		_broadcaster->put(URI("ingen:/engine"), load_properties());
 		_run_load.changed = false;
 	}
@@ -503,9 +606,9 @@ Engine::enqueue_event(Event* ev, Event::Mode mode)
 unsigned
 Engine::process_events()
 {
-	const size_t MAX_EVENTS_PER_CYCLE = run_context().nframes() / 8;
-	return _pre_processor->process(
-		run_context(), *_post_processor, MAX_EVENTS_PER_CYCLE);
+	RunContext&    ctx    = run_context();
+	const uint64_t budget = ctx.duration() * _event_budget / 100U;
+	return _pre_processor->process(ctx, *_post_processor, 0, budget);
 }
 
 unsigned
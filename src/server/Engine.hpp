@@ -19,6 +19,7 @@
 
 #include "Event.hpp"
 #include "Load.hpp"
+#include "MonitorSlot.hpp"
 #include "server.h"
 #include "types.hpp"
 
@@ -26,6 +27,7 @@
 #include <ingen/EngineBase.hpp>
 #include <ingen/Properties.hpp>
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <cstddef>
@@ -33,6 +35,7 @@
 #include <memory>
 #include <mutex>
 #include <random>
+#include <utility>
 #include <vector>
 
 namespace raul {
@@ -45,6 +48,7 @@ namespace ingen {
 class AtomReader;
 class Interface;
 class Log;
+class ShmValues;
 class Store;
 class World;
 
@@ -53,10 +57,12 @@ namespace server {
 class BlockFactory;
 class Broadcaster;
 class BufferFactory;
+class ClientWriterPool;
 class ControlBindings;
 class Driver;
 class EventWriter;
 class GraphImpl;
+class IdleWorker;
 class LV2Options;
 class PostProcessor;
 class PreProcessor;
@@ -127,7 +133,7 @@ public:
 	/** Enqueue an event to be processed (non-realtime threads only). */
 	void enqueue_event(Event* ev, Event::Mode mode=Event::Mode::NORMAL);
 
-	/** Process events (process thread only). */
+	/** Process events within the cycle's event budget (process thread only). */
 	unsigned process_events();
 
 	/** Process all events (no RT limits). */
@@ -150,6 +156,7 @@ public:
     const std::unique_ptr<UndoStack>&       redo_stack()       const { return _redo_stack; }
     const std::unique_ptr<Worker>&          worker()           const { return _worker; }
     const std::unique_ptr<Worker>&          sync_worker()      const { return _sync_worker; }
+    const std::unique_ptr<IdleWorker>&      idle_worker()      const { return _idle_worker; }
 
     GraphImpl* root_graph() const { return _root_graph; }
 	void       set_root_graph(GraphImpl* graph);
@@ -160,7 +167,46 @@ public:
 	void advance(SampleCount nframes) override;
 	void locate(FrameTime s, SampleCount nframes) override;
 
+	/** Return the ports with monitored values to send. */
+	MonitorQueue& monitor_queue() { return _monitor_queue; }
+
+	/** Return the port values shared with local clients, if listening. */
+	ShmValues* shm_values() const { return _shm_values.get(); }
+
+	/** Return the shared port values if a local client reads them, or null.
+	 *
+	 * This is called in the audio thread to decide whether to publish.
+	 */
+	ShmValues* shared_values() const {
+		return _n_shm_sessions.load(std::memory_order_relaxed)
+		           ? _shm_values.get()
+		           : nullptr;
+	}
+
+	/** Count a local client that shares port values, while it is attached. */
+	void attach_shm_session() { ++_n_shm_sessions; }
+	void detach_shm_session() { --_n_shm_sessions; }
+
+	/** Return the threads that write to remote clients, if listening. */
+	ClientWriterPool* client_writers() const { return _client_writers.get(); }
+
+	/** Start emitting notifications from all run contexts in time order.
+	 *
+	 * This finds the next notification from every context, so that calls to
+	 * emit_notifications() only need to merge from there.
+	 */
+	void begin_notifications();
+
+	/** Emit notifications before `end` in time order (main thread only). */
 	void  emit_notifications(FrameTime end);
+
+	/** Send the latest value of every monitored port (main thread only).
+	 *
+	 * This must be called after all events in a cycle are post-processed, so
+	 * that clients have received the objects these values are about.
+	 */
+	void  emit_monitored_values();
+
 	bool  pending_notifications();
 	bool  wait_for_tasks();
 	void  signal_tasks_available();
@@ -173,37 +219,45 @@ public:
 	uint32_t    sequence_size() const;
 	uint32_t    event_queue_size() const;
 
-	size_t n_threads()      const { return _run_contexts.size(); }
-	bool   atomic_bundles() const { return _atomic_bundles; }
-	bool   activated()      const { return _activated; }
+	size_t n_threads()       const { return _run_contexts.size(); }
+	bool   atomic_bundles()  const { return _atomic_bundles; }
+	bool   coalesce_values() const { return _coalesce_values; }
+	bool   activated()       const { return _activated; }
 
 	Properties load_properties() const;
 
 private:
 	ingen::World& _world;
 
-	std::shared_ptr<LV2Options>      _options;
-	std::unique_ptr<BufferFactory>   _buffer_factory;
-	std::unique_ptr<raul::Maid>      _maid;
-	std::shared_ptr<Driver>          _driver;
-	std::unique_ptr<Worker>          _worker;
-	std::unique_ptr<Worker>          _sync_worker;
-	std::unique_ptr<Broadcaster>     _broadcaster;
-	std::unique_ptr<ControlBindings> _control_bindings;
-	std::unique_ptr<BlockFactory>    _block_factory;
-	std::unique_ptr<UndoStack>       _undo_stack;
-	std::unique_ptr<UndoStack>       _redo_stack;
-	std::unique_ptr<PostProcessor>   _post_processor;
-	std::unique_ptr<PreProcessor>    _pre_processor;
-	std::unique_ptr<SocketListener>  _listener;
-	std::shared_ptr<EventWriter>     _event_writer;
-	std::shared_ptr<Interface>       _interface;
-	std::unique_ptr<AtomReader>      _atom_interface;
-	GraphImpl*                       _root_graph{nullptr};
+	std::shared_ptr<LV2Options>       _options;
+	std::unique_ptr<BufferFactory>    _buffer_factory;
+	std::unique_ptr<raul::Maid>       _maid;
+	std::shared_ptr<Driver>           _driver;
+	std::unique_ptr<Worker>           _worker;
+	std::unique_ptr<Worker>           _sync_worker;
+	std::unique_ptr<IdleWorker>       _idle_worker;
+	std::unique_ptr<ClientWriterPool> _client_writers;
+	std::unique_ptr<Broadcaster>      _broadcaster;
+	std::unique_ptr<ControlBindings>  _control_bindings;
+	std::unique_ptr<BlockFactory>     _block_factory;
+	std::unique_ptr<UndoStack>        _undo_stack;
+	std::unique_ptr<UndoStack>        _redo_stack;
+	std::unique_ptr<PostProcessor>    _post_processor;
+	std::unique_ptr<PreProcessor>     _pre_processor;
+	std::unique_ptr<ShmValues>        _shm_values;
+	std::atomic<unsigned>             _n_shm_sessions{0U};
+	std::unique_ptr<SocketListener>   _listener;
+	std::shared_ptr<EventWriter>      _event_writer;
+	std::shared_ptr<Interface>        _interface;
+	std::unique_ptr<AtomReader>       _atom_interface;
+	GraphImpl*                        _root_graph{nullptr};
 
 	std::vector<std::unique_ptr<raul::RingBuffer>> _notifications;
+	MonitorQueue                                   _monitor_queue;
+	std::vector<std::pair<FrameTime, RunContext*>> _notification_heap;
 	std::vector<std::unique_ptr<RunContext>>       _run_contexts;
 	uint64_t                                       _cycle_start_time{0};
+	uint64_t                                       _reported_deferred{0};
 	Load                                           _run_load;
 	Clock                                          _clock;
 
@@ -213,9 +267,12 @@ private:
 	std::condition_variable _tasks_available;
 	std::mutex              _tasks_mutex;
 
+	uint32_t _event_budget; ///< Percentage of each cycle for executing events
+
 	bool _quit_flag{false};
 	bool _reset_load_flag{false};
 	bool _atomic_bundles;
+	bool _coalesce_values;
 	bool _activated{false};
 };
 
@@ -17,6 +17,7 @@
 #ifndef INGEN_ENGINE_EVENT_HPP
 #define INGEN_ENGINE_EVENT_HPP
 
+#include "EventPool.hpp"
 #include "types.hpp"
 
 #include <ingen/Interface.hpp>
@@ -27,6 +28,7 @@
 #include <raul/Noncopyable.hpp>
 
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -68,9 +70,25 @@ public:
 		UNBLOCK ///< Finish atomic executed block of events
 	};
 
+	/** Allocate events from a recycling pool (non-realtime). */
+	static void* operator new(size_t size) { return EventPool::allocate(size); }
+
+	/** Return events to the recycling pool (non-realtime). */
+	static void operator delete(void* ptr, size_t size) noexcept {
+		EventPool::deallocate(ptr, size);
+	}
+
 	/** Claim position in undo stack before pre-processing (non-realtime). */
 	virtual void mark(PreProcessContext&) {}
 
+	/** Start slow work for this and the following events (non-realtime).
+	 *
+	 * This is called just before pre_process(), and may look ahead at
+	 * events queued after this one to prepare them all together, for
+	 * example in parallel.  The queue after this event must not be changed.
+	 */
+	virtual void prefetch(PreProcessContext&) {}
+
 	/** Pre-process event before execution (non-realtime). */
 	virtual bool pre_process(PreProcessContext& ctx) = 0;
 
@@ -83,6 +101,39 @@ public:
 	/** Write the inverse of this event to `sink`. */
 	virtual void undo(Interface& target) {}
 
+	/** Return the subject and key of the property that undo() would set.
+	 *
+	 * This is called after a successful pre_process().  Events whose undo is
+	 * a single property set return the property here, and null pointers
+	 * otherwise.  The undo stack only keeps the first of consecutive entries
+	 * that set the same property, so the pre-processor can skip writing the
+	 * rest entirely.
+	 */
+	virtual std::pair<const URI*, const URI*> undo_property() const {
+		return {nullptr, nullptr};
+	}
+
+	/** Return true iff this event is made redundant by `next`.
+	 *
+	 * This is called before pre-processing if `next` directly follows this
+	 * event in the queue.  Events that return true here must handle being
+	 * superseded in post_process(), see supersede().
+	 */
+	virtual bool superseded_by(const Event& next) const { return false; }
+
+	/** Skip this event, since the following event supersedes it.
+	 *
+	 * The event is considered successfully prepared, but is neither
+	 * pre-processed nor executed.
+	 */
+	void supersede() {
+		_superseded = true;
+		_status     = Status::SUCCESS;
+	}
+
+	/** Return true iff this event was skipped by supersede(). */
+	bool is_superseded() const { return _superseded; }
+
 	/** Return true iff this event has been pre-processed. */
 	bool is_prepared() const { return _status != Status::NOT_PREPARED; }
 
@@ -166,6 +217,7 @@ protected:
 	Status                     _status;
 	std::string                _err_subject;
 	Mode                       _mode;
+	bool                       _superseded{false};
 };
 
 } // namespace ingen::server
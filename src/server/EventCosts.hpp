@@ -0,0 +1,84 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2016 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INGEN_ENGINE_EVENTCOSTS_HPP
+#define INGEN_ENGINE_EVENTCOSTS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <typeinfo>
+
+namespace ingen::server {
+
+/** Running estimates of the execution time of each type of event.
+ *
+ * This is a small fixed-size table keyed by dynamic type, so it can be used
+ * in the audio thread.  Estimates are moving averages in microseconds.
+ */
+class EventCosts
+{
+public:
+	/** Return the estimated execution time for an event of `type`. */
+	float estimate(const std::type_info& type) const {
+		const size_t i = index(type);
+		return (i < n_entries) ? _entries[i].mean : 0.0f;
+	}
+
+	/** Record that an event of `type` took `time` microseconds to execute. */
+	void update(const std::type_info& type, uint64_t time) {
+		const size_t i = index(type);
+		if (i == n_entries) {
+			return; // Table is full, should not happen with built-in events
+		}
+
+		Entry&      entry = _entries[i];
+		const float t     = static_cast<float>(time);
+		if (!entry.type) {
+			entry.type = &type;
+			entry.mean = t;
+		} else {
+			entry.mean += (t - entry.mean) * weight;
+		}
+	}
+
+private:
+	struct Entry {
+		const std::type_info* type{nullptr};
+		float                 mean{0.0f};
+	};
+
+	static constexpr size_t n_entries = 32U;
+	static constexpr float  weight    = 0.125f;
+
+	/** Return the entry index for `type`, or a free index, or n_entries. */
+	size_t index(const std::type_info& type) const {
+		const size_t start = type.hash_code() % n_entries;
+		for (size_t i = 0; i < n_entries; ++i) {
+			const size_t j = (start + i) % n_entries;
+			if (!_entries[j].type || *_entries[j].type == type) {
+				return j;
+			}
+		}
+		return n_entries;
+	}
+
+	std::array<Entry, n_entries> _entries{};
+};
+
+} // namespace ingen::server
+
+#endif // INGEN_ENGINE_EVENTCOSTS_HPP
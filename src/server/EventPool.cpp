@@ -0,0 +1,103 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2016 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "EventPool.hpp"
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+namespace ingen::server {
+namespace {
+
+constexpr size_t granularity = 64U;   ///< Size class step in bytes
+constexpr size_t n_classes   = 16U;   ///< Number of size classes
+constexpr size_t max_free    = 1024U; ///< Maximum free blocks per class
+
+/** A free block, which is linked in place of the event it once held. */
+struct FreeBlock {
+	FreeBlock* next;
+};
+
+struct SizeClass {
+	std::mutex mutex;
+	FreeBlock* head{nullptr};
+	size_t     n_free{0U};
+};
+
+struct Pools {
+	std::array<SizeClass, n_classes> classes;
+};
+
+Pools&
+pools()
+{
+	// Never destroyed, since events may be freed during static destruction
+	static auto* const p = new Pools();
+	return *p;
+}
+
+/** Return the size class index for `size`, or n_classes if too large. */
+size_t
+class_index(const size_t size)
+{
+	const size_t i = (size + granularity - 1U) / granularity;
+	return (i > 0U && i <= n_classes) ? i - 1U : n_classes;
+}
+
+} // namespace
+
+void*
+EventPool::allocate(const size_t size)
+{
+	const size_t i = class_index(size);
+	if (i < n_classes) {
+		SizeClass&                        c = pools().classes[i];
+		const std::lock_guard<std::mutex> lock{c.mutex};
+		if (FreeBlock* const block = c.head) {
+			c.head = block->next;
+			--c.n_free;
+			return block;
+		}
+	}
+
+	return ::operator new(i < n_classes ? (i + 1U) * granularity : size);
+}
+
+void
+EventPool::deallocate(void* const ptr, const size_t size) noexcept
+{
+	if (!ptr) {
+		return;
+	}
+
+	const size_t i = class_index(size);
+	if (i < n_classes) {
+		SizeClass&                        c = pools().classes[i];
+		const std::lock_guard<std::mutex> lock{c.mutex};
+		if (c.n_free < max_free) {
+			auto* const block = new (ptr) FreeBlock{c.head};
+			c.head            = block;
+			++c.n_free;
+			return;
+		}
+	}
+
+	::operator delete(ptr);
+}
+
+} // namespace ingen::server
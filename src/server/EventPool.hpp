@@ -0,0 +1,45 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2016 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INGEN_ENGINE_EVENTPOOL_HPP
+#define INGEN_ENGINE_EVENTPOOL_HPP
+
+#include <cstddef>
+
+namespace ingen::server {
+
+/** Recycling allocator for events.
+ *
+ * Events are created for every message and deleted shortly afterwards by the
+ * post-processor, so rather than returning their memory to the heap, freed
+ * events are kept on free lists by size for reuse.  Only non-realtime threads
+ * may allocate or free events.
+ *
+ * \ingroup engine
+ */
+class EventPool
+{
+public:
+	/** Allocate memory for an event of `size` bytes. */
+	static void* allocate(size_t size);
+
+	/** Free memory from allocate() for an event of `size` bytes. */
+	static void deallocate(void* ptr, size_t size) noexcept;
+};
+
+} // namespace ingen::server
+
+#endif // INGEN_ENGINE_EVENTPOOL_HPP
@@ -24,10 +24,12 @@
 #include "Engine.hpp"
 #include "GraphPlugin.hpp"
 #include "InputPort.hpp"
+#include "LV2Block.hpp"
 #include "PluginImpl.hpp"
 #include "PortImpl.hpp"
 #include "ThreadManager.hpp"
 
+#include <ingen/Atom.hpp>
 #include <ingen/Forge.hpp>
 #include <ingen/Properties.hpp>
 #include <ingen/URI.hpp>
@@ -38,8 +40,10 @@
 #include <raul/Maid.hpp>
 #include <raul/Symbol.hpp>
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <string>
@@ -220,6 +224,27 @@ GraphImpl::apply_internal_poly(RunContext&    ctx,
 	return true;
 }
 
+uint32_t
+GraphImpl::spare_voices() const
+{
+	const Atom& value = get_property(_uris.ingen_spareVoices);
+	if (value.type() != _uris.forge.Int || value.get<int32_t>() < 0) {
+		return 0U;
+	}
+
+	return std::min(static_cast<uint32_t>(value.get<int32_t>()), 128U);
+}
+
+void
+GraphImpl::request_spares(uint32_t n)
+{
+	for (auto& b : _blocks) {
+		if (auto* const block = dynamic_cast<LV2Block*>(&b)) {
+			block->request_spares(*_engine.idle_worker(), n);
+		}
+	}
+}
+
 void
 GraphImpl::pre_process(RunContext& ctx)
 {
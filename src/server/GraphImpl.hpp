@@ -195,6 +195,16 @@ public:
 	uint32_t internal_poly()         const { return _poly_pre; }
 	uint32_t internal_poly_process() const { return _poly_process; }
 
+	/** Return the number of spare instances to keep for polyphonic blocks. */
+	uint32_t spare_voices() const;
+
+	/** Keep `n` spare instances of every polyphonic LV2 block.
+	 *
+	 * The instances are made later by Engine::idle_worker(), so this doesn't
+	 * hold up the pre-process thread it is called in.
+	 */
+	void request_spares(uint32_t n);
+
 	Engine& engine() { return _engine; }
 
 private:
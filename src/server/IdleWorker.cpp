@@ -0,0 +1,85 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2017 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "IdleWorker.hpp"
+
+#include <ingen/Log.hpp>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <cstring>
+#include <utility>
+
+namespace ingen::server {
+
+IdleWorker::IdleWorker(Log& log)
+	: _log(log)
+	, _thread(&IdleWorker::run, this)
+{
+#ifdef SCHED_IDLE
+	// Only run when nothing else wants the processor
+	sched_param sp{};
+	if (const int err = pthread_setschedparam(
+	        _thread.native_handle(), SCHED_IDLE, &sp)) {
+		_log.warn("Failed to lower priority of idle worker (%1%)\n",
+		          strerror(err));
+	}
+#endif
+}
+
+IdleWorker::~IdleWorker()
+{
+	{
+		const std::lock_guard<std::mutex> lock{_mutex};
+		_exit_flag = true;
+	}
+
+	_cond.notify_one();
+	_thread.join();
+}
+
+void
+IdleWorker::push(std::function<void()> task)
+{
+	{
+		const std::lock_guard<std::mutex> lock{_mutex};
+		_tasks.push_back(std::move(task));
+	}
+
+	_cond.notify_one();
+}
+
+void
+IdleWorker::run()
+{
+	std::unique_lock<std::mutex> lock{_mutex};
+	while (true) {
+		_cond.wait(lock, [this] { return _exit_flag || !_tasks.empty(); });
+		if (_exit_flag) {
+			break;
+		}
+
+		std::function<void()> task = std::move(_tasks.front());
+		_tasks.pop_front();
+
+		lock.unlock();
+		task();
+		lock.lock();
+	}
+}
+
+} // namespace ingen::server
@@ -0,0 +1,68 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2017 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INGEN_ENGINE_IDLEWORKER_HPP
+#define INGEN_ENGINE_IDLEWORKER_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace ingen {
+
+class Log;
+
+namespace server {
+
+/** A low-priority thread for slow work that nothing waits for.
+ *
+ * This runs tasks in order, one at a time, so it is used for things like
+ * creating spare plugin instances that would otherwise hold up the event
+ * queue.  Tasks must hand their results over themselves.
+ *
+ * \ingroup engine
+ */
+class IdleWorker
+{
+public:
+	explicit IdleWorker(Log& log);
+	~IdleWorker();
+
+	IdleWorker(const IdleWorker&)            = delete;
+	IdleWorker& operator=(const IdleWorker&) = delete;
+	IdleWorker(IdleWorker&&)                 = delete;
+	IdleWorker& operator=(IdleWorker&&)      = delete;
+
+	/** Run a task later in the worker thread. */
+	void push(std::function<void()> task);
+
+private:
+	void run();
+
+	Log&                              _log;
+	std::mutex                        _mutex;
+	std::condition_variable           _cond;
+	std::deque<std::function<void()>> _tasks;
+	bool                              _exit_flag{false};
+	std::thread                       _thread;
+};
+
+} // namespace server
+} // namespace ingen
+
+#endif // INGEN_ENGINE_IDLEWORKER_HPP
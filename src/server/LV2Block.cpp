@@ -20,6 +20,7 @@
 #include "BufferFactory.hpp"
 #include "Engine.hpp"
 #include "GraphImpl.hpp"
+#include "IdleWorker.hpp"
 #include "InputPort.hpp"
 #include "LV2Plugin.hpp"
 #include "OutputPort.hpp"
@@ -78,6 +79,15 @@ LV2Block::LV2Block(LV2Plugin*          plugin,
 	assert(_lv2_plugin);
 }
 
+LV2Block::Instance::~Instance()
+{
+	if (activated) {
+		lilv_instance_deactivate(instance);
+	}
+
+	LV2Plugin::free_instance(instance);
+}
+
 LV2Block::~LV2Block()
 {
 	if (_activated) {
@@ -87,61 +97,57 @@ LV2Block::~LV2Block()
 	// Explicitly drop instances first to prevent reference cycles
 	drop_instances(_instances);
 	drop_instances(_prepared_instances);
+
+	// Stop any queued task making more spares, it frees them instead
+	if (_spares) {
+		const std::lock_guard<std::mutex> lock{_spares->mutex};
+		_spares->target = 0U;
+	}
 }
 
 std::shared_ptr<LV2Block::Instance>
-LV2Block::make_instance(URIs&      uris,
-                        SampleRate rate,
-                        uint32_t   voice,
-                        bool       preparing)
+LV2Block::new_instance(URIs& uris, SampleRate rate)
 {
-	const Engine&     engine = parent_graph()->engine();
-	const LilvPlugin* lplug  = _lv2_plugin->lilv_plugin();
+	const Engine& engine = parent_graph()->engine();
 
-	std::shared_ptr<Instance> inst = std::make_shared<Instance>(
-	  lilv_plugin_instantiate(lplug, rate, _features->array()));
+	LilvInstance* const instance =
+	    _lv2_plugin->new_instance(rate, _features->array());
 
-	if (!inst) {
+	if (!instance) {
 		engine.log().error("Failed to instantiate <%1%>\n",
 		                   _lv2_plugin->uri().c_str());
 		return nullptr;
 	}
 
-	const LV2_Options_Interface* options_iface = nullptr;
-	if (lilv_plugin_has_extension_data(lplug, uris.opt_interface)) {
-		options_iface = static_cast<const LV2_Options_Interface*>(
-			lilv_instance_get_extension_data(inst->instance, LV2_OPTIONS__interface));
+	auto inst = std::make_shared<Instance>(instance);
+	if (!init_instance(uris, *inst)) {
+		return nullptr;
 	}
 
-	for (uint32_t p = 0; p < num_ports(); ++p) {
-		const PortImpl* const port   = _ports->at(p);
-		Buffer* const   buffer = (preparing)
-			? port->prepared_buffer(voice).get()
-			: port->buffer(voice).get();
-		if (port->is_morph() && port->is_a(PortType::CV)) {
-			if (options_iface) {
+	return inst;
+}
+
+/** Set up a new instance, which may have been made ahead as a spare. */
+bool
+LV2Block::init_instance(URIs& uris, const Instance& inst)
+{
+	const LV2_Options_Interface* const options_iface =
+		_has_options ? _lv2_plugin->options_interface() : nullptr;
+
+	if (options_iface) {
+		for (uint32_t p = 0; p < num_ports(); ++p) {
+			const PortImpl* const port = _ports->at(p);
+			if (port->is_morph() && port->is_a(PortType::CV)) {
 				const LV2_URID port_type = uris.lv2_CVPort;
 				const LV2_Options_Option options[] = {
 					{ LV2_OPTIONS_PORT, p, uris.morph_currentType,
 					  sizeof(LV2_URID), uris.atom_URID, &port_type },
 					{ LV2_OPTIONS_INSTANCE, 0, 0, 0, 0, nullptr }
 				};
-				options_iface->set(inst->instance->lv2_handle, options);
-			}
-		}
-
-		if (buffer) {
-			if (port->is_a(PortType::CONTROL)) {
-				buffer->set_value(port->value());
-			} else if (port->is_a(PortType::CV)) {
-				buffer->set_block(port->value().get<float>(), 0, engine.block_length());
-			} else {
-				buffer->clear();
+				options_iface->set(inst.instance->lv2_handle, options);
 			}
 		}
-	}
 
-	if (options_iface) {
 		for (uint32_t p = 0; p < num_ports(); ++p) {
 			PortImpl* const port = _ports->at(p);
 			if (port->is_auto_morph()) {
@@ -150,7 +156,7 @@ LV2Block::make_instance(URIs&      uris,
 					{ LV2_OPTIONS_INSTANCE, 0, 0, 0, 0, nullptr }
 				};
 
-				options_iface->get(inst->instance->lv2_handle, options);
+				options_iface->get(inst.instance->lv2_handle, options);
 				if (options[0].value) {
 					LV2_URID type = *static_cast<const LV2_URID*>(options[0].value);
 					if (type == _uris.lv2_ControlPort) {
@@ -162,7 +168,7 @@ LV2Block::make_instance(URIs&      uris,
 							"%1% auto-morphed to unknown type %2%\n",
 							port->path().c_str(),
 							type);
-						return nullptr;
+						return false;
 					}
 				} else {
 					parent_graph()->engine().log().error(
@@ -173,6 +179,112 @@ LV2Block::make_instance(URIs&      uris,
 		}
 	}
 
+	return true;
+}
+
+/** Initialise the port buffers of a voice for a new instance. */
+void
+LV2Block::init_voice(uint32_t voice, bool preparing)
+{
+	const Engine& engine = parent_graph()->engine();
+
+	for (uint32_t p = 0; p < num_ports(); ++p) {
+		const PortImpl* const port   = _ports->at(p);
+		Buffer* const         buffer = (preparing)
+			? port->prepared_buffer(voice).get()
+			: port->buffer(voice).get();
+
+		if (buffer) {
+			if (port->is_a(PortType::CONTROL)) {
+				buffer->set_value(port->value());
+			} else if (port->is_a(PortType::CV)) {
+				buffer->set_block(port->value().get<float>(), 0, engine.block_length());
+			} else {
+				buffer->clear();
+			}
+		}
+	}
+}
+
+std::shared_ptr<LV2Block::Instance>
+LV2Block::make_instance(URIs&      uris,
+                        SampleRate rate,
+                        uint32_t   voice,
+                        bool       preparing)
+{
+	auto inst = new_instance(uris, rate);
+	if (inst) {
+		init_voice(voice, preparing);
+	}
+
+	return inst;
+}
+
+void
+LV2Block::Spares::fill(Log& log)
+{
+	std::unique_lock<std::mutex> lock{mutex};
+	queued = false;
+	while (instances.size() != target) {
+		std::shared_ptr<Instance> extra;
+		if (instances.size() > target) {
+			extra = std::move(instances.back());
+			instances.pop_back();
+		}
+
+		// Make or free an instance without holding up prepare_poly()
+		const bool activate = activate_ahead && active;
+		lock.unlock();
+		std::shared_ptr<Instance> made;
+		if (extra) {
+			extra.reset();
+		} else if (auto* const i = plugin->new_instance(rate, features->array())) {
+			made = std::make_shared<Instance>(i);
+			if (activate) {
+				lilv_instance_activate(i);
+				made->activated = true;
+			}
+		} else {
+			log.warn("Failed to create spare instance of <%1%>\n",
+			         plugin->uri().c_str());
+			return;
+		}
+
+		lock.lock();
+		if (made) {
+			instances.push_back(std::move(made));
+		}
+	}
+}
+
+void
+LV2Block::request_spares(IdleWorker& worker, uint32_t n)
+{
+	if (!_polyphonic) {
+		n = 0;
+	}
+
+	const std::lock_guard<std::mutex> lock{_spares->mutex};
+	_spares->target = n;
+	if (!_spares->queued && _spares->instances.size() != n) {
+		Log& log = parent_graph()->engine().log();
+
+		_spares->queued = true;
+		worker.push([spares = _spares, &log] { spares->fill(log); });
+	}
+}
+
+std::shared_ptr<LV2Block::Instance>
+LV2Block::take_spare()
+{
+	// Don't wait for the idle worker, which may be preempted holding the lock
+	const std::unique_lock<std::mutex> lock{_spares->mutex, std::try_to_lock};
+	if (!lock.owns_lock() || _spares->instances.empty()) {
+		return nullptr;
+	}
+
+	auto inst = std::move(_spares->instances.back());
+	_spares->instances.pop_back();
 	return inst;
 }
 
@@ -194,17 +306,24 @@ LV2Block::prepare_poly(BufferFactory& bufs, uint32_t poly)
 	_prepared_instances = bufs.maid().make_managed<Instances>(
 		poly, *_instances, nullptr);
 	for (uint32_t i = _polyphony; i < _prepared_instances->size(); ++i) {
-		auto inst = make_instance(bufs.uris(), rate, i, true);
-		if (!inst) {
+		// Use a spare if one is ready, which only needs setting up
+		std::shared_ptr<Instance> inst = take_spare();
+		if (inst && init_instance(bufs.uris(), *inst)) {
+			init_voice(i, true);
+		} else if (!(inst = make_instance(bufs.uris(), rate, i, true))) {
 			_prepared_instances.reset();
 			return false;
 		}
 
-		_prepared_instances->at(i) = inst;
-
-		if (_activated) {
+		// Match the block, since the spare may have been activated ahead
+		if (_activated && !inst->activated) {
 			lilv_instance_activate(inst->instance);
+		} else if (!_activated && inst->activated) {
+			lilv_instance_deactivate(inst->instance);
 		}
+
+		inst->activated            = false;
+		_prepared_instances->at(i) = inst;
 	}
 
 	return true;
@@ -219,6 +338,9 @@ LV2Block::apply_poly(RunContext& ctx, uint32_t poly)
 
 	if (_prepared_instances) {
 		_instances = std::move(_prepared_instances);
+		for (uint32_t p = 0; p < num_ports(); ++p) {
+			_ports->at(p)->invalidate_connections();
+		}
 	}
 	assert(poly <= _instances->size());
 
@@ -235,6 +357,12 @@ LV2Block::apply_poly(RunContext& ctx, uint32_t poly)
  */
 bool
 LV2Block::instantiate(BufferFactory& bufs, const LilvState* state)
+{
+	return prepare(bufs, state) && create_instances(bufs);
+}
+
+bool
+LV2Block::prepare(BufferFactory& bufs, const LilvState* state)
 {
 	const ingen::URIs& uris      = bufs.uris();
 	ingen::World&      world     = bufs.engine().world();
@@ -445,12 +573,43 @@ LV2Block::instantiate(BufferFactory& bufs, const LilvState* state)
 		return ret;
 	}
 
-	_features = world.lv2_features().lv2_features(world, this);
+	if (!_lv2_plugin->find_library()) {
+		parent_graph()->engine().log().error(
+			"Failed to load library of <%1%>\n", _lv2_plugin->uri().c_str());
+		_ports.reset();
+		return false;
+	}
+
+	_features    = world.lv2_features().lv2_features(world, this);
+	_has_options = lilv_plugin_has_extension_data(plug, uris.opt_interface);
+	_has_worker  = lilv_plugin_has_feature(plug, uris.work_schedule);
+	_instances   = bufs.maid().make_managed<Instances>(_polyphony, nullptr);
+	_spares      = std::make_shared<Spares>(
+		_lv2_plugin,
+		_features,
+		bufs.engine().sample_rate(),
+		!(_has_options && _lv2_plugin->options_interface()));
+
+	// FIXME: Polyphony + worker?
+	if (_has_worker) {
+		_worker_iface = _lv2_plugin->worker_interface();
+	}
+
+	// Load initial state if no state is explicitly given
+	if (!state) {
+		_default_state = load_preset(_lv2_plugin->uri());
+		state          = _default_state.get();
+	}
+
+	_initial_state = state;
+	return ret;
+}
 
+bool
+LV2Block::create_instances(BufferFactory& bufs)
+{
 	// Actually create plugin instances and port buffers.
 	const SampleRate rate = bufs.engine().sample_rate();
-	_instances = bufs.maid().make_managed<Instances>(
-		_polyphony, nullptr);
 	for (uint32_t i = 0; i < _polyphony; ++i) {
 		_instances->at(i) = make_instance(bufs.uris(), rate, i, false);
 		if (!_instances->at(i)) {
@@ -458,26 +617,15 @@ LV2Block::instantiate(BufferFactory& bufs, const LilvState* state)
 		}
 	}
 
-	// Load initial state if no state is explicitly given
-	StatePtr default_state{};
-	if (!state) {
-		default_state = load_preset(_lv2_plugin->uri());
-		state         = default_state.get();
-	}
-
 	// Apply state
-	if (state) {
-		apply_state(nullptr, state);
+	if (_initial_state) {
+		apply_state(nullptr, _initial_state);
 	}
 
-	// FIXME: Polyphony + worker?
-	if (lilv_plugin_has_feature(plug, uris.work_schedule)) {
-		_worker_iface = static_cast<const LV2_Worker_Interface*>(
-			lilv_instance_get_extension_data(instance(0),
-			                                 LV2_WORKER__interface));
-	}
+	_initial_state = nullptr;
+	_default_state.reset();
 
-	return ret;
+	return true;
 }
 
 bool
@@ -486,6 +634,9 @@ LV2Block::save_state(const FilePath& dir) const
 	World&     world  = _lv2_plugin->world();
 	LilvWorld* lworld = world.lilv_world();
 
+	// Saving state calls extension_data(), so needs the library
+	const auto lock = _lv2_plugin->lock_library();
+
 	const StatePtr state{
 	    lilv_state_new_from_instance(_lv2_plugin->lilv_plugin(),
 	                                 const_cast<LV2Block*>(this)->instance(0),
@@ -526,6 +677,7 @@ LV2Block::duplicate(Engine&             engine,
 	const SampleRate rate = engine.sample_rate();
 
 	// Get current state
+	auto lock = _lv2_plugin->lock_library();
 	const StatePtr state{
 	    lilv_state_new_from_instance(_lv2_plugin->lilv_plugin(),
 	                                 instance(0),
@@ -538,6 +690,7 @@ LV2Block::duplicate(Engine&             engine,
 	                                 nullptr,
 	                                 LV2_STATE_IS_NATIVE,
 	                                 nullptr)};
+	lock.unlock();
 
 	// Duplicate and instantiate block
 	auto* dup = new LV2Block(_lv2_plugin, symbol, _polyphonic, parent, rate);
@@ -567,6 +720,9 @@ LV2Block::activate(BufferFactory& bufs)
 	for (uint32_t i = 0; i < _polyphony; ++i) {
 		lilv_instance_activate(instance(i));
 	}
+
+	const std::lock_guard<std::mutex> lock{_spares->mutex};
+	_spares->active = true;
 }
 
 void
@@ -577,6 +733,9 @@ LV2Block::deactivate()
 	for (uint32_t i = 0; i < _polyphony; ++i) {
 		lilv_instance_deactivate(instance(i));
 	}
+
+	const std::lock_guard<std::mutex> lock{_spares->mutex};
+	_spares->active = false;
 }
 
 LV2_Worker_Status
@@ -675,6 +834,11 @@ void
 LV2Block::apply_state(const std::unique_ptr<Worker>& worker,
                       const LilvState*               state)
 {
+	// Port values are set elsewhere, so only plugin state is restored here
+	if (!_lv2_plugin->state_interface()) {
+		return;
+	}
+
 	World&                       world = parent_graph()->engine().world();
 	std::shared_ptr<LV2_Feature> sched;
 	if (worker) {
@@ -686,6 +850,8 @@ LV2Block::apply_state(const std::unique_ptr<Worker>& worker,
 		state_features[0] = sched.get();
 	}
 
+	// Restoring state calls extension_data(), so needs the library
+	const auto lock = _lv2_plugin->lock_library();
 	for (uint32_t v = 0; v < _polyphony; ++v) {
 		lilv_state_restore(state, instance(v), nullptr, nullptr, 0, state_features);
 	}
@@ -726,6 +892,7 @@ LV2Block::save_preset(const URI&        uri,
 	const FilePath dirname  = path.parent_path();
 	const FilePath basename = path.stem();
 
+	const auto     lock  = _lv2_plugin->lock_library();
 	const StatePtr state{lilv_state_new_from_instance(_lv2_plugin->lilv_plugin(),
 	                                                  instance(0),
 	                                                  lmap,
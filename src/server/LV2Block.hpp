@@ -39,6 +39,8 @@
 #include <filesystem>
 #include <memory>
 #include <mutex>
+#include <utility>
+#include <vector>
 
 namespace raul {
 class Symbol;
@@ -46,6 +48,7 @@ class Symbol;
 
 namespace ingen {
 
+class Log;
 class URIs;
 class World;
 
@@ -53,6 +56,7 @@ namespace server {
 
 class BufferFactory;
 class GraphImpl;
+class IdleWorker;
 class LV2Plugin;
 
 /** An instance of a LV2 plugin.
@@ -72,6 +76,20 @@ public:
 
 	bool instantiate(BufferFactory& bufs, const LilvState* state);
 
+	/** Set up ports and features, the first part of instantiate().
+	 *
+	 * This uses the lilv world, so must be called in the pre-process thread.
+	 * The state, if given, must remain valid until create_instances().
+	 */
+	bool prepare(BufferFactory& bufs, const LilvState* state);
+
+	/** Create plugin instances and apply the initial state.
+	 *
+	 * This is the rest of instantiate() after prepare().  It only touches
+	 * this block, so several blocks may do this in parallel.
+	 */
+	bool create_instances(BufferFactory& bufs);
+
 	LilvInstance* instance() override { return instance(0); }
 	bool          save_state(const std::filesystem::path& dir) const override;
 
@@ -79,6 +97,14 @@ public:
 	                     const raul::Symbol& symbol,
 	                     GraphImpl*          parent) override;
 
+	/** Keep `n` spare instances ready for prepare_poly() to use.
+	 *
+	 * Spares are only kept for polyphonic blocks.  This returns immediately,
+	 * the instances are made or freed later by `worker`, and prepare_poly()
+	 * takes whatever spares are ready by then.
+	 */
+	void request_spares(IdleWorker& worker, uint32_t n);
+
 	bool prepare_poly(BufferFactory& bufs, uint32_t poly) override;
 	bool apply_poly(RunContext& ctx, uint32_t poly) override;
 
@@ -109,14 +135,53 @@ protected:
 	struct Instance : public raul::Noncopyable {
 		explicit Instance(LilvInstance* i) noexcept : instance(i) {}
 
-		~Instance() { lilv_instance_free(instance); }
+		~Instance();
 
 		LilvInstance* const instance;
+		bool                activated{false}; ///< Activated ahead as a spare
+	};
+
+	/** Spare instances, shared with the IdleWorker task that makes them.
+	 *
+	 * Spares are activated ahead while the block is active, unless the plugin
+	 * has options that init_instance() must set first, in which case
+	 * prepare_poly() activates them when they are taken.
+	 */
+	struct Spares {
+		Spares(LV2Plugin*                                 p,
+		       std::shared_ptr<LV2Features::FeatureArray> f,
+		       SampleRate                                 r,
+		       bool                                       a) noexcept
+			: plugin(p)
+			, features(std::move(f))
+			, rate(r)
+			, activate_ahead(a)
+		{}
+
+		void fill(Log& log);
+
+		LV2Plugin* const                                 plugin;
+		const std::shared_ptr<LV2Features::FeatureArray> features;
+		const SampleRate                                 rate;
+		const bool                                       activate_ahead;
+		std::mutex                                       mutex;
+		std::vector<std::shared_ptr<Instance>>           instances;
+		uint32_t                                         target{0U};
+		bool                                             queued{false};
+		bool                                             active{false};
 	};
 
+	std::shared_ptr<Instance> new_instance(URIs& uris, SampleRate rate);
+
+	bool init_instance(URIs& uris, const Instance& inst);
+
+	std::shared_ptr<Instance> take_spare();
+
 	std::shared_ptr<Instance>
 	make_instance(URIs& uris, SampleRate rate, uint32_t voice, bool preparing);
 
+	void init_voice(uint32_t voice, bool preparing);
+
 	LilvInstance* instance(uint32_t voice) {
 		return static_cast<LilvInstance*>((*_instances)[voice]->instance);
 	}
@@ -160,7 +225,12 @@ protected:
 	LV2Plugin*                                 _lv2_plugin;
 	raul::managed_ptr<Instances>               _instances;
 	raul::managed_ptr<Instances>               _prepared_instances;
+	std::shared_ptr<Spares>                    _spares;
 	const LV2_Worker_Interface*                _worker_iface{nullptr};
+	StatePtr                                   _default_state;
+	const LilvState*                           _initial_state{nullptr};
+	bool                                       _has_options{false};
+	bool                                       _has_worker{false};
 	std::mutex                                 _work_mutex;
 	Responses                                  _responses;
 	std::shared_ptr<LV2Features::FeatureArray> _features;
@@ -25,13 +25,64 @@
 #include <ingen/URIs.hpp>
 #include <ingen/World.hpp>
 #include <lilv/lilv.h>
+#include <lv2/core/lv2.h>
+#include <lv2/options/options.h>
+#include <lv2/state/state.h>
+#include <lv2/worker/worker.h>
+#include <raul/Noncopyable.hpp>
 #include <raul/Symbol.hpp>
 
+#include <dlfcn.h>
+
+#include <cassert>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
 
 namespace ingen::server {
 
+/// An open plugin library, shared by every plugin and instance from it
+struct LV2Plugin::Library : public raul::Noncopyable {
+	Library(void*                     h,
+	        const LV2_Lib_Descriptor* lib,
+	        LV2_Descriptor_Function   func) noexcept
+		: handle(h)
+		, descriptor(lib)
+		, function(func)
+	{}
+
+	~Library() {
+		if (descriptor && descriptor->cleanup) {
+			descriptor->cleanup(descriptor->handle);
+		}
+
+		dlclose(handle);
+	}
+
+	void* const                     handle;
+	const LV2_Lib_Descriptor* const descriptor;
+	const LV2_Descriptor_Function   function;
+	std::recursive_mutex            mutex;
+};
+
+namespace {
+
+std::string
+file_uri_path(const LilvNode* uri)
+{
+	char* const path = lilv_file_uri_parse(lilv_node_as_uri(uri), nullptr);
+	std::string result{path ? path : ""};
+	lilv_free(path);
+	return result;
+}
+
+} // namespace
+
 LV2Plugin::LV2Plugin(World& world, const LilvPlugin* lplugin)
 	: PluginImpl(world.uris(),
 	             world.uris().lv2_Plugin.urid_atom(),
@@ -108,6 +159,153 @@ LV2Plugin::instantiate(BufferFactory&      bufs,
 	return b;
 }
 
+std::shared_ptr<LV2Plugin::Library>
+LV2Plugin::open_library(const std::string& path, const std::string& bundle_path)
+{
+	// Libraries are shared so that plugins in one library share its lock
+	static std::mutex                                    mutex;
+	static std::map<std::string, std::weak_ptr<Library>> libraries;
+
+	const std::lock_guard<std::mutex> lock{mutex};
+
+	auto l = libraries.find(path);
+	if (l != libraries.end()) {
+		if (auto library = l->second.lock()) {
+			return library;
+		}
+	}
+
+	void* const handle = dlopen(path.c_str(), RTLD_NOW);
+	if (!handle) {
+		_world.log().error("Failed to open library %1% (%2%)\n",
+		                   path,
+		                   dlerror());
+		return nullptr;
+	}
+
+	// Get the library descriptor, or the plain descriptor function
+	static const LV2_Feature* const no_features[] = {nullptr};
+
+	const auto lib_func = reinterpret_cast<LV2_Lib_Descriptor_Function>(
+	    dlsym(handle, "lv2_lib_descriptor"));
+	const auto func = reinterpret_cast<LV2_Descriptor_Function>(
+	    dlsym(handle, "lv2_descriptor"));
+
+	const LV2_Lib_Descriptor* const lib =
+	    lib_func ? lib_func(bundle_path.c_str(), no_features) : nullptr;
+
+	if (!lib && !func) {
+		_world.log().error("No plugin descriptors in library %1%\n", path);
+		dlclose(handle);
+		return nullptr;
+	}
+
+	auto library = std::make_shared<Library>(handle, lib, func);
+	libraries[path] = library;
+	return library;
+}
+
+bool
+LV2Plugin::find_library()
+{
+	if (_descriptor) {
+		return true;
+	}
+
+	const LilvNode* const library_uri =
+	    lilv_plugin_get_library_uri(_lilv_plugin);
+	if (!library_uri) {
+		return false;
+	}
+
+	const std::string bundle_path =
+	    file_uri_path(lilv_plugin_get_bundle_uri(_lilv_plugin));
+
+	std::shared_ptr<Library> library =
+	    open_library(file_uri_path(library_uri), bundle_path);
+	if (!library) {
+		return false;
+	}
+
+	const std::lock_guard<std::recursive_mutex> lock{library->mutex};
+
+	// Find the descriptor for this plugin
+	const LV2_Lib_Descriptor* const lib = library->descriptor;
+	for (uint32_t i = 0U;; ++i) {
+		const LV2_Descriptor* const d =
+		    lib ? lib->get_plugin(lib->handle, i) : library->function(i);
+		if (!d || !strcmp(d->URI, uri().c_str())) {
+			_descriptor = d;
+			break;
+		}
+	}
+
+	if (!_descriptor) {
+		_world.log().error("No descriptor for <%1%> in its library\n",
+		                   uri().c_str());
+		return false;
+	}
+
+	// Get the extension data used for every instance
+	if (_descriptor->extension_data) {
+		_options_iface = static_cast<const LV2_Options_Interface*>(
+		    _descriptor->extension_data(LV2_OPTIONS__interface));
+		_worker_iface = static_cast<const LV2_Worker_Interface*>(
+		    _descriptor->extension_data(LV2_WORKER__interface));
+		_state_iface = static_cast<const LV2_State_Interface*>(
+		    _descriptor->extension_data(LV2_STATE__interface));
+	}
+
+	_library     = std::move(library);
+	_bundle_path = bundle_path;
+	return true;
+}
+
+std::unique_lock<std::recursive_mutex>
+LV2Plugin::lock_library() const
+{
+	assert(_library);
+	return std::unique_lock<std::recursive_mutex>{_library->mutex};
+}
+
+LilvInstance*
+LV2Plugin::new_instance(double rate, const LV2_Feature* const* features) const
+{
+	static const LV2_Feature* const no_features[] = {nullptr};
+	if (!features) {
+		features = no_features;
+	}
+
+	const LV2_Handle instance =
+	    _descriptor->instantiate(_descriptor, rate, _bundle_path.c_str(), features);
+
+	if (!instance) {
+		return nullptr;
+	}
+
+	auto* const result =
+	    static_cast<LilvInstance*>(calloc(1, sizeof(LilvInstance)));
+	result->lv2_descriptor = _descriptor;
+	result->lv2_handle     = instance;
+	result->pimpl          = new std::shared_ptr<Library>(_library);
+	return result;
+}
+
+void
+LV2Plugin::free_instance(LilvInstance* instance)
+{
+	if (!instance) {
+		return;
+	}
+
+	// Keep the library open until the instance has been cleaned up
+	auto* const library = static_cast<std::shared_ptr<Library>*>(instance->pimpl);
+	instance->lv2_descriptor->cleanup(instance->lv2_handle);
+
+	delete library;
+	free(instance);
+}
+
 void
 LV2Plugin::load_presets()
 {
@@ -21,6 +21,14 @@
 
 #include <ingen/URI.hpp>
 #include <lilv/lilv.h>
+#include <lv2/core/lv2.h>
+#include <lv2/options/options.h>
+#include <lv2/state/state.h>
+#include <lv2/worker/worker.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
 
 namespace ingen {
 
@@ -56,9 +64,70 @@ public:
 		return URI(lilv_node_as_uri(bundle));
 	}
 
+	/** Open the plugin's library so that new_instance() can be used.
+	 *
+	 * This also finds the plugin descriptor and the extension data used for
+	 * every instance, since LV2 forbids calling these discovery functions
+	 * while anything else calls into the library.  This uses the lilv world,
+	 * so must be called in the pre-process thread.
+	 *
+	 * @return False if the plugin's library or descriptor can't be loaded.
+	 */
+	bool find_library();
+
+	/** Lock the plugin's library against concurrent discovery calls.
+	 *
+	 * All plugins in a library share this lock, which must be held for
+	 * anything that may call discovery functions like extension_data(), such
+	 * as lilv_state_restore().  Instances are made and freed without it.  It
+	 * may be locked recursively.
+	 */
+	std::unique_lock<std::recursive_mutex> lock_library() const;
+
+	/** Return the options interface found by find_library(), or null. */
+	const LV2_Options_Interface* options_interface() const {
+		return _options_iface;
+	}
+
+	/** Return the worker interface found by find_library(), or null. */
+	const LV2_Worker_Interface* worker_interface() const {
+		return _worker_iface;
+	}
+
+	/** Return the state interface found by find_library(), or null. */
+	const LV2_State_Interface* state_interface() const {
+		return _state_iface;
+	}
+
+	/** Create a new instance of the plugin.
+	 *
+	 * This is like lilv_plugin_instantiate(), but doesn't touch the lilv
+	 * world, which keeps a table of open libraries that isn't thread-safe.
+	 * After find_library(), this may be called from any thread, including
+	 * concurrently for instances of plugins in the same library.
+	 *
+	 * @return An instance to be freed with free_instance(), or null.
+	 */
+	LilvInstance* new_instance(double                    rate,
+	                           const LV2_Feature* const* features) const;
+
+	/** Free an instance returned by new_instance(). */
+	static void free_instance(LilvInstance* instance);
+
 private:
-	World&            _world;
-	const LilvPlugin* _lilv_plugin;
+	struct Library;
+
+	std::shared_ptr<Library> open_library(const std::string& path,
+	                                      const std::string& bundle_path);
+
+	World&                       _world;
+	const LilvPlugin*            _lilv_plugin;
+	std::shared_ptr<Library>     _library;
+	std::string                  _bundle_path;
+	const LV2_Descriptor*        _descriptor{nullptr};
+	const LV2_Options_Interface* _options_iface{nullptr};
+	const LV2_Worker_Interface*  _worker_iface{nullptr};
+	const LV2_State_Interface*   _state_iface{nullptr};
 };
 
 } // namespace server
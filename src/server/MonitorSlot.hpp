@@ -0,0 +1,117 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2016 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INGEN_ENGINE_MONITORSLOT_HPP
+#define INGEN_ENGINE_MONITORSLOT_HPP
+
+#include <ingen/URIs.hpp>
+
+#include <atomic>
+#include <cstdint>
+
+namespace ingen::server {
+
+class PortImpl;
+
+/** The latest monitored scalar value of a port.
+ *
+ * The audio thread overwrites the slot with every new value, and the
+ * post-processor reads whatever is there when it gets around to it, so
+ * intermediate values may be skipped but can never be lost to overflow.  A
+ * sequence lock ensures that a reader always sees a consistent key and value.
+ *
+ * \ingroup engine
+ */
+class MonitorSlot
+{
+public:
+	/** Set the current value (realtime, one writer at a time). */
+	void write(const URIs::Quark& key, float value) {
+		const uint32_t seq = _seq.load(std::memory_order_relaxed);
+		_seq.store(seq + 1U, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		_key.store(&key, std::memory_order_relaxed);
+		_value.store(value, std::memory_order_relaxed);
+		_seq.store(seq + 2U, std::memory_order_release);
+	}
+
+	/** Read the current value (any thread). */
+	void read(const URIs::Quark*& key, float& value) const {
+		uint32_t seq = 0U;
+		do {
+			while ((seq = _seq.load(std::memory_order_acquire)) & 1U) {}
+			key   = _key.load(std::memory_order_relaxed);
+			value = _value.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+		} while (_seq.load(std::memory_order_relaxed) != seq);
+	}
+
+private:
+	friend class MonitorQueue;
+
+	std::atomic<uint32_t>           _seq{0U};
+	std::atomic<const URIs::Quark*> _key{nullptr};
+	std::atomic<float>              _value{0.0f};
+	std::atomic<bool>               _dirty{false};
+	std::atomic<PortImpl*>          _next{nullptr};
+};
+
+/** The set of ports with monitor values that have not been sent yet.
+ *
+ * This is an intrusive lock-free list linked through the ports' slots, so it
+ * needs no memory of its own, and each port is in it at most once.
+ *
+ * \ingroup engine
+ */
+class MonitorQueue
+{
+public:
+	/** Add `port` if it isn't already pending (realtime safe). */
+	void push(PortImpl* port, MonitorSlot& slot) {
+		if (slot._dirty.exchange(true)) {
+			return; // Already pending, the new value will be sent with it
+		}
+
+		PortImpl* head = _head.load();
+		do {
+			slot._next.store(head, std::memory_order_relaxed);
+		} while (!_head.compare_exchange_weak(head, port));
+	}
+
+	/** Return true iff any ports are pending. */
+	bool pending() const { return _head.load(); }
+
+	/** Take all pending ports, in no particular order. */
+	PortImpl* take() { return _head.exchange(nullptr); }
+
+	/** Return the port after `port` in a list from take(), and clear it.
+	 *
+	 * This must be called before reading the slot, so a value written after
+	 * the read puts the port back in the queue.
+	 */
+	static PortImpl* pop(MonitorSlot& slot) {
+		PortImpl* const next = slot._next.load(std::memory_order_relaxed);
+		slot._dirty = false;
+		return next;
+	}
+
+private:
+	std::atomic<PortImpl*> _head{nullptr};
+};
+
+} // namespace ingen::server
+
+#endif // INGEN_ENGINE_MONITORSLOT_HPP
@@ -17,6 +17,7 @@
 #include "PortImpl.hpp"
 
 #include "BlockImpl.hpp"
+#include "Broadcaster.hpp"
 #include "Buffer.hpp"
 #include "BufferFactory.hpp"
 #include "Engine.hpp"
@@ -76,6 +77,8 @@ PortImpl::PortImpl(BufferFactory&      bufs,
 	, _min(bufs.forge().make(0.0f))
 	, _max(bufs.forge().make(1.0f))
 	, _voices(bufs.maid().make_managed<Voices>(poly))
+	, _shm_key(ShmValues::key(path().c_str()))
+	, _subscribed(bufs.engine().broadcaster()->is_subscribed(path()))
 	, _is_output(is_output)
 {
 	assert(block != nullptr);
@@ -401,8 +404,18 @@ PortImpl::set_buffer_size(RunContext&, BufferFactory&, size_t size)
 void
 PortImpl::connect_buffers(SampleCount offset)
 {
+	const bool force = _reconnect;
+
+	_reconnect = false;
 	for (uint32_t v = 0; v < _poly; ++v) {
-		PortImpl::parent_block()->set_port_buffer(v, _index, buffer(v), offset);
+		Voice&          voice = _voices->at(v);
+		const BufferRef buf   = buffer(v);
+		const void*     data  = buf ? buf->port_data(_type, offset) : nullptr;
+		if (force || !voice.connected || data != voice.port_data) {
+			PortImpl::parent_block()->set_port_buffer(v, _index, buf, offset);
+			voice.port_data = data;
+			voice.connected = true;
+		}
 	}
 }
 
@@ -448,7 +461,10 @@ PortImpl::clear_buffers(const RunContext& ctx)
 void
 PortImpl::monitor(RunContext& ctx, bool send_now)
 {
-	if (!ctx.must_notify(this)) {
+	// Local clients read shared values regardless of their subscriptions
+	ShmValues* const shared = ctx.engine().shared_values();
+	const bool       notify = ctx.must_notify(this);
+	if (!notify && !shared) {
 		return;
 	}
 
@@ -462,20 +478,19 @@ PortImpl::monitor(RunContext& ctx, bool send_now)
 		return;
 	}
 
-	const Forge& forge = ctx.engine().world().forge();
-	const URIs&  uris  = ctx.engine().world().uris();
-	LV2_URID     key   = 0;
-	float        val   = 0.0f;
+	const URIs&        uris = ctx.engine().world().uris();
+	const URIs::Quark* key  = nullptr;
+	float              val  = 0.0f;
 	switch (_type) {
 	case PortType::UNKNOWN:
 		break;
 	case PortType::AUDIO:
-		key = uris.ingen_activity;
+		key = &uris.ingen_activity;
 		val = _peak = std::max(_peak, buffer(0)->peak(ctx));
 		break;
 	case PortType::CONTROL:
 	case PortType::CV:
-		key = uris.ingen_value;
+		key = &uris.ingen_value;
 		val = buffer(0)->value_at(0);
 		break;
 	case PortType::ATOM:
@@ -498,9 +513,9 @@ PortImpl::monitor(RunContext& ctx, bool send_now)
 				}
 			} else if (value && value->type == _bufs.uris().atom_Float) {
 				/* Float sequence, monitor as a control. */
-				key = uris.ingen_value;
+				key = &uris.ingen_value;
 				val = reinterpret_cast<const LV2_Atom_Float*>(buffer(0)->value())->body;
-			} else if (atom->size > sizeof(LV2_Atom_Sequence_Body)) {
+			} else if (notify && atom->size > sizeof(LV2_Atom_Sequence_Body)) {
 				/* General sequence, send activity for blinkenlights. */
 				const int32_t one = 1;
 				ctx.notify(uris.ingen_activity,
@@ -516,14 +531,21 @@ PortImpl::monitor(RunContext& ctx, bool send_now)
 
 	_frames_since_monitor = _frames_since_monitor % period;
 	if (key && val != _monitor_value) {
-		if (ctx.notify(key, ctx.start(), this, sizeof(float), forge.Float, &val)) {
-			/* Update frames since last update to conceptually zero, but keep
-			   the remainder to preserve load balancing. */
-			_frames_since_monitor = _frames_since_monitor % period;
-			_peak                 = 0.0f;
-			_monitor_value        = val;
+		if (notify) {
+			ctx.notify_value(*key, this, val);
 		}
-		// Otherwise failure, leave old value and try again next time
+
+		if (shared && key == &uris.ingen_activity) {
+			shared->write_peak(shm_key(), val);
+		} else if (shared) {
+			shared->write_value(shm_key(), val);
+		}
+
+		/* Update frames since last update to conceptually zero, but keep
+		   the remainder to preserve load balancing. */
+		_frames_since_monitor = _frames_since_monitor % period;
+		_peak                 = 0.0f;
+		_monitor_value        = val;
 	}
 }
 
@@ -554,6 +576,7 @@ void
 PortImpl::pre_process(RunContext& ctx)
 {
 	if (!_connected_flag.test_and_set(std::memory_order_acquire)) {
+		invalidate_connections();
 		connect_buffers();
 		clear_buffers(ctx);
 	}
@@ -19,12 +19,14 @@
 
 #include "BufferFactory.hpp"
 #include "BufferRef.hpp"
+#include "MonitorSlot.hpp"
 #include "NodeImpl.hpp"
 #include "RunContext.hpp"
 #include "server.h"
 #include "types.hpp"
 
 #include <ingen/Atom.hpp>
+#include <ingen/ShmTransport.hpp>
 #include <ingen/URIs.hpp>
 #include <lv2/urid/urid.h>
 #include <raul/Array.hpp>
@@ -91,8 +93,10 @@ public:
 	};
 
 	struct Voice {
-		SetState  set_state;
-		BufferRef buffer{nullptr};
+		SetState    set_state;
+		BufferRef   buffer{nullptr};
+		const void* port_data{nullptr}; ///< Data last connected to block
+		bool        connected{false};   ///< True iff port_data is current
 	};
 
 	using Voices = raul::Array<Voice>;
@@ -200,9 +204,21 @@ public:
 	                               Properties&     remove,
 	                               Properties&     add) {}
 
+	/** Connect voice buffers to the block, if they have changed.
+	 *
+	 * The block is only told about a voice if the data pointer (which
+	 * includes `offset`) differs from the one last connected, so this is
+	 * cheap to call every cycle or slice.
+	 */
 	virtual void connect_buffers(SampleCount offset=0);
 	virtual void recycle_buffers();
 
+	/** Force the next call to connect_buffers() to reconnect every voice.
+	 *
+	 * This must be called when the block's underlying instances change.
+	 */
+	void invalidate_connections() { _reconnect = true; }
+
 	uint32_t index() const { return _index; }
 	void set_index(RunContext&, uint32_t index) { _index = index; }
 
@@ -238,9 +254,34 @@ public:
 	/** Explicitly turn on monitoring for this port. */
 	void enable_monitoring(bool monitored) { _monitored = monitored; }
 
+	/** Return true iff a broadcasting client has subscribed to this port.
+	 *
+	 * Ports outside every subscribed subtree skip notifications entirely.
+	 */
+	bool is_subscribed() const {
+		return _subscribed.load(std::memory_order_relaxed);
+	}
+
+	/** Set whether a broadcasting client has subscribed to this port. */
+	void set_subscribed(bool subscribed) {
+		_subscribed.store(subscribed, std::memory_order_relaxed);
+	}
+
+	/** Rename, and move the shared value of this port to the new path. */
+	void set_path(const raul::Path& new_path) override {
+		NodeImpl::set_path(new_path);
+		_shm_key = ShmValues::key(new_path.c_str());
+	}
+
+	/** Return the key of the value of this port in ShmValues. */
+	uint64_t shm_key() const { return _shm_key; }
+
 	/** Monitor port value and broadcast to clients periodically. */
 	void monitor(RunContext& ctx, bool send_now=false);
 
+	/** Return the slot for the latest monitored scalar value. */
+	MonitorSlot& monitor_slot() { return _monitor_slot; }
+
 	BufferFactory& bufs() const { return _bufs; }
 
 	BufferRef value_buffer(uint32_t voice) const;
@@ -309,8 +350,11 @@ protected:
 	raul::managed_ptr<Voices> _voices;
 	raul::managed_ptr<Voices> _prepared_voices;
 	BufferRef                 _user_buffer;
+	MonitorSlot               _monitor_slot;
+	std::atomic<uint64_t>     _shm_key;
 	std::atomic_flag          _connected_flag{false};
 	bool                      _monitored{false};
+	std::atomic<bool>         _subscribed{true};
 	bool                      _force_monitor_update{false};
 	bool                      _is_morph{false};
 	bool                      _is_auto_morph{false};
@@ -318,6 +362,7 @@ protected:
 	bool                      _is_sample_rate{false};
 	bool                      _is_toggled{false};
 	bool                      _is_driver_port{false};
+	bool                      _reconnect{true};
 	bool                      _is_output;
 };
 
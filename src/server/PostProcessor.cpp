@@ -75,6 +75,10 @@ PostProcessor::process()
 {
 	const FrameTime end_time = _max_time;
 
+	/* Find the next notification from each run context once, then merge them
+	   in time order with the events as they are post-processed. */
+	_engine.begin_notifications();
+
 	/* We can never empty the list and set _head = _tail = null since this
 	   would cause a race with append.  Instead, head is an already
 	   post-processed node, or initially a sentinel. */
@@ -83,12 +87,12 @@ PostProcessor::process()
 	if (!next || next->time() >= end_time) {
 		// Process audio thread notifications until end
 		_engine.emit_notifications(end_time);
+		_engine.emit_monitored_values();
 		return;
 	}
 
+	Event* const first = ev;
 	do {
-		// Delete previously post-processed ev and move to next
-		delete ev;
 		ev = next;
 
 		// Process audio thread notifications up until this event's time
@@ -105,8 +109,20 @@ PostProcessor::process()
 	assert(ev);
 	_head = ev;
 
-	// Process remaining audio thread notifications until end
+	/* Process remaining audio thread notifications until end, including any
+	   that arrived from contexts which had none when this call started. */
+	_engine.begin_notifications();
 	_engine.emit_notifications(end_time);
+	_engine.emit_monitored_values();
+
+	/* Delete the previous head and the events before the new one.  This is
+	   done only now, since deleting an event may free ports that were still
+	   in the monitor queue until the values were sent above. */
+	for (Event* e = first; e != ev;) {
+		Event* const e_next = e->next();
+		delete e;
+		e = e_next;
+	}
 }
 
 } // namespace ingen::server
@@ -19,11 +19,17 @@
 
 #include "CompiledGraph.hpp"
 #include "GraphImpl.hpp"
+#include "PreProcessPool.hpp"
 
+#include <map>
 #include <memory>
 #include <unordered_set>
 
-namespace ingen::server {
+namespace ingen {
+
+class Interface;
+
+namespace server {
 
 /** Event pre-processing context.
  *
@@ -34,11 +40,32 @@ class PreProcessContext
 public:
 	using DirtyGraphs = std::unordered_set<GraphImpl*>;
 
-	/** Return true iff an atomic bundle is currently being pre-processed. */
-	bool in_bundle() const { return _in_bundle; }
+	explicit PreProcessContext(PreProcessPool& pool) : _pool(pool) {}
+
+	/** Return the pool of threads for doing independent work in parallel. */
+	PreProcessPool& pool() { return _pool; }
 
-	/** Set/unset atomic bundle flag. */
-	void set_in_bundle(bool b) { _in_bundle = b; }
+	/** Return true iff any client is currently in a bundle. */
+	bool in_bundle() const { return !_bundle_depths.empty(); }
+
+	/** Enter a (possibly nested) bundle from a client. */
+	void begin_bundle(const Interface* client) { ++_bundle_depths[client]; }
+
+	/** Leave a client's bundle, and return true iff no bundles are open. */
+	bool end_bundle(const Interface* client) {
+		const auto d = _bundle_depths.find(client);
+		if (d != _bundle_depths.end() && --d->second == 0U) {
+			_bundle_depths.erase(d);
+		}
+
+		return _bundle_depths.empty();
+	}
+
+	/** Leave all bundles of a client, and return true iff none are open. */
+	bool end_bundles(const Interface* client) {
+		_bundle_depths.erase(client);
+		return _bundle_depths.empty();
+	}
 
 	/** Return true iff graph should be compiled now (after a change).
 	 *
@@ -50,7 +77,7 @@ public:
 			return false;
 		}
 
-		if (_in_bundle) {
+		if (in_bundle()) {
 			_dirty_graphs.insert(&graph);
 			return false;
 		}
@@ -68,15 +95,42 @@ public:
 		return must_compile(graph) ? compile(graph) : nullptr;
 	}
 
+	/** Return true iff the graph's external ports array should be built now.
+	 *
+	 * This may return false when a bundle is deferring the change, in which
+	 * case the graph is flagged so the array is built once at the end.
+	 */
+	bool must_build_ports(GraphImpl& graph) {
+		if (in_bundle()) {
+			_dirty_ports.insert(&graph);
+			return false;
+		}
+
+		return true;
+	}
+
+	/** Forget about a graph that has been removed from the engine. */
+	void forget(GraphImpl& graph) {
+		_dirty_graphs.erase(&graph);
+		_dirty_ports.erase(&graph);
+	}
+
 	/** Return all graphs that require compilation after an atomic bundle. */
 	const DirtyGraphs& dirty_graphs() const { return _dirty_graphs; }
 	DirtyGraphs&       dirty_graphs()       { return _dirty_graphs; }
 
+	/** Return all graphs that require a new ports array after a bundle. */
+	const DirtyGraphs& dirty_ports() const { return _dirty_ports; }
+	DirtyGraphs&       dirty_ports()       { return _dirty_ports; }
+
 private:
-	DirtyGraphs _dirty_graphs;
-	bool        _in_bundle = false;
+	PreProcessPool&                      _pool;
+	DirtyGraphs                          _dirty_graphs;
+	DirtyGraphs                          _dirty_ports;
+	std::map<const Interface*, unsigned> _bundle_depths; ///< Open, by client
 };
 
-} // namespace ingen::server
+} // namespace server
+} // namespace ingen
 
 #endif // INGEN_ENGINE_PREPROCESSCONTEXT_HPP
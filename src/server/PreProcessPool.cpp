@@ -0,0 +1,105 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2016 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PreProcessPool.hpp"
+
+#include "ThreadManager.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+
+namespace ingen::server {
+
+PreProcessPool::PreProcessPool(unsigned n_threads)
+{
+	for (unsigned i = 1U; i < n_threads; ++i) {
+		_threads.emplace_back(&PreProcessPool::worker, this);
+	}
+}
+
+PreProcessPool::~PreProcessPool()
+{
+	{
+		const std::lock_guard<std::mutex> lock{_mutex};
+		_exit_flag = true;
+	}
+
+	_work_cond.notify_all();
+	for (auto& thread : _threads) {
+		thread.join();
+	}
+}
+
+void
+PreProcessPool::run(size_t n, const std::function<void(size_t)>& func)
+{
+	if (_threads.empty() || n < 2U) {
+		for (size_t i = 0U; i < n; ++i) {
+			func(i);
+		}
+		return;
+	}
+
+	Lock lock{_mutex};
+	_func   = &func;
+	_n_jobs = n;
+	_next   = 0U;
+	_n_done = 0U;
+	_work_cond.notify_all();
+
+	drain(lock);
+	_done_cond.wait(lock, [this] { return _n_done == _n_jobs; });
+	_func = nullptr;
+}
+
+void
+PreProcessPool::drain(Lock& lock)
+{
+	while (_func && _next < _n_jobs) {
+		const auto&  func = *_func;
+		const size_t i    = _next++;
+
+		lock.unlock();
+		func(i);
+		lock.lock();
+
+		if (++_n_done == _n_jobs) {
+			_done_cond.notify_all();
+		}
+	}
+}
+
+void
+PreProcessPool::worker()
+{
+	ThreadManager::set_flag(THREAD_PRE_PROCESS);
+
+	Lock lock{_mutex};
+	while (true) {
+		_work_cond.wait(lock, [this] {
+			return _exit_flag || (_func && _next < _n_jobs);
+		});
+
+		if (_exit_flag) {
+			return;
+		}
+
+		drain(lock);
+	}
+}
+
+} // namespace ingen::server
@@ -0,0 +1,78 @@
+/*
+  This file is part of Ingen.
+  Copyright 2007-2016 David Robillard <http://drobilla.net/>
+
+  Ingen is free software: you can redistribute it and/or modify it under the
+  terms of the GNU Affero General Public License as published by the Free
+  Software Foundation, either version 3 of the License, or any later version.
+
+  Ingen is distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+  A PARTICULAR PURPOSE.  See the GNU Affero General Public License for details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INGEN_ENGINE_PREPROCESSPOOL_HPP
+#define INGEN_ENGINE_PREPROCESSPOOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ingen::server {
+
+/** A pool of threads for doing independent pre-processing work in parallel.
+ *
+ * This is used by events to spread work on disjoint parts of the graph, such
+ * as compiling several graphs, across cores.  The calling thread participates
+ * as well, so a pool with a single thread simply does everything in order.
+ *
+ * \ingroup engine
+ */
+class PreProcessPool
+{
+public:
+	explicit PreProcessPool(unsigned n_threads);
+
+	~PreProcessPool();
+
+	PreProcessPool(const PreProcessPool&)            = delete;
+	PreProcessPool& operator=(const PreProcessPool&) = delete;
+	PreProcessPool(PreProcessPool&&)                 = delete;
+	PreProcessPool& operator=(PreProcessPool&&)      = delete;
+
+	/** Return the number of threads, including the calling thread. */
+	size_t n_threads() const { return _threads.size() + 1U; }
+
+	/** Call `func(i)` for every `i` in [0, n) and return when all are done.
+	 *
+	 * Calls may happen concurrently in any order, so they must not touch
+	 * any shared state.  This must only be called from one thread at once.
+	 */
+	void run(size_t n, const std::function<void(size_t)>& func);
+
+private:
+	using Lock = std::unique_lock<std::mutex>;
+
+	void worker();
+	void drain(Lock& lock);
+
+	std::mutex                         _mutex;
+	std::condition_variable            _work_cond;
+	std::condition_variable            _done_cond;
+	const std::function<void(size_t)>* _func{nullptr};
+	size_t                             _n_jobs{0};
+	size_t                             _next{0};
+	size_t                             _n_done{0};
+	bool                               _exit_flag{false};
+	std::vector<std::thread>           _threads;
+};
+
+} // namespace ingen::server
+
+#endif // INGEN_ENGINE_PREPROCESSPOOL_HPP
@@ -27,19 +27,41 @@
 #include <ingen/Atom.hpp>
 #include <ingen/AtomWriter.hpp>
 #include <ingen/Configuration.hpp>
+#include <ingen/URI.hpp>
 #include <ingen/World.hpp>
 #include <raul/Semaphore.hpp>
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <cstdio>
 #include <memory>
 #include <string>
+#include <typeinfo>
+#include <utility>
 
 namespace ingen::server {
+namespace {
+
+class Stub : public Event
+{
+public:
+	explicit Stub(Engine& engine) noexcept : Event(engine) {}
+
+	bool pre_process(PreProcessContext&) override { return false; }
+	void execute(RunContext&) override {}
+	void post_process() override {}
+};
+
+} // namespace
 
 PreProcessor::PreProcessor(Engine& engine)
 	: _engine(engine)
+	, _stub(std::make_unique<Stub>(engine))
+	, _head(_stub.get())
+	, _tail(_stub.get())
+	, _pool(static_cast<unsigned>(std::max(
+	      1, engine.world().conf().option("pre-process-threads").get<int32_t>())))
 	, _thread(&PreProcessor::run, this)
 {}
 
@@ -55,36 +77,80 @@ PreProcessor::~PreProcessor()
 void
 PreProcessor::event(Event* const ev, Event::Mode mode)
 {
-	// TODO: Probably possible to make this lock-free with CAS
 	ThreadManager::assert_not_thread(THREAD_IS_REAL_TIME);
-	const std::lock_guard<std::mutex> lock{_mutex};
 
 	assert(!ev->is_prepared());
 	assert(!ev->next());
 	ev->set_mode(mode);
 
-	/* Note that tail is only used here, not in process().  The head must be
-	   checked first here, since if it is null the tail pointer is junk. */
-	const Event* const head = _head.load();
-	if (!head) {
-		_head = ev;
-		_tail = ev;
-	} else {
-		_tail.load()->next(ev);
-		_tail = ev;
-	}
+	/* Claim the tail, then link the previous tail to the new event.  Between
+	   the two, the list is briefly broken at `prev`, which consumers handle by
+	   waiting for the link rather than walking past it. */
+	Event* const prev = _tail.exchange(ev);
+	prev->next(ev);
 
 	_sem.post();
 }
 
+bool
+PreProcessor::link_successor(Event* const ev)
+{
+	if (ev->next()) {
+		return true;
+	}
+
+	// Only this thread links the stub, so it is not currently in the list
+	Event* const stub = _stub.get();
+	stub->next(nullptr);
+
+	Event* tail = ev;
+	if (!_tail.compare_exchange_strong(tail, stub)) {
+		return false; // Producer is appending to ev, try again next cycle
+	}
+
+	ev->next(stub);
+	return true;
+}
+
 unsigned
-PreProcessor::process(RunContext& ctx, PostProcessor& dest, size_t limit)
+PreProcessor::process(RunContext&    ctx,
+                      PostProcessor& dest,
+                      size_t         limit,
+                      uint64_t       budget)
 {
-	Event* const head        = _head.load();
-	size_t       n_processed = 0;
-	Event*       ev          = head;
-	Event*       last        = ev;
-	while (ev && ev->is_prepared()) {
+	const Engine&  engine = ctx.engine();
+	const uint64_t start  = budget ? engine.current_time() : 0U;
+	Event* const   stub   = _stub.get();
+	Event*       head = _head.load();
+	if (head == stub) {
+		if (!(head = stub->next())) {
+			return 0; // Queue is empty
+		}
+
+		_head = head; // Detach stub from the front
+	}
+
+	size_t n_processed = 0;
+	Event* ev          = head;
+	Event* last        = ev;
+	while (ev) {
+		if (ev == stub) {
+			// Stub was linked after the previous event, splice it out
+			Event* const next = stub->next();
+			if (!next) {
+				break;
+			}
+
+			assert(last != stub);
+			last->next(next);
+			ev = next;
+			continue;
+		}
+
+		if (!ev->is_prepared() || !link_successor(ev)) {
+			break;
+		}
+
 		switch (_block_state.load()) {
 		case BlockState::UNBLOCKED:
 			break;
@@ -120,8 +186,26 @@ PreProcessor::process(RunContext& ctx, PostProcessor& dest, size_t limit)
 			break; // Event is for a future cycle
 		}
 
+		// Defer to the next cycle if this event would likely exceed the budget
+		const std::type_info& type = typeid(*ev);
+		uint64_t              now  = 0U;
+		if (budget) {
+			now = engine.current_time();
+			if (_block_state != BlockState::PROCESSING && n_processed > 0 &&
+			    static_cast<float>(now - start) + _costs.estimate(type) >
+			        static_cast<float>(budget)) {
+				++_n_deferred;
+				break;
+			}
+		}
+
 		// Execute event
-		ev->execute(ctx);
+		if (!ev->is_superseded()) {
+			ev->execute(ctx);
+			if (budget) {
+				_costs.update(type, engine.current_time() - now);
+			}
+		}
 		++n_processed;
 
 		// Unblock pre-processing if this is a non-bundled atomic event
@@ -142,25 +226,23 @@ PreProcessor::process(RunContext& ctx, PostProcessor& dest, size_t limit)
 
 	if (n_processed > 0) {
 #ifndef NDEBUG
-		const Engine& engine = ctx.engine();
 		if (engine.world().conf().option("trace").get<int32_t>()) {
-			const uint64_t start = engine.cycle_start_time(ctx);
-			const uint64_t end   = engine.current_time();
+			const uint64_t cycle_start = engine.cycle_start_time(ctx);
+			const uint64_t end         = engine.current_time();
 			fprintf(stderr, "Processed %zu events in %u us\n",
-			        n_processed, static_cast<unsigned>(end - start));
+			        n_processed, static_cast<unsigned>(end - cycle_start));
 		}
 #endif
 
+		/* Every executed event has a successor (possibly the stub) thanks to
+		   link_successor(), so producers never touch the detached list. */
 		auto* next = last->next();
+		assert(next);
 		last->next(nullptr);
 		dest.append(ctx, head, last);
 
-		// Since _head was not null, we know it hasn't been changed since
+		// Only this thread writes _head, so it hasn't changed since
 		_head = next;
-
-		/* If next is null, then _tail may now be invalid.  However, it would cause
-		   a race to reset _tail here.  Instead, append() checks only _head for
-		   emptiness, and resets the tail appropriately. */
 	}
 
 	return n_processed;
@@ -169,7 +251,7 @@ PreProcessor::process(RunContext& ctx, PostProcessor& dest, size_t limit)
 void
 PreProcessor::run()
 {
-	PreProcessContext ctx;
+	PreProcessContext ctx{_pool};
 
 	UndoStack& undo_stack = *_engine.undo_stack();
 	UndoStack& redo_stack = *_engine.redo_stack();
@@ -180,25 +262,47 @@ PreProcessor::run()
 
 	ThreadManager::set_flag(THREAD_PRE_PROCESS);
 
+	/* Property most recently set by an undo entry.  Undo for subsequent sets
+	   of the same property is never recorded, since the entries would only
+	   be merged into the first one, which restores the original value. */
+	bool gesture = false;
+	URI  gesture_subject;
+	URI  gesture_key;
+
+	/* Number of posts taken for events that weren't reachable yet.  While
+	   there are any, wait only briefly so they are prepared once linked. */
+	unsigned n_pending = 0U;
+
 	Event* back = nullptr;
 	while (!_exit_flag) {
-		if (!_sem.timed_wait(std::chrono::seconds(1))) {
-			continue;
+		if (!n_pending) {
+			if (!_sem.timed_wait(std::chrono::seconds(1))) {
+				continue;
+			}
+			++n_pending;
+		} else if (_sem.timed_wait(std::chrono::microseconds(100))) {
+			++n_pending;
 		}
 
 		if (!back) {
 			// Ran off end, find new unprepared back
 			back = _head;
-			while (back && back->is_prepared()) {
-				back = back->next();
-			}
+		}
+
+		// Skip the stub and anything already prepared
+		while (back && (back == _stub.get() || back->is_prepared())) {
+			back = back->next();
 		}
 
 		Event* const ev = back;
 		if (!ev) {
+			/* Woken by a push that isn't reachable yet because an earlier
+			   producer hasn't linked its event, so retry shortly. */
 			continue;
 		}
 
+		--n_pending;
+
 		// Set block state before enqueueing event
 		ev->mark(ctx);
 		switch (ev->get_execution()) {
@@ -216,14 +320,39 @@ PreProcessor::run()
 
 		// Prepare event, allowing it to be processed
 		assert(!ev->is_prepared());
-		if (ev->pre_process(ctx)) {
+		ev->prefetch(ctx);
+		Event* const next = ev->next();
+		if (next && next != _stub.get() && _engine.coalesce_values() &&
+		    ev->get_execution() == Event::Execution::NORMAL &&
+		    ev->superseded_by(*next)) {
+			ev->supersede(); // Redundant, skip to the next event
+		} else if (ev->pre_process(ctx)) {
+			std::pair<const URI*, const URI*> property{nullptr, nullptr};
+			if (ev->get_mode() != Event::Mode::UNDO) {
+				property = ev->undo_property();
+			}
+
+			bool record = true;
+			if (!property.first) {
+				gesture = false;
+			} else if (gesture && *property.first == gesture_subject &&
+			           *property.second == gesture_key) {
+				record = false; // Continues gesture, undo is already written
+			} else {
+				gesture         = true;
+				gesture_subject = *property.first;
+				gesture_key     = *property.second;
+			}
+
 			switch (ev->get_mode()) {
 			case Event::Mode::NORMAL:
 			case Event::Mode::REDO:
-				undo_stack.start_entry();
-				ev->undo(undo_writer);
-				undo_stack.finish_entry();
-				// undo_stack.save(stderr);
+				if (record) {
+					undo_stack.start_entry();
+					ev->undo(undo_writer);
+					undo_stack.finish_entry();
+					// undo_stack.save(stderr);
+				}
 				break;
 			case Event::Mode::UNDO:
 				redo_stack.start_entry();
@@ -18,13 +18,16 @@
 #define INGEN_ENGINE_PREPROCESSOR_HPP
 
 #include "Event.hpp"
+#include "EventCosts.hpp"
+#include "PreProcessPool.hpp"
 
 #include <raul/Semaphore.hpp>
 
 #include <atomic>
 #include <chrono>
 #include <cstddef>
-#include <mutex>
+#include <cstdint>
+#include <memory>
 #include <thread>
 
 namespace ingen::server {
@@ -41,23 +44,44 @@ public:
 	~PreProcessor();
 
 	/** Return true iff no events are enqueued. */
-	bool empty() const { return !_head.load(); }
+	bool empty() const {
+		const Event* const head = _head.load();
+		return head == _stub.get() && !head->next();
+	}
 
 	/** Enqueue an event.
-	 * This is safe to call from any non-realtime thread (it locks).
+	 * This is lock-free and safe to call from any non-realtime thread.
 	 */
 	void event(Event* ev, Event::Mode mode);
 
 	/** Process events for a cycle.
+	 *
+	 * Events are executed until `limit` events have been processed, or until
+	 * the next event is expected to take more than the remainder of `budget`
+	 * microseconds.  At least one event is always executed, and atomic
+	 * blocks are never interrupted.  Zero means no limit for either.
+	 *
 	 * @return The number of events processed.
 	 */
 	unsigned process(RunContext&    ctx,
 	                 PostProcessor& dest,
-	                 size_t         limit = 0);
+	                 size_t         limit  = 0,
+	                 uint64_t       budget = 0);
+
+	/** Return the number of times a ready event was deferred by the budget. */
+	uint64_t n_deferred() const { return _n_deferred.load(); }
 
 protected:
 	void run();
 
+	/** Ensure `ev` has a successor so it can be detached from the queue.
+	 *
+	 * If `ev` is the tail, the stub is linked after it.  Returns false if a
+	 * producer is in the middle of appending to `ev`, in which case it can
+	 * not be detached until the link is complete.
+	 */
+	bool link_successor(Event* ev);
+
 private:
 	enum class BlockState {
 		UNBLOCKED,     ///< Normal, unblocked execution
@@ -73,12 +97,20 @@ private:
 		}
 	}
 
+	/* The queue is an intrusive multi-producer single-consumer list (after
+	   Vyukov) which is never empty: a stub event is re-linked at the tail
+	   whenever the process thread would otherwise detach the last event.
+	   The stub is never prepared, executed, or passed on. */
+
 	Engine&                 _engine;
-	std::mutex              _mutex;
+	std::unique_ptr<Event>  _stub;
 	raul::Semaphore         _sem{0};
-	std::atomic<Event*>     _head{nullptr};
-	std::atomic<Event*>     _tail{nullptr};
+	std::atomic<Event*>     _head;
+	std::atomic<Event*>     _tail;
 	std::atomic<BlockState> _block_state{BlockState::UNBLOCKED};
+	std::atomic<uint64_t>   _n_deferred{0};
+	EventCosts              _costs;
+	PreProcessPool          _pool;
 	bool                    _exit_flag{false};
 	std::thread             _thread;
 };
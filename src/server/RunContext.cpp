@@ -19,6 +19,7 @@
 #include "Broadcaster.hpp"
 #include "BufferFactory.hpp"
 #include "Engine.hpp"
+#include "MonitorSlot.hpp"
 #include "PortImpl.hpp"
 #include "Task.hpp"
 
@@ -80,7 +81,8 @@ RunContext::RunContext(const RunContext& copy)
 bool
 RunContext::must_notify(const PortImpl* port) const
 {
-	return (port->is_monitored() || _engine.broadcaster()->must_broadcast());
+	return (port->is_monitored() ||
+	        (port->is_subscribed() && _engine.broadcaster()->must_broadcast()));
 }
 
 bool
@@ -106,39 +108,52 @@ RunContext::notify(LV2_URID    key,
 }
 
 void
-RunContext::emit_notifications(FrameTime end)
+RunContext::notify_value(const URIs::Quark& key, PortImpl* port, float value)
 {
-	const URIs&    uris       = _engine.buffer_factory()->uris();
-	const uint32_t read_space = _event_sink->read_space();
-	Notification   note;
-	for (uint32_t i = 0; i < read_space; i += sizeof(note)) {
-		if (_event_sink->peek(sizeof(note), &note) != sizeof(note) ||
-		    note.time >= end) {
-			return;
-		}
-		if (_event_sink->read(sizeof(note), &note) == sizeof(note)) {
-			Atom value = Forge::alloc(note.size, note.type, nullptr);
-			if (_event_sink->read(note.size, value.get_body()) == note.size) {
-				i += note.size;
-				const char* key = _engine.world().uri_map().unmap_uri(note.key);
-				if (key) {
-					_engine.broadcaster()->set_property(
-						note.port->uri(), URI(key), value);
-					if (note.port->is_input() &&
-					    (note.key == uris.ingen_value ||
-					     note.key == uris.midi_binding)) {
-						// FIXME: not thread safe
-						note.port->set_property(URI(key), value);
-					}
-				} else {
-					_engine.log().rt_error("Error unmapping notification key URI\n");
-				}
-			} else {
-				_engine.log().rt_error("Error reading body from notification ring\n");
-			}
-		} else {
-			_engine.log().rt_error("Error reading header from notification ring\n");
-		}
+	MonitorSlot& slot = port->monitor_slot();
+	slot.write(key, value);
+	_engine.monitor_queue().push(port, slot);
+}
+
+bool
+RunContext::next_notification_time(FrameTime& time) const
+{
+	Notification note;
+	if (_event_sink->peek(sizeof(note), &note) != sizeof(note)) {
+		return false;
+	}
+
+	time = note.time;
+	return true;
+}
+
+void
+RunContext::emit_notification()
+{
+	const URIs&  uris = _engine.buffer_factory()->uris();
+	Notification note;
+	if (_event_sink->read(sizeof(note), &note) != sizeof(note)) {
+		_engine.log().rt_error("Error reading header from notification ring\n");
+		return;
+	}
+
+	Atom value = Forge::alloc(note.size, note.type, nullptr);
+	if (_event_sink->read(note.size, value.get_body()) != note.size) {
+		_engine.log().rt_error("Error reading body from notification ring\n");
+		return;
+	}
+
+	const char* key = _engine.world().uri_map().unmap_uri(note.key);
+	if (!key) {
+		_engine.log().rt_error("Error unmapping notification key URI\n");
+		return;
+	}
+
+	_engine.broadcaster()->set_property(note.port->uri(), URI(key), value);
+	if (note.port->is_input() &&
+	    (note.key == uris.ingen_value || note.key == uris.midi_binding)) {
+		// FIXME: not thread safe
+		note.port->set_property(URI(key), value);
 	}
 }
 
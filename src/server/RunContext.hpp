@@ -19,6 +19,7 @@
 
 #include "types.hpp"
 
+#include <ingen/URIs.hpp>
 #include <lv2/urid/urid.h>
 #include <raul/RingBuffer.hpp>
 
@@ -88,8 +89,21 @@ public:
 	            LV2_URID    type = 0,
 	            const void* body = nullptr);
 
-	/** Emit pending notifications in some other non-realtime thread. */
-	void emit_notifications(FrameTime end);
+	/** Publish the latest scalar value of a port.
+	 *
+	 * Unlike notify(), this can not fail.  Only the latest value is kept for
+	 * each port, which is sent by the next call to
+	 * Engine::emit_monitored_values().
+	 */
+	void notify_value(const URIs::Quark& key, PortImpl* port, float value);
+
+	/** Get the time of the next pending notification.
+	 * @return false if there are no pending notifications.
+	 */
+	bool next_notification_time(FrameTime& time) const;
+
+	/** Emit the next pending notification in some other non-realtime thread. */
+	void emit_notification();
 
 	/** Return true iff any notifications are pending. */
 	bool pending_notifications() const { return _event_sink->read_space(); }
@@ -18,6 +18,7 @@
 
 #include "Engine.hpp"
 #include "SocketServer.hpp"
+#include "ingen_config.h"
 
 #include <ingen/Atom.hpp>
 #include <ingen/Configuration.hpp>
@@ -41,6 +42,11 @@
 #include <string>
 #include <thread>
 
+namespace ingen {
+class ShmSession;
+class SocketHub;
+} // namespace ingen
+
 namespace ingen::server {
 namespace {
 
@@ -68,14 +74,30 @@ get_link_target(const char* link_path)
 }
 
 void
-ingen_listen(Engine* engine, raul::Socket* unix_sock, raul::Socket* net_sock);
+ingen_listen(Engine*       engine,
+             SocketHub*    hub,
+             raul::Socket* unix_sock,
+             raul::Socket* net_sock);
 
 } // namespace
 
 SocketListener::SocketListener(Engine& engine)
+#if USE_EPOLL
+	: hub(std::make_unique<SocketHub>(
+		  engine.world(),
+		  static_cast<unsigned>(
+			  engine.world().conf().option("io-threads").get<int32_t>()),
+		  engine.shm_values()))
+	, unix_sock(raul::Socket::Type::UNIX)
+	, net_sock(raul::Socket::Type::TCP)
+	, thread(new std::thread(
+		  ingen_listen, &engine, hub.get(), &unix_sock, &net_sock))
+#else
 	: unix_sock(raul::Socket::Type::UNIX)
 	, net_sock(raul::Socket::Type::TCP)
-	, thread(new std::thread(ingen_listen, &engine, &unix_sock, &net_sock))
+	, thread(new std::thread(
+		  ingen_listen, &engine, nullptr, &unix_sock, &net_sock))
+#endif
 {}
 
 SocketListener::~SocketListener() {
@@ -87,8 +109,42 @@ SocketListener::~SocketListener() {
 
 namespace {
 
+/** Start serving a new connection.
+ *
+ * With a hub, the connection is read by its I/O threads, which keep the
+ * server alive until the connection is closed.  Otherwise, the server reads
+ * in a thread of its own.
+ */
+void
+serve(World&                               world,
+      Engine&                              engine,
+      SocketHub*                           hub,
+      const std::shared_ptr<raul::Socket>& conn)
+{
+#if USE_EPOLL
+	if (hub) {
+		const auto server = std::make_shared<SocketServer>(world, engine, conn);
+		hub->add(
+			conn,
+			server->sink(),
+			[server, &world](SocketFormat                       format,
+			                 const std::shared_ptr<ShmSession>& session) {
+				server->start(world, format, session);
+			},
+			[server] { server->on_hangup(); });
+		return;
+	}
+#endif
+
+	auto* const server = new SocketServer(world, engine, conn);
+	server->read(world);
+}
+
 void
-ingen_listen(Engine* engine, raul::Socket* unix_sock, raul::Socket* net_sock)
+ingen_listen(Engine*       engine,
+             SocketHub*    hub,
+             raul::Socket* unix_sock,
+             raul::Socket* net_sock)
 {
 	ingen::World& world = engine->world();
 
@@ -182,14 +238,14 @@ ingen_listen(Engine* engine, raul::Socket* unix_sock, raul::Socket* net_sock)
 		if (pfds[0].revents & POLLIN) {
 			auto conn = unix_sock->accept();
 			if (conn) {
-				new SocketServer(world, *engine, conn);
+				serve(world, *engine, hub, conn);
 			}
 		}
 
 		if (pfds[1].revents & POLLIN) {
 			auto conn = net_sock->accept();
 			if (conn) {
-				new SocketServer(world, *engine, conn);
+				serve(world, *engine, hub, conn);
 			}
 		}
 	}
@@ -14,6 +14,11 @@
   along with Ingen.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include "ingen_config.h"
+
+#if USE_EPOLL
+#include <ingen/SocketHub.hpp>
+#endif
 #include <raul/Socket.hpp>
 
 #include <memory>
@@ -31,6 +36,9 @@ public:
 	~SocketListener();
 
 private:
+#if USE_EPOLL
+	std::unique_ptr<SocketHub>   hub;
+#endif
 	raul::Socket                 unix_sock;
 	raul::Socket                 net_sock;
 	std::unique_ptr<std::thread> thread;
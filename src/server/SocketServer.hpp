@@ -17,14 +17,20 @@
 #ifndef INGEN_SERVER_SOCKET_SERVER_HPP
 #define INGEN_SERVER_SOCKET_SERVER_HPP
 
+#include "ClientQueue.hpp"
 #include "EventWriter.hpp"
+#include "events/Mark.hpp"
 
 #include "Engine.hpp"
+#include "ingen_config.h"
 
 #include <ingen/Atom.hpp>
+#include <ingen/AtomProtocol.hpp>
 #include <ingen/ColorContext.hpp>
 #include <ingen/Configuration.hpp>
 #include <ingen/Interface.hpp>
+#include <ingen/ShmTransport.hpp>
+#include <ingen/ShmWriter.hpp>
 #include <ingen/SocketReader.hpp>
 #include <ingen/SocketWriter.hpp>
 #include <ingen/StreamWriter.hpp>
@@ -33,9 +39,11 @@
 #include <ingen/World.hpp>
 #include <raul/Socket.hpp>
 
+#include <cstddef>
 #include <cstdint>
 #include <cstdio>
 #include <memory>
+#include <utility>
 
 namespace ingen::server {
 
@@ -56,33 +64,113 @@ public:
 					                                          stderr,
 					                                          ColorContext::Color::CYAN))}))
 		        : std::shared_ptr<Interface>(new EventWriter(engine)))
-		, _reader(new SocketReader(world, *_sink, sock))
-		, _writer(new SocketWriter(world.uri_map(),
-		                           world.uris(),
-		                           URI(sock->uri()),
-		                           sock))
-	{
-		_sink->set_respondee(_writer);
-		engine.register_client(_writer);
-	}
+		, _socket(sock)
+	{}
+
+	SocketServer(const SocketServer&)            = delete;
+	SocketServer& operator=(const SocketServer&) = delete;
+	SocketServer(SocketServer&&)                 = delete;
+	SocketServer& operator=(SocketServer&&)      = delete;
 
 	~SocketServer() {
-		if (_writer) {
-			_engine.unregister_client(_writer);
+		if (_client) {
+			_engine.unregister_client(_client);
 		}
+		if (_shm) {
+			_engine.detach_shm_session();
+		}
+	}
+
+	/** Read messages from the client in a dedicated thread. */
+	void read(World& world) {
+		_reader = std::make_shared<SocketReader>(
+			world, *_sink, _socket, [this, &world](SocketFormat format) {
+				start(world, format);
+			});
 	}
 
-protected:
+	/// Return the interface that handles messages from the client
+	Interface& sink() { return *_sink; }
+
+	/** Start sending to the client, called once its format is known.
+	 *
+	 * For SocketFormat::SHM, `session` is the shared memory to send through.
+	 */
+	void start(World&                             world,
+	           SocketFormat                       format,
+	           const std::shared_ptr<ShmSession>& session = nullptr) {
+		const std::shared_ptr<raul::Socket> sock = std::move(_socket);
+		const Configuration&                conf = world.conf();
+
+		std::shared_ptr<Interface> writer;
+		ClientQueue::Flush         flush;
+#if USE_SHM
+		if (format == SocketFormat::SHM) {
+			// Start publishing port values, which the client reads directly
+			_engine.attach_shm_session();
+			_shm   = true;
+			writer = std::make_shared<ShmWriter>(world.uri_map(),
+			                                     world.uris(),
+			                                     URI(sock->uri()),
+			                                     session,
+			                                     session->to_client(),
+			                                     sock);
+		}
+#endif
+		if (!writer) {
+			auto socket_writer =
+				std::make_shared<SocketWriter>(world.uri_map(),
+				                               world.uris(),
+				                               URI(sock->uri()),
+				                               sock,
+				                               format);
+#if USE_EPOLL
+			// Let the writer pool wait for the socket instead of blocking
+			socket_writer->set_nonblocking(true);
+			flush = [socket_writer, fd = sock->fd()] {
+				return socket_writer->flush() ? -1 : fd;
+			};
+#endif
+			writer = std::move(socket_writer);
+		}
+
+		// Send everything through a queue, so a slow client only stalls itself
+		_client = std::make_shared<ClientQueue>(
+			std::move(writer),
+			*_engine.client_writers(),
+			world.uris(),
+			world.log(),
+			static_cast<size_t>(conf.option("client-queue").get<int32_t>()),
+			ClientQueue::parse_overflow(
+				conf.option("client-overflow").ptr<char>()),
+			[sock] { sock->shutdown(); },
+			std::move(flush));
+
+		_sink->set_respondee(_client);
+		_engine.register_client(_client);
+	}
+
+	/** Stop sending to the client, called once the connection is closed. */
 	void on_hangup() {
-		_engine.unregister_client(_writer);
-		_writer.reset();
+		if (_client) {
+			// End any bundles the client left open, after its last events
+			_engine.enqueue_event(new events::Mark(_engine, _client));
+			_engine.unregister_client(_client);
+			_client.reset();
+		}
+		if (_shm) {
+			_engine.detach_shm_session();
+			_shm = false;
+		}
 	}
 
 private:
 	server::Engine&               _engine;
 	std::shared_ptr<Interface>    _sink;
-	std::shared_ptr<SocketReader> _reader;
-	std::shared_ptr<SocketWriter> _writer;
+	std::shared_ptr<raul::Socket> _socket; ///< Until the writer is started
+	std::shared_ptr<ClientQueue>  _client;
+	std::shared_ptr<SocketReader> _reader; ///< Unless read by a SocketHub
+	bool                          _shm{false}; ///< Counted as a shm session
 };
 
 } // namespace ingen::server
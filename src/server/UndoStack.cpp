@@ -25,7 +25,12 @@
 #include <serd/serd.h>
 #include <sratom/sratom.h>
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <ctime>
+#include <vector>
 
 #define NS_RDF "http://www.w3.org/1999/02/22-rdf-syntax-ns#"
 
@@ -33,13 +38,91 @@
 
 namespace ingen::server {
 
+UndoStack::Position
+UndoStack::end_position() const
+{
+	if (_chunks.empty()) {
+		return {_first_chunk, 0U};
+	}
+
+	return {_first_chunk + _chunks.size() - 1U, _chunks.back().used};
+}
+
+void*
+UndoStack::alloc(const size_t size)
+{
+	if (_chunks.empty() ||
+	    _chunks.back().used + size > _chunks.back().capacity) {
+		_chunks.emplace_back(std::max(chunk_size, size));
+	}
+
+	Chunk& back = _chunks.back();
+	void*  ptr  = back.bytes() + back.used;
+	back.used += size;
+	return ptr;
+}
+
+std::vector<const LV2_Atom*>
+UndoStack::events(const Record& record)
+{
+	std::vector<const LV2_Atom*> result;
+	result.reserve(record.n_events);
+
+	Position pos = record.begin;
+	for (uint32_t i = 0U; i < record.n_events; ++i) {
+		if (pos.offset == chunk(pos.chunk).used) {
+			// Event didn't fit in the previous chunk, so it starts the next
+			pos = {pos.chunk + 1U, 0U};
+		}
+
+		const auto* const atom = reinterpret_cast<const LV2_Atom*>(
+			chunk(pos.chunk).bytes() + pos.offset);
+
+		result.push_back(atom);
+		pos.offset += lv2_atom_pad_size(lv2_atom_total_size(atom));
+	}
+
+	return result;
+}
+
+void
+UndoStack::pop_record()
+{
+	const Record& back = _records.back();
+
+	// Entries are stored in order, so the last one is at the end of memory
+	while (_first_chunk + _chunks.size() > back.begin.chunk + 1U) {
+		_chunks.pop_back();
+	}
+	if (!_chunks.empty()) {
+		_chunks.back().used = back.begin.offset;
+	}
+
+	_n_bytes -= back.n_bytes;
+	_records.pop_back();
+}
+
+void
+UndoStack::evict_record()
+{
+	_n_bytes -= _records.front().n_bytes;
+	_records.pop_front();
+
+	// Free chunks that no longer contain any entries
+	const size_t first_used = _records.front().begin.chunk;
+	while (_first_chunk < first_used) {
+		_chunks.pop_front();
+		++_first_chunk;
+	}
+}
+
 int
 UndoStack::start_entry()
 {
 	if (_depth == 0) {
 		time_t now = {};
 		time(&now);
-		_stack.emplace_back(now);
+		_records.push_back({now, end_position(), 0U, 0U});
 	}
 	return ++_depth;
 }
@@ -47,7 +130,15 @@ UndoStack::start_entry()
 bool
 UndoStack::write(const LV2_Atom* msg, int32_t)
 {
-	_stack.back().push_event(msg);
+	const uint32_t size   = lv2_atom_total_size(msg);
+	const size_t   padded = lv2_atom_pad_size(size);
+
+	memcpy(alloc(padded), msg, size);
+
+	Record& back = _records.back();
+	++back.n_events;
+	back.n_bytes += padded;
+	_n_bytes += padded;
 	return true;
 }
 
@@ -85,19 +176,25 @@ int
 UndoStack::finish_entry()
 {
 	if (--_depth == 0) {
-		if (_stack.back().events.empty()) {
+		if (_records.back().n_events == 0U) {
 			// Disregard empty entry
-			_stack.pop_back();
-		} else if (_stack.size() > 1 && _stack.back().events.size() == 1) {
+			pop_record();
+		} else if (_records.size() > 1 && _records.back().n_events == 1U) {
 			// This entry and the previous one have one event, attempt to merge
-			auto i = _stack.rbegin();
-			++i;
-			if (i->events.size() == 1) {
-				if (ignore_later_event(i->events[0], _stack.back().events[0])) {
-					_stack.pop_back();
-				}
+			const Record& prev = _records[_records.size() - 2U];
+			if (prev.n_events == 1U &&
+			    ignore_later_event(events(prev)[0],
+			                       events(_records.back())[0])) {
+				pop_record();
 			}
 		}
+
+		// Drop the oldest entries if the stack has grown too large
+		while (_records.size() > 1U &&
+		       ((_max_bytes && _n_bytes > _max_bytes) ||
+		        (_max_entries && _records.size() > _max_entries))) {
+			evict_record();
+		}
 	}
 
 	return _depth;
@@ -107,9 +204,12 @@ UndoStack::Entry
 UndoStack::pop()
 {
 	Entry top;
-	if (!_stack.empty()) {
-		top = _stack.back();
-		_stack.pop_back();
+	if (!_records.empty()) {
+		top.time = _records.back().time;
+		for (const LV2_Atom* ev : events(_records.back())) {
+			top.push_event(ev);
+		}
+		pop_record();
 	}
 	return top;
 }
@@ -177,13 +277,14 @@ struct ListContext {
 };
 
 void
-UndoStack::write_entry(Sratom*                 sratom,
-                       SerdWriter*             writer,
-                       const SerdNode* const   subject,
-                       const UndoStack::Entry& entry)
+UndoStack::write_entry(Sratom*                             sratom,
+                       SerdWriter*                         writer,
+                       const SerdNode* const               subject,
+                       const Record&                       record,
+                       const std::vector<const LV2_Atom*>& events)
 {
 	char time_str[24];
-	strftime(time_str, sizeof(time_str), "%FT%T", gmtime(&entry.time));
+	strftime(time_str, sizeof(time_str), "%FT%T", gmtime(&record.time));
 
 	// entry rdf:type ingen:UndoEntry
 	SerdNode       p = serd_node_from_string(SERD_URI, USTR(INGEN_NS "time"));
@@ -195,8 +296,10 @@ UndoStack::write_entry(Sratom*                 sratom,
 	BlankIDs    ids('e');
 	ListContext ctx(ids, SERD_ANON_CONT, subject, &p);
 
-	for (const LV2_Atom* atom : entry.events) {
-		const SerdNode node = ctx.start_node(writer);
+	// Events are undone in the reverse order they were written
+	for (auto i = events.rbegin(); i != events.rend(); ++i) {
+		const LV2_Atom* const atom = *i;
+		const SerdNode        node = ctx.start_node(writer);
 
 		p = serd_node_from_string(SERD_URI,
 		                          reinterpret_cast<const uint8_t*>(NS_RDF
@@ -248,10 +351,10 @@ UndoStack::save(FILE* stream, const char* name)
 
 	BlankIDs    ids('u');
 	ListContext ctx(ids, 0, &s, &p);
-	for (const Entry& e : _stack) {
+	for (const Record& r : _records) {
 		const SerdNode entry = ids.get();
 		ctx.append(writer, SERD_ANON_O_BEGIN, &entry);
-		write_entry(sratom, writer, &entry, e);
+		write_entry(sratom, writer, &entry, r, events(r));
 		serd_writer_end_anon(writer, &entry);
 	}
 	ctx.end(writer);
@@ -24,12 +24,15 @@
 #include <server.h>
 #include <sratom/sratom.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
 #include <deque>
+#include <memory>
+#include <vector>
 
 namespace ingen {
 
@@ -38,6 +41,13 @@ class URIs;
 
 namespace server {
 
+/** A stack of undo (or redo) entries.
+ *
+ * Each entry is a list of messages that reverse the effects of an event or
+ * bundle.  Messages are stored back to back in large chunks, which are only
+ * allocated as the history grows, and the oldest entries are dropped once
+ * the stack exceeds its size or entry limit.
+ */
 class INGEN_SERVER_API UndoStack : public AtomSink
 {
 public:
@@ -84,30 +94,91 @@ public:
 		std::deque<LV2_Atom*> events;
 	};
 
-	UndoStack(URIs& uris, URIMap& map) noexcept : _uris(uris), _map(map) {}
+	/** Create an undo stack.
+	 *
+	 * @param max_bytes Maximum size of all messages, or zero for no limit.
+	 * @param max_entries Maximum number of entries, or zero for no limit.
+	 */
+	UndoStack(URIs&  uris,
+	          URIMap& map,
+	          size_t max_bytes   = 0U,
+	          size_t max_entries = 0U) noexcept
+		: _uris(uris)
+		, _map(map)
+		, _max_bytes(max_bytes)
+		, _max_entries(max_entries)
+	{}
 
 	int  start_entry();
 	bool write(const LV2_Atom* msg, int32_t default_id=0) override;
 	int  finish_entry();
 
-	bool  empty() const { return _stack.empty(); }
+	bool  empty() const { return _records.empty(); }
 	Entry pop();
 
+	/** Return the total size of all messages in the stack. */
+	size_t n_bytes() const { return _n_bytes; }
+
 	void save(FILE* stream, const char* name="undo");
 
 private:
+	/** A block of memory that messages are appended to. */
+	struct Chunk {
+		explicit Chunk(size_t n_bytes)
+			: data(new uint64_t[(n_bytes + 7U) / 8U])
+			, capacity((n_bytes + 7U) / 8U * 8U)
+		{}
+
+		uint8_t* bytes() { return reinterpret_cast<uint8_t*>(data.get()); }
+
+		std::unique_ptr<uint64_t[]> data;
+		size_t                      capacity;
+		size_t                      used{0U};
+	};
+
+	/** The location of a message, by chunk sequence number and offset. */
+	struct Position {
+		size_t chunk;
+		size_t offset;
+	};
+
+	/** An entry, whose messages are stored contiguously from `begin`. */
+	struct Record {
+		time_t   time;
+		Position begin;
+		uint32_t n_events;
+		size_t   n_bytes;
+	};
+
+	static constexpr size_t chunk_size = 65536U;
+
+	Chunk&   chunk(size_t index) { return _chunks[index - _first_chunk]; }
+	Position end_position() const;
+	void*    alloc(size_t size);
+	void     pop_record();
+	void     evict_record();
+
+	/** Return the messages of `record` in the order they were written. */
+	std::vector<const LV2_Atom*> events(const Record& record);
+
 	bool ignore_later_event(const LV2_Atom* first,
 	                        const LV2_Atom* second) const;
 
-	void write_entry(Sratom*         sratom,
-	                 SerdWriter*     writer,
-	                 const SerdNode* subject,
-	                 const Entry&    entry);
-
-	URIs&             _uris;
-	URIMap&           _map;
-	std::deque<Entry> _stack;
-	int               _depth{0};
+	void write_entry(Sratom*                             sratom,
+	                 SerdWriter*                         writer,
+	                 const SerdNode*                     subject,
+	                 const Record&                       record,
+	                 const std::vector<const LV2_Atom*>& events);
+
+	URIs&              _uris;
+	URIMap&            _map;
+	std::deque<Chunk>  _chunks;
+	std::deque<Record> _records;
+	size_t             _first_chunk{0U};
+	size_t             _n_bytes{0U};
+	size_t             _max_bytes;
+	size_t             _max_entries;
+	int                _depth{0};
 };
 
 } // namespace server
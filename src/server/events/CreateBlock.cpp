@@ -24,8 +24,10 @@
 #include "Engine.hpp"
 #include "GraphImpl.hpp"
 #include "LV2Block.hpp"
+#include "LV2Plugin.hpp"
 #include "PluginImpl.hpp"
 #include "PreProcessContext.hpp"
+#include "PreProcessPool.hpp"
 #include "State.hpp"
 #include "types.hpp"
 
@@ -44,10 +46,15 @@
 #include <raul/Path.hpp>
 #include <raul/Symbol.hpp>
 
+#include <cstddef>
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace ingen::server::events {
 
@@ -64,12 +71,137 @@ CreateBlock::CreateBlock(Engine&                           engine,
 
 CreateBlock::~CreateBlock() = default;
 
+std::optional<URI>
+CreateBlock::prototype()
+{
+	const ingen::URIs& uris = _engine.world().uris();
+
+	// Map old ingen:prototype to new lv2:prototype
+	const auto range = _properties.equal_range(uris.ingen_prototype);
+	for (auto i = range.first; i != range.second;) {
+		const auto value = i->second;
+		auto       next  = i;
+		next = _properties.erase(i);
+		_properties.emplace(uris.lv2_prototype, value);
+		i = next;
+	}
+
+	// Get prototype
+	const auto t = _properties.find(uris.lv2_prototype);
+	if (t == _properties.end() || !uris.forge.is_uri(t->second)) {
+		return std::nullopt;
+	}
+
+	return URI(uris.forge.str(t->second, false));
+}
+
+bool
+CreateBlock::polyphonic() const
+{
+	const ingen::URIs& uris = _engine.world().uris();
+	const auto         p    = _properties.find(uris.ingen_polyphonic);
+
+	return (p != _properties.end() &&
+	        p->second.type() == uris.forge.Bool &&
+	        p->second.get<int32_t>());
+}
+
+StatePtr
+CreateBlock::load_state() const
+{
+	// Load state from directory if given in properties
+	const ingen::URIs& uris = _engine.world().uris();
+	const auto         s    = _properties.find(uris.state_state);
+	if (s != _properties.end() && s->second.type() == uris.forge.Path) {
+		return LV2Block::load_state(_engine.world(),
+		                            FilePath(s->second.ptr<char>()));
+	}
+
+	return StatePtr{};
+}
+
+/** Set up the block ahead of pre-processing if it is a new LV2 block.
+ *
+ * This makes a block like pre_process() would, but stops short of creating
+ * the instances, which create_instances() does later in parallel.
+ */
+bool
+CreateBlock::prepare_ahead()
+{
+	const std::shared_ptr<Store> store     = _engine.store();
+	const std::optional<URI>     prototype = this->prototype();
+	if (_path.is_root() || store->get(_path) || !prototype ||
+	    uri_is_path(*prototype)) {
+		return false;
+	}
+
+	auto* const graph = dynamic_cast<GraphImpl*>(store->get(_path.parent()));
+	auto* const plugin =
+	    dynamic_cast<LV2Plugin*>(_engine.block_factory()->plugin(*prototype));
+	if (!graph || !plugin) {
+		return false;
+	}
+
+	_ahead_state = load_state();
+	_ahead       = std::make_unique<LV2Block>(plugin,
+	                                          raul::Symbol(_path.symbol()),
+	                                          polyphonic(),
+	                                          graph,
+	                                          _engine.sample_rate());
+
+	if (!_ahead->prepare(*_engine.buffer_factory(), _ahead_state.get())) {
+		_ahead.reset();
+		return false;
+	}
+
+	return true;
+}
+
+void
+CreateBlock::instantiate_ahead(PreProcessContext&               ctx,
+                               const std::vector<CreateBlock*>& events)
+{
+	if (events.empty()) {
+		return;
+	}
+
+	// Set up blocks in order, which uses the store and the lilv world
+	std::vector<CreateBlock*> prepared;
+	{
+		const std::shared_ptr<Store> store = events.front()->_engine.store();
+		const std::lock_guard<Store::Mutex> lock{store->mutex()};
+		for (CreateBlock* const ev : events) {
+			if (ev->prepare_ahead()) {
+				prepared.push_back(ev);
+			}
+		}
+	}
+
+	// Create plugin instances for all blocks in parallel
+	std::vector<uint8_t> succeeded(prepared.size(), 0U);
+	ctx.pool().run(prepared.size(), [&prepared, &succeeded](size_t i) {
+		CreateBlock& ev = *prepared[i];
+		succeeded[i] = ev._ahead->create_instances(*ev._engine.buffer_factory());
+	});
+
+	// Drop failed blocks, which pre_process() tries again to report the error
+	for (size_t i = 0U; i < prepared.size(); ++i) {
+		prepared[i]->_ahead_state.reset();
+		if (!succeeded[i]) {
+			prepared[i]->_ahead.reset();
+		}
+	}
+}
+
 bool
 CreateBlock::pre_process(PreProcessContext& ctx)
 {
 	const ingen::URIs&           uris  = _engine.world().uris();
 	const std::shared_ptr<Store> store = _engine.store();
 
+	// Take any block instantiated ahead, which is dropped if it is not used
+	std::unique_ptr<LV2Block> ahead = std::move(_ahead);
+
 	// Check sanity of target path
 	if (_path.is_root()) {
 		return Event::pre_process_done(Status::BAD_URI, _path);
@@ -83,30 +215,15 @@ CreateBlock::pre_process(PreProcessContext& ctx)
 		return Event::pre_process_done(Status::PARENT_NOT_FOUND, _path.parent());
 	}
 
-	// Map old ingen:prototype to new lv2:prototype
-	const auto range = _properties.equal_range(uris.ingen_prototype);
-	for (auto i = range.first; i != range.second;) {
-		const auto value = i->second;
-		auto       next  = i;
-		next = _properties.erase(i);
-		_properties.emplace(uris.lv2_prototype, value);
-		i = next;
-	}
-
 	// Get prototype
-	const auto t = _properties.find(uris.lv2_prototype);
-	if (t == _properties.end() || !uris.forge.is_uri(t->second)) {
+	const std::optional<URI> found_prototype = this->prototype();
+	if (!found_prototype) {
 		// Missing/invalid prototype
 		return Event::pre_process_done(Status::BAD_REQUEST);
 	}
 
-	const URI prototype(uris.forge.str(t->second, false));
-
-	// Find polyphony
-	const auto p          = _properties.find(uris.ingen_polyphonic);
-	const bool polyphonic = (p != _properties.end() &&
-	                         p->second.type() == uris.forge.Bool &&
-	                         p->second.get<int32_t>());
+	const URI  prototype  = *found_prototype;
+	const bool polyphonic = this->polyphonic();
 
 	// Find and instantiate/duplicate prototype (plugin/existing node)
 	if (uri_is_path(prototype)) {
@@ -136,22 +253,21 @@ CreateBlock::pre_process(PreProcessContext& ctx)
 			return Event::pre_process_done(Status::PROTOTYPE_NOT_FOUND, prototype);
 		}
 
-		// Load state from directory if given in properties
-		StatePtr state{};
-		auto s = _properties.find(uris.state_state);
-		if (s != _properties.end() && s->second.type() == uris.forge.Path) {
-			state = LV2Block::load_state(
-				_engine.world(), FilePath(s->second.ptr<char>()));
-		}
-
-		// Instantiate plugin
-		if (!(_block = plugin->instantiate(*_engine.buffer_factory(),
-		                                   raul::Symbol(_path.symbol()),
-		                                   polyphonic,
-		                                   _graph,
-		                                   _engine,
-		                                   state.get()))) {
-			return Event::pre_process_done(Status::CREATION_FAILED, _path);
+		if (ahead && ahead->parent_graph() == _graph &&
+		    ahead->plugin_impl() == plugin) {
+			// Use block instantiated ahead by instantiate_ahead()
+			_block = ahead.release();
+		} else {
+			// Instantiate plugin
+			const StatePtr state = load_state();
+			if (!(_block = plugin->instantiate(*_engine.buffer_factory(),
+			                                   raul::Symbol(_path.symbol()),
+			                                   polyphonic,
+			                                   _graph,
+			                                   _engine,
+			                                   state.get()))) {
+				return Event::pre_process_done(Status::CREATION_FAILED, _path);
+			}
 		}
 	}
 
@@ -170,6 +286,13 @@ CreateBlock::pre_process(PreProcessContext& ctx)
 
 	_update.put_block(_block);
 
+	// Make spare instances in the background if the graph keeps them
+	auto* const lv2_block = dynamic_cast<LV2Block*>(_block);
+	if (lv2_block && _graph->spare_voices()) {
+		lv2_block->request_spares(*_engine.idle_worker(),
+		                          _graph->spare_voices());
+	}
+
 	return Event::pre_process_done(Status::SUCCESS);
 }
 
@@ -19,12 +19,17 @@
 
 #include "ClientUpdate.hpp"
 #include "Event.hpp"
+#include "State.hpp"
 #include "types.hpp"
 
+#include <ingen/URI.hpp>
 #include <raul/Path.hpp>
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <optional>
+#include <vector>
 
 namespace ingen {
 
@@ -37,6 +42,7 @@ class BlockImpl;
 class CompiledGraph;
 class Engine;
 class GraphImpl;
+class LV2Block;
 
 namespace events {
 
@@ -61,12 +67,32 @@ public:
 	void post_process() override;
 	void undo(Interface& target) override;
 
+	/// Maximum number of blocks instantiated ahead at once
+	static constexpr size_t max_ahead = 64U;
+
+	/** Instantiate the blocks for several events ahead of pre-processing.
+	 *
+	 * The slow part, creating plugin instances and restoring their initial
+	 * state, is done for all events in parallel.  Each event then adds its
+	 * block to the graph in order when it is pre-processed as usual.  Events
+	 * that don't create an LV2 block, or where this fails, are unaffected.
+	 */
+	static void instantiate_ahead(PreProcessContext&               ctx,
+	                              const std::vector<CreateBlock*>& events);
+
 private:
+	std::optional<URI> prototype();
+	bool               polyphonic() const;
+	StatePtr           load_state() const;
+	bool               prepare_ahead();
+
 	raul::Path                       _path;
 	Properties&                      _properties;
 	ClientUpdate                     _update;
 	GraphImpl*                       _graph{nullptr};
 	BlockImpl*                       _block{nullptr};
+	std::unique_ptr<LV2Block>        _ahead;
+	StatePtr                         _ahead_state;
 	std::unique_ptr<CompiledGraph>   _compiled_graph;
 };
 
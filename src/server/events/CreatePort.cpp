@@ -24,6 +24,7 @@
 #include "GraphImpl.hpp"
 #include "PortImpl.hpp"
 #include "PortType.hpp"
+#include "PreProcessContext.hpp"
 
 #include <ingen/Atom.hpp>
 #include <ingen/Forge.hpp>
@@ -90,7 +91,7 @@ CreatePort::CreatePort(Engine&                           engine,
 }
 
 bool
-CreatePort::pre_process(PreProcessContext&)
+CreatePort::pre_process(PreProcessContext& ctx)
 {
 	if (_port_type == PortType::UNKNOWN || !_flow) {
 		return Event::pre_process_done(Status::UNKNOWN_TYPE, _path);
@@ -175,22 +176,24 @@ CreatePort::pre_process(PreProcessContext&)
 		_engine_port = _engine.driver()->create_port(_graph_port);
 	}
 
-	_ports_array = bufs.maid().make_managed<GraphImpl::Ports>(
-		old_n_ports + 1, nullptr);
+	if (ctx.must_build_ports(*_graph)) {
+		_ports_array = bufs.maid().make_managed<GraphImpl::Ports>(
+			old_n_ports + 1, nullptr);
+	}
 
 	_update = _graph_port->properties();
 
 	assert(_graph_port->index() == static_cast<uint32_t>(index_i->second.get<int32_t>()));
 	assert(_graph->num_ports_non_rt() == static_cast<uint32_t>(old_n_ports) + 1U);
-	assert(_ports_array->size() == _graph->num_ports_non_rt());
-	assert(_graph_port->index() < _ports_array->size());
+	assert(!_ports_array || _ports_array->size() == _graph->num_ports_non_rt());
+	assert(!_ports_array || _graph_port->index() < _ports_array->size());
 	return Event::pre_process_done(Status::SUCCESS);
 }
 
 void
 CreatePort::execute(RunContext& ctx)
 {
-	if (_status == Status::SUCCESS) {
+	if (_status == Status::SUCCESS && _ports_array) {
 		const auto& old_ports = _graph->external_ports();
 		if (old_ports) {
 			for (uint32_t i = 0; i < old_ports->size(); ++i) {
@@ -202,10 +205,10 @@ CreatePort::execute(RunContext& ctx)
 		assert(!(*_ports_array)[_graph_port->index()]);
 		(*_ports_array)[_graph_port->index()] = _graph_port;
 		_graph->set_external_ports(std::move(_ports_array));
+	}
 
-		if (_engine_port) {
-			_engine.driver()->add_port(ctx, _engine_port);
-		}
+	if (_status == Status::SUCCESS && _engine_port) {
+		_engine.driver()->add_port(ctx, _engine_port);
 	}
 }
 
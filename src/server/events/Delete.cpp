@@ -104,6 +104,13 @@ Delete::pre_process(PreProcessContext& ctx)
 
 	_engine.store()->remove(iter, _removed_objects);
 
+	// Forget removed graphs so a bundle doesn't update them later
+	for (const auto& r : _removed_objects) {
+		if (auto* const graph = dynamic_cast<GraphImpl*>(r.second.get())) {
+			ctx.forget(*graph);
+		}
+	}
+
 	if (_block) {
 		parent->remove_block(*_block);
 		_disconnect_event =
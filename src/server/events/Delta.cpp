@@ -27,10 +27,13 @@
 #include "CreatePort.hpp"
 #include "Engine.hpp"
 #include "GraphImpl.hpp"
+#include "LV2Block.hpp"
 #include "NodeImpl.hpp"
 #include "PluginImpl.hpp"
 #include "PortImpl.hpp"
 #include "PortType.hpp"
+#include "PreProcessContext.hpp"
+#include "PreProcessPool.hpp"
 #include "SetPortValue.hpp"
 
 #include <ingen/Atom.hpp>
@@ -54,6 +57,7 @@
 
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <set>
 #include <string>
 #include <string_view>
@@ -103,6 +107,8 @@ Delta::Delta(Engine&                           engine,
 	init();
 }
 
+Delta::~Delta() = default;
+
 void
 Delta::init()
 {
@@ -168,8 +174,95 @@ get_file_node(LilvWorld* lworld, const URIs& uris, const Atom& value)
 	return nullptr;
 }
 
+/** Return the URI a client subscription value refers to, if it is valid.
+ *
+ * Subtrees may be given as graph URIs or paths, predicates only as URIs.
+ */
+std::optional<URI>
+get_subscription_uri(const URIs& uris, const URI& key, const Atom& value)
+{
+	if (uris.forge.is_uri(value)) {
+		const URI uri{uris.forge.str(value, false)};
+		if (key == uris.ingen_subscribe && !uri_is_path(uri)) {
+			return std::nullopt;
+		}
+
+		return uri;
+	}
+
+	if (key == uris.ingen_subscribe && value.type() == uris.forge.Path &&
+	    raul::Path::is_valid(value.ptr<char>())) {
+		return path_to_uri(raul::Path{value.ptr<char>()});
+	}
+
+	return std::nullopt;
+}
+
+Broadcaster::Filter
+subscription_filter(const URIs& uris, const URI& key)
+{
+	return key == uris.ingen_subscribe ? Broadcaster::Filter::PATH
+	                                   : Broadcaster::Filter::PROPERTY;
+}
+
 } // namespace
 
+/** Return true iff pre_process() would create a new block. */
+bool
+Delta::creates_block() const
+{
+	if (_type != Type::PUT || !uri_is_path(_subject) ||
+	    _engine.store()->get(uri_to_path(_subject))) {
+		return false;
+	}
+
+	bool is_graph  = false;
+	bool is_block  = false;
+	bool is_port   = false;
+	bool is_output = false;
+	ingen::Resource::type(_engine.world().uris(),
+	                      _properties,
+	                      is_graph,
+	                      is_block,
+	                      is_port,
+	                      is_output);
+
+	return !is_graph && is_block;
+}
+
+void
+Delta::prefetch(PreProcessContext& ctx)
+{
+	if (_prefetched || ctx.pool().n_threads() < 2U) {
+		return;
+	}
+
+	/* Loading a graph puts many new blocks in a row, so instantiate the
+	   blocks for this and the directly following puts all at once. */
+	std::vector<CreateBlock*> creates;
+	{
+		const std::lock_guard<Store::Mutex> lock{_engine.store()->mutex()};
+		for (Event* ev = this; ev && creates.size() < CreateBlock::max_ahead;
+		     ev = ev->next()) {
+			auto* const delta = dynamic_cast<Delta*>(ev);
+			if (!delta || delta->_prefetched || !delta->creates_block()) {
+				break;
+			}
+
+			const raul::Path path{uri_to_path(delta->_subject)};
+
+			delta->_prefetched   = true;
+			delta->_create_ahead = std::make_unique<CreateBlock>(
+				_engine, delta->_request_client, delta->_request_id,
+				delta->_time, path, delta->_properties);
+
+			creates.push_back(delta->_create_ahead.get());
+		}
+	}
+
+	CreateBlock::instantiate_ahead(ctx, creates);
+}
+
 bool
 Delta::pre_process(PreProcessContext& ctx)
 {
@@ -239,6 +332,8 @@ Delta::pre_process(PreProcessContext& ctx)
 		if (is_graph) {
 			_create_event = std::make_unique<CreateGraph>(
 				_engine, _request_client, _request_id, _time, path, _properties);
+		} else if (is_block && _create_ahead) {
+			_create_event = std::move(_create_ahead); // From prefetch()
 		} else if (is_block) {
 			_create_event = std::make_unique<CreateBlock>(
 				_engine, _request_client, _request_id, _time, path, _properties);
@@ -262,6 +357,12 @@ Delta::pre_process(PreProcessContext& ctx)
 
 	auto* obj = dynamic_cast<NodeImpl*>(_object);
 
+	// Subtree whose ports must be re-evaluated for client subscriptions
+	std::optional<raul::Path> resubscribe;
+	const auto resubscribe_under = [&resubscribe](const raul::Path& root) {
+		resubscribe = resubscribe ? raul::Path::lca(*resubscribe, root) : root;
+	};
+
 	// Remove any properties removed in delta
 	for (const auto& r : _remove) {
 		const URI&  key   = r.first;
@@ -275,6 +376,11 @@ Delta::pre_process(PreProcessContext& ctx)
 		if (_object) {
 			_removed.emplace(key, value);
 			_object->remove_property(key, value);
+			if (key == uris.ingen_spareVoices) {
+				if (auto* const graph = dynamic_cast<GraphImpl*>(_object)) {
+					graph->request_spares(0U); // Free spares
+				}
+			}
 		} else if (is_engine && key == uris.ingen_loadedBundle) {
  			LilvWorld* lworld = _engine.world().lilv_world();
 			LilvNode*  bundle = get_file_node(lworld, uris, value);
@@ -291,6 +397,18 @@ Delta::pre_process(PreProcessContext& ctx)
 			} else {
 				_status = Status::BAD_VALUE;
 			}
+		} else if (is_client && (key == uris.ingen_subscribe ||
+		                         key == uris.ingen_subscribeProperty)) {
+			const auto filter = subscription_filter(uris, key);
+			if (value == uris.patch_wildcard) {
+				resubscribe_under(_engine.broadcaster()->unsubscribe(
+					_request_client, filter, nullptr));
+			} else if (const auto uri = get_subscription_uri(uris, key, value)) {
+				resubscribe_under(_engine.broadcaster()->unsubscribe(
+					_request_client, filter, &*uri));
+			} else {
+				_status = Status::BAD_VALUE_TYPE;
+			}
 		}
 	}
 
@@ -314,6 +432,15 @@ Delta::pre_process(PreProcessContext& ctx)
 				q = next;
 			}
 		}
+	} else if (is_client && (_type == Type::PUT || _type == Type::SET)) {
+		// Setting subscriptions replaces any previous ones
+		for (const auto* key : {&uris.ingen_subscribe,
+		                        &uris.ingen_subscribeProperty}) {
+			if (_properties.find(*key) != _properties.end()) {
+				resubscribe_under(_engine.broadcaster()->unsubscribe(
+					_request_client, subscription_filter(uris, *key), nullptr));
+			}
+		}
 	}
 
 	for (const auto& p : _properties) {
@@ -415,10 +542,22 @@ Delta::pre_process(PreProcessContext& ctx)
 							op = SpecialType::POLYPHONY;
 							_graph->prepare_internal_poly(
 								*_engine.buffer_factory(), value.get<int32_t>());
+							if (_graph->spare_voices()) {
+								_graph->request_spares(_graph->spare_voices());
+							}
 						}
 					} else {
 						_status = Status::BAD_VALUE_TYPE;
 					}
+				} else if (key == uris.ingen_spareVoices) {
+					if (value.type() != uris.forge.Int) {
+						_status = Status::BAD_VALUE_TYPE;
+					} else if (value.get<int32_t>() < 0 || value.get<int32_t>() > 128) {
+						_status = Status::BAD_VALUE;
+					} else {
+						_graph->request_spares(
+							static_cast<uint32_t>(value.get<int32_t>()));
+					}
 				}
 			}
 
@@ -439,11 +578,25 @@ Delta::pre_process(PreProcessContext& ctx)
 					} else {
 						obj->prepare_poly(*_engine.buffer_factory(), 1);
 					}
+					auto* const lv2_block = dynamic_cast<LV2Block*>(block);
+					if (lv2_block && parent->spare_voices()) {
+						lv2_block->request_spares(*_engine.idle_worker(),
+						                          parent->spare_voices());
+					}
 				}
 			}
 		} else if (is_client && key == uris.ingen_broadcast) {
 			_engine.broadcaster()->set_broadcast(
 				_request_client, value.get<int32_t>());
+			resubscribe_under(raul::Path{"/"});
+		} else if (is_client && (key == uris.ingen_subscribe ||
+		                         key == uris.ingen_subscribeProperty)) {
+			if (const auto uri = get_subscription_uri(uris, key, value)) {
+				resubscribe_under(_engine.broadcaster()->subscribe(
+					_request_client, subscription_filter(uris, key), *uri));
+			} else {
+				_status = Status::BAD_VALUE_TYPE;
+			}
 		} else if (is_engine && key == uris.ingen_loadedBundle) {
  			LilvWorld* lworld = _engine.world().lilv_world();
 			LilvNode*  bundle = get_file_node(lworld, uris, value);
@@ -469,6 +622,10 @@ Delta::pre_process(PreProcessContext& ctx)
 		_types.push_back(op);
 	}
 
+	if (resubscribe) {
+		_engine.broadcaster()->subscribe_ports(*_engine.store(), *resubscribe);
+	}
+
 	for (auto& s : _set_events) {
 		s->pre_process(ctx);
 	}
@@ -587,6 +744,11 @@ Delta::execute(RunContext& ctx)
 void
 Delta::post_process()
 {
+	if (is_superseded()) {
+		respond();
+		return;
+	}
+
 	if (_state) {
 		auto* block = dynamic_cast<BlockImpl*>(_object);
 		if (block) {
@@ -670,6 +832,39 @@ Delta::undo(Interface& target)
 	}
 }
 
+std::pair<const URI*, const URI*>
+Delta::undo_property() const
+{
+	if (!_create_event && (_type == Type::SET || _type == Type::PUT) &&
+	    _removed.size() == 1) {
+		return {&_subject, &_removed.begin()->first};
+	}
+
+	return {nullptr, nullptr};
+}
+
+bool
+Delta::superseded_by(const Event& next) const
+{
+	/* Only float value sets are merged, since setting anything else may have
+	   side effects, like an atom value which is appended to a sequence. */
+	const auto* const delta = dynamic_cast<const Delta*>(&next);
+	if (!delta || _type != Type::SET || delta->_type != Type::SET ||
+	    _subject != delta->_subject || _context != delta->_context ||
+	    _mode != delta->_mode) {
+		return false;
+	}
+
+	const ingen::URIs& uris   = _engine.world().uris();
+	const auto&        mine   = *_properties.begin();
+	const auto&        theirs = *delta->_properties.begin();
+
+	return mine.first == uris.ingen_value &&
+	       theirs.first == uris.ingen_value &&
+	       mine.second.type() == uris.atom_Float &&
+	       theirs.second.type() == uris.atom_Float;
+}
+
 Event::Execution
 Delta::get_execution() const
 {
@@ -48,6 +48,8 @@ class GraphImpl;
 
 namespace events {
 
+class CreateBlock;
+
 /** Set properties of a graph object.
  * \ingroup engine
  */
@@ -69,18 +71,23 @@ public:
 	      SampleCount                       timestamp,
 	      const ingen::SetProperty&         msg);
 
-	~Delta() override = default;
+	~Delta() override;
 
 	void add_set_event(const char* port_symbol,
 	                   const void* value,
 	                   uint32_t    size,
 	                   uint32_t    type);
 
+	void prefetch(PreProcessContext& ctx) override;
 	bool pre_process(PreProcessContext& ctx) override;
 	void execute(RunContext& ctx) override;
 	void post_process() override;
 	void undo(Interface& target) override;
 
+	std::pair<const URI*, const URI*> undo_property() const override;
+
+	bool superseded_by(const Event& next) const override;
+
 	Execution get_execution() const override;
 
 private:
@@ -101,8 +108,10 @@ private:
 	using SetEvents = std::vector<std::unique_ptr<SetPortValue>>;
 
 	void init();
+	bool creates_block() const;
 
 	std::unique_ptr<Event>           _create_event;
+	std::unique_ptr<CreateBlock>     _create_ahead;
 	SetEvents                        _set_events;
 	std::vector<SpecialType>         _types;
 	std::vector<SpecialType>         _remove_types;
@@ -126,6 +135,7 @@ private:
 	std::optional<Resource> _preset;
 
 	bool _block{false};
+	bool _prefetched{false};
 };
 
 } // namespace events
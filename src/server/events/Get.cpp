@@ -16,12 +16,15 @@
 
 #include "Get.hpp"
 
+#include "BlockFactory.hpp"
 #include "BlockImpl.hpp"
 #include "Broadcaster.hpp"
+#include "ClientQueue.hpp"
 #include "Engine.hpp"
 #include "GraphImpl.hpp"
 #include "PortImpl.hpp"
 
+#include <ingen/Arc.hpp>
 #include <ingen/Forge.hpp>
 #include <ingen/Interface.hpp>
 #include <ingen/Message.hpp>
@@ -33,13 +36,37 @@
 #include <ingen/URIs.hpp>
 #include <ingen/World.hpp>
 #include <ingen/paths.hpp>
+#include <raul/Path.hpp>
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <string>
 #include <utility>
 
 namespace ingen::server::events {
+namespace {
+
+/** Return the catalog version a client has if `uri` requests plugins. */
+std::optional<std::string>
+plugins_request(const URI& uri)
+{
+	if (uri == plugins_uri()) {
+		return std::string{};
+	}
+
+	const std::string& str    = uri.string();
+	const std::string  prefix = plugins_uri("").string();
+	if (!str.compare(0, prefix.length(), prefix)) {
+		return str.substr(prefix.length());
+	}
+
+	return std::nullopt;
+}
+
+} // namespace
 
 Get::Get(Engine&                           engine,
          const std::shared_ptr<Interface>& client,
@@ -49,14 +76,29 @@ Get::Get(Engine&                           engine,
 	, _msg(msg)
 {}
 
+Get::Get(Engine&                           engine,
+         const std::shared_ptr<Interface>& client,
+         SampleCount                       timestamp,
+         const ingen::Get&                 msg,
+         const Cursor&                     cursor)
+	: Event(engine, client, msg.seq, timestamp)
+	, _msg(msg)
+	, _cursor(cursor)
+{}
+
 bool
 Get::pre_process(PreProcessContext&)
 {
 	const std::lock_guard<Store::Mutex> lock{_engine.store()->mutex()};
 
 	const auto& uri = _msg.subject;
-	if (uri == "ingen:/plugins") {
-		_plugins = _engine.block_factory()->plugins();
+	if (const auto version = plugins_request(uri)) {
+		BlockFactory& factory = *_engine.block_factory();
+		_get_plugins     = true;
+		_catalog_version = factory.catalog_version();
+		if (*version != _catalog_version) {
+			_plugins = factory.plugins();
+		}
 		return Event::pre_process_done(Status::SUCCESS);
 	}
 
@@ -65,22 +107,20 @@ Get::pre_process(PreProcessContext&)
 	}
 
 	if (uri_is_path(uri)) {
-		if ((_object = _engine.store()->get(uri_to_path(uri)))) {
-			const BlockImpl* block = nullptr;
-			const GraphImpl* graph = nullptr;
-			const PortImpl*  port  = nullptr;
-			if ((graph = dynamic_cast<const GraphImpl*>(_object))) {
-				_response.put_graph(graph);
-			} else if ((block = dynamic_cast<const BlockImpl*>(_object))) {
-				_response.put_block(block);
-			} else if ((port = dynamic_cast<const PortImpl*>(_object))) {
-				_response.put_port(port);
-			} else {
-				return Event::pre_process_done(Status::BAD_OBJECT_TYPE, uri);
-			}
-			return Event::pre_process_done(Status::SUCCESS);
+		Store&     store = *_engine.store();
+		const auto top   = store.find(uri_to_path(uri));
+		if (top == store.end()) {
+			return Event::pre_process_done(Status::NOT_FOUND, uri);
+		}
+
+		_object = top->second.get();
+		if (!dynamic_cast<const BlockImpl*>(_object) &&
+		    !dynamic_cast<const PortImpl*>(_object)) {
+			return Event::pre_process_done(Status::BAD_OBJECT_TYPE, uri);
 		}
-		return Event::pre_process_done(Status::NOT_FOUND, uri);
+
+		put_chunk(store, top);
+		return Event::pre_process_done(Status::SUCCESS);
 	}
 
 	if ((_plugin = _engine.block_factory()->plugin(uri))) {
@@ -91,6 +131,66 @@ Get::pre_process(PreProcessContext&)
 	return Event::pre_process_done(Status::NOT_FOUND, uri);
 }
 
+/** Put the next chunk of objects or arcs in the tree at `top`. */
+void
+Get::put_chunk(Store& store, const Store::iterator top)
+{
+	const raul::Path& root    = top->first;
+	const auto        in_tree = [&store, &root](const Store::iterator i) {
+		return i != store.end() &&
+		       (i->first == root || i->first.is_child_of(root));
+	};
+
+	Cursor cursor = _cursor.value_or(Cursor{root, std::nullopt, false});
+	size_t n      = 0U;
+
+	if (!cursor.arcs) {
+		// Put objects in path order, which puts parents before children
+		auto i = _cursor ? store.upper_bound(cursor.last) : top;
+		for (; in_tree(i) && n < chunk_size; ++i, ++n) {
+			_response.put_node(i->second.get());
+			cursor.last = i->first;
+		}
+
+		if (in_tree(i)) {
+			_next = cursor;
+			return;
+		}
+
+		cursor = Cursor{root, std::nullopt, true};
+	}
+
+	// Connect the arcs of every graph, now that all objects exist
+	for (auto i = store.lower_bound(cursor.last); in_tree(i); ++i) {
+		const auto* const graph = dynamic_cast<const GraphImpl*>(i->second.get());
+		if (!graph) {
+			continue;
+		}
+
+		/* Continue after the last arc sent by key rather than position, so
+		   arcs added or removed in between don't shift where this resumes. */
+		const Node::Arcs&            arcs = graph->arcs();
+		std::optional<Node::ArcsKey> last;
+		if (i->first == cursor.last) {
+			last = cursor.last_arc;
+		}
+
+		for (auto a = last ? arcs.upper_bound(*last) : arcs.begin();
+		     a != arcs.end();
+		     ++a) {
+			if (n == chunk_size) {
+				_next = Cursor{i->first, last, true};
+				return;
+			}
+
+			_response.connects.push_back(
+				{a->second->tail_path(), a->second->head_path()});
+			last = a->first;
+			++n;
+		}
+	}
+}
+
 void
 Get::execute(RunContext&)
 {}
@@ -99,9 +199,24 @@ void
 Get::post_process()
 {
 	const Broadcaster::Transfer t{*_engine.broadcaster()};
+	if (_request_client && (_object || _cursor)) {
+		send_chunk();
+		return;
+	}
+
 	if (respond() == Status::SUCCESS && _request_client) {
-		if (_msg.subject == "ingen:/plugins") {
-			_engine.broadcaster()->send_plugins_to(_request_client.get(), _plugins);
+		if (_get_plugins) {
+			if (!_plugins.empty()) {
+				_engine.broadcaster()->send_plugins_to(_request_client.get(),
+				                                       _plugins);
+			}
+
+			// Send the version last, so clients know they have every plugin
+			URIs& uris = _engine.world().uris();
+			_request_client->put(
+				plugins_uri(),
+				{{uris.ingen_catalogVersion,
+				  uris.forge.alloc(_catalog_version)}});
 		} else if (_msg.subject == "ingen:/engine") {
 			// TODO: Keep a proper RDF model of the engine
 			URIs&      uris  = _engine.world().uris();
@@ -115,6 +230,19 @@ Get::post_process()
 
 			const Properties load_props = _engine.load_properties();
 			props.insert(load_props.begin(), load_props.end());
+
+			// Report the queue of a remote client to itself
+			const auto queue =
+				std::dynamic_pointer_cast<ClientQueue>(_request_client);
+			if (queue) {
+				props.emplace(
+					uris.ingen_queueDepth,
+					uris.forge.make(static_cast<int32_t>(queue->depth())));
+				props.emplace(
+					uris.ingen_maxQueueDepth,
+					uris.forge.make(static_cast<int32_t>(queue->max_depth())));
+			}
+
 			_request_client->put(URI("ingen:/engine"), props);
 		} else {
 			_response.send(*_request_client);
@@ -122,4 +250,30 @@ Get::post_process()
 	}
 }
 
+/** Send a chunk of a graph object response, and continue with the next.
+ *
+ * The whole response is wrapped in a single bundle, and the response to the
+ * request comes last, so clients can tell when they have received every
+ * chunk either way.
+ */
+void
+Get::send_chunk()
+{
+	if (!_cursor) {
+		_request_client->bundle_begin();
+	}
+
+	if (_status == Status::SUCCESS) {
+		_response.send(*_request_client);
+		if (_next) {
+			_engine.enqueue_event(
+				new Get(_engine, _request_client, _time, _msg, *_next));
+			return;
+		}
+	}
+
+	respond();
+	_request_client->bundle_end();
+}
+
 } // namespace ingen::server::events
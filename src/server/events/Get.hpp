@@ -18,18 +18,23 @@
 #define INGEN_EVENTS_GET_HPP
 
 #include <ingen/Message.hpp>
+#include <ingen/Node.hpp>
+#include <ingen/Store.hpp>
+#include <raul/Path.hpp>
 
 #include "BlockFactory.hpp"
 #include "ClientUpdate.hpp"
 #include "Event.hpp"
 #include "types.hpp"
 
+#include <cstddef>
 #include <memory>
+#include <optional>
+#include <string>
 
 namespace ingen {
 
 class Interface;
-class Node;
 
 namespace server {
 
@@ -39,27 +44,65 @@ class PluginImpl;
 namespace events {
 
 /** A request from a client to send an object.
+ *
+ * Objects in the graph hierarchy are sent with all their descendants, which
+ * may be a lot for a large graph.  So, the response is sent in chunks of at
+ * most chunk_size objects or arcs, each prepared and sent by its own event.
+ * Every chunk enqueues the next one with a cursor to continue from, so the
+ * store is only locked briefly and the client receives the first objects
+ * right away.  Objects are sent in path order so that parents come first,
+ * then the arcs of every graph once all objects have been sent.  All chunks
+ * are sent in one bundle, which ends with the response to the request.
+ *
+ * The plugin catalog is followed by its version, see
+ * BlockFactory::catalog_version().  Clients that have a catalog cached may
+ * get plugins_uri() with its version instead, and then only receive the
+ * plugins if the version has changed.
  *
  * \ingroup engine
  */
 class Get : public Event
 {
 public:
+	/// Position to continue a chunked response from
+	struct Cursor {
+		raul::Path                   last;        ///< Last object or arc graph
+		std::optional<Node::ArcsKey> last_arc;    ///< Last arc of `last` sent
+		bool                         arcs{false}; ///< True once objects sent
+	};
+
+	/// Maximum number of objects or arcs sent in a single chunk
+	static constexpr size_t chunk_size = 256U;
+
 	Get(Engine&                           engine,
 	    const std::shared_ptr<Interface>& client,
 	    SampleCount                       timestamp,
 	    const ingen::Get&                 msg);
 
+	/** Continue sending a response from `cursor`. */
+	Get(Engine&                           engine,
+	    const std::shared_ptr<Interface>& client,
+	    SampleCount                       timestamp,
+	    const ingen::Get&                 msg,
+	    const Cursor&                     cursor);
+
 	bool pre_process(PreProcessContext& ctx) override;
 	void execute(RunContext&) override;
 	void post_process() override;
 
 private:
+	void put_chunk(Store& store, Store::iterator top);
+	void send_chunk();
+
 	const ingen::Get      _msg;
 	const Node*           _object{nullptr};
 	PluginImpl*           _plugin{nullptr};
 	BlockFactory::Plugins _plugins;
+	std::string           _catalog_version;
+	bool                  _get_plugins{false};
 	ClientUpdate          _response;
+	std::optional<Cursor> _cursor; ///< Where this chunk starts, if continued
+	std::optional<Cursor> _next;   ///< Where the next chunk starts, if any
 };
 
 } // namespace events
@@ -24,10 +24,13 @@
 
 #include <ingen/Message.hpp>
 #include <ingen/Status.hpp>
+#include <raul/Maid.hpp>
 
 #include <cassert>
+#include <cstddef>
 #include <memory>
 #include <utility>
+#include <vector>
 
 namespace ingen::server::events {
 
@@ -49,6 +52,12 @@ Mark::Mark(Engine&                           engine,
 	, _depth(-1)
 {}
 
+Mark::Mark(Engine& engine, const std::shared_ptr<Interface>& client)
+	: Event(engine, client, 0, 0)
+	, _type(Type::HANGUP)
+	, _depth(0)
+{}
+
 Mark::~Mark() = default;
 
 void
@@ -65,6 +74,8 @@ Mark::mark(PreProcessContext&)
 	case Type::BUNDLE_END:
 		_depth = stack->finish_entry();
 		break;
+	case Type::HANGUP:
+		break;
 	}
 }
 
@@ -77,18 +88,16 @@ Mark::pre_process(PreProcessContext& ctx)
 
 	switch (_type) {
 	case Type::BUNDLE_BEGIN:
-		ctx.set_in_bundle(true);
+		ctx.begin_bundle(_request_client.get());
 		break;
 	case Type::BUNDLE_END:
-		ctx.set_in_bundle(false);
-		if (!ctx.dirty_graphs().empty()) {
-			for (GraphImpl* g : ctx.dirty_graphs()) {
-				auto cg = compile(*g);
-				if (cg) {
-					_compiled_graphs.emplace(g, std::move(cg));
-				}
-			}
-			ctx.dirty_graphs().clear();
+		if (ctx.end_bundle(_request_client.get())) {
+			finish_bundles(ctx); // Last open bundle of any client ended
+		}
+		break;
+	case Type::HANGUP:
+		if (ctx.end_bundles(_request_client.get())) {
+			finish_bundles(ctx);
 		}
 		break;
 	}
@@ -96,9 +105,41 @@ Mark::pre_process(PreProcessContext& ctx)
 	return Event::pre_process_done(Status::SUCCESS);
 }
 
+/** Prepare everything deferred while bundles were open. */
+void
+Mark::finish_bundles(PreProcessContext& ctx)
+{
+	for (GraphImpl* g : ctx.dirty_ports()) {
+		_ports_arrays.emplace(g, g->build_ports_array(*_engine.maid()));
+	}
+	ctx.dirty_ports().clear();
+
+	if (!ctx.dirty_graphs().empty()) {
+		// Graphs have disjoint blocks, so compile them in parallel
+		const std::vector<GraphImpl*> graphs(ctx.dirty_graphs().begin(),
+		                                     ctx.dirty_graphs().end());
+
+		std::vector<std::unique_ptr<CompiledGraph>> compiled(graphs.size());
+		ctx.pool().run(graphs.size(), [&graphs, &compiled](size_t i) {
+			compiled[i] = compile(*graphs[i]);
+		});
+
+		for (size_t i = 0U; i < graphs.size(); ++i) {
+			if (compiled[i]) {
+				_compiled_graphs.emplace(graphs[i], std::move(compiled[i]));
+			}
+		}
+		ctx.dirty_graphs().clear();
+	}
+}
+
 void
 Mark::execute(RunContext&)
 {
+	for (auto& p : _ports_arrays) {
+		p.first->set_external_ports(std::move(p.second));
+	}
+
 	for (auto& g : _compiled_graphs) {
 		g.second = g.first->swap_compiled_graph(std::move(g.second));
 	}
@@ -129,6 +170,8 @@ Mark::get_execution() const
 			return Execution::UNBLOCK;
 		}
 		break;
+	case Type::HANGUP:
+		break;
 	}
 	return Execution::NORMAL;
 }
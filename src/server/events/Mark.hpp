@@ -19,8 +19,11 @@
 
 #include "CompiledGraph.hpp"
 #include "Event.hpp"
+#include "GraphImpl.hpp"
 #include "types.hpp"
 
+#include <raul/Maid.hpp>
+
 #include <map>
 #include <memory>
 
@@ -33,7 +36,6 @@ struct BundleEnd;
 namespace server {
 
 class Engine;
-class GraphImpl;
 
 namespace events {
 
@@ -57,6 +59,9 @@ public:
 	     SampleCount                       timestamp,
 	     const ingen::BundleEnd&           msg);
 
+	/** End every bundle left open by a client that has hung up. */
+	Mark(Engine& engine, const std::shared_ptr<Interface>& client);
+
 	~Mark() override;
 
 	void mark(PreProcessContext& ctx) override;
@@ -67,11 +72,15 @@ public:
 	Execution get_execution() const override;
 
 private:
-	enum class Type { BUNDLE_BEGIN, BUNDLE_END };
+	enum class Type { BUNDLE_BEGIN, BUNDLE_END, HANGUP };
+
+	void finish_bundles(PreProcessContext& ctx);
 
 	using CompiledGraphs = std::map<GraphImpl*, std::unique_ptr<CompiledGraph>>;
+	using PortsArrays    = std::map<GraphImpl*, raul::managed_ptr<GraphImpl::Ports>>;
 
 	CompiledGraphs _compiled_graphs;
+	PortsArrays    _ports_arrays;
 	Type           _type;
 	int            _depth;
 };
@@ -68,6 +68,7 @@ Move::pre_process(PreProcessContext&)
 	}
 
 	_engine.store()->rename(i, _msg.new_path);
+	_engine.broadcaster()->subscribe_ports(*_engine.store(), _msg.new_path);
 
 	return Event::pre_process_done(Status::SUCCESS);
 }
@@ -17,14 +17,19 @@
 #ifndef INGEN_TESTCLIENT_HPP
 #define INGEN_TESTCLIENT_HPP
 
+#include <ingen/Atom.hpp>
 #include <ingen/Interface.hpp>
 #include <ingen/Log.hpp>
 #include <ingen/Message.hpp>
 #include <ingen/Status.hpp>
 #include <ingen/URI.hpp>
+#include <ingen/ingen.h>
+#include <ingen/paths.hpp>
 
+#include <string>
 #include <variant>
 
+#include <cstddef>
 #include <cstdlib>
 
 namespace ingen {
@@ -38,6 +43,12 @@ public:
 
 	URI uri() const override { return URI("ingen:testClient"); }
 
+	/// Return the version of the plugin catalog last received
+	const std::string& catalog_version() const { return _catalog_version; }
+
+	/// Set whether the next plugin catalog must contain any plugins
+	void expect_plugins(bool expected) { _expect_plugins = expected; }
+
 	void message(const Message& msg) override {
 		if (const Response* const response = std::get_if<Response>(&msg)) {
 			if (response->status != Status::SUCCESS) {
@@ -50,11 +61,30 @@ public:
 		} else if (const Error* const error = std::get_if<Error>(&msg)) {
 			_log.error("error: %1%\n", error->message);
 			exit(EXIT_FAILURE);
+		} else if (const Put* const put = std::get_if<Put>(&msg)) {
+			const auto v = put->properties.find(URI(INGEN__catalogVersion));
+			if (put->uri == plugins_uri() && v != put->properties.end()) {
+				// The version is sent last, so the catalog is complete
+				if ((_n_plugins > 0U) != _expect_plugins) {
+					_log.error("error: %1% plugins sent with catalog %2%\n",
+					           _n_plugins,
+					           v->second.ptr<char>());
+					exit(EXIT_FAILURE);
+				}
+
+				_catalog_version = v->second.ptr<char>();
+				_n_plugins       = 0U;
+			} else if (put->uri.string().compare(0, 6, "ingen:")) {
+				++_n_plugins;
+			}
 		}
 	}
 
 private:
-	Log& _log;
+	Log&        _log;
+	std::string _catalog_version;
+	size_t      _n_plugins{0U};
+	bool        _expect_plugins{true};
 };
 
 } // namespace ingen
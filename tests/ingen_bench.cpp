@@ -19,18 +19,79 @@
 #include <ingen/Configuration.hpp>
 #include <ingen/EngineBase.hpp>
 #include <ingen/Forge.hpp>
+#include <ingen/Interface.hpp>
+#include <ingen/Message.hpp>
 #include <ingen/Parser.hpp>
+#include <ingen/Properties.hpp>
+#include <ingen/Resource.hpp>
+#include <ingen/TurtleWriter.hpp>
+#include <ingen/URI.hpp>
+#include <ingen/URIMap.hpp>
+#include <ingen/URIs.hpp>
 #include <ingen/World.hpp>
 #include <ingen/runtime_paths.hpp>
+#include <raul/Path.hpp>
 
+#if HAVE_SOCKET
+#include <ingen/AtomProtocol.hpp>
+#include <ingen/SocketReader.hpp>
+#include <ingen/SocketWriter.hpp>
+#include <raul/Socket.hpp>
+
+#include <unistd.h>
+#endif
+
+#if HAVE_EPOLL
+#include <ingen/SocketHub.hpp>
+
+#include <sys/socket.h>
+#endif
+
+#include <atomic>
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <exception>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <new>
 #include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/// Number of heap allocations in the whole process, see operator new below
+std::atomic<uint64_t> n_allocations{0U};
+
+} // namespace
+
+void*
+operator new(size_t size)
+{
+	++n_allocations;
+	if (void* const ptr = malloc(size ? size : 1U)) {
+		return ptr;
+	}
+
+	throw std::bad_alloc();
+}
+
+void
+operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+void
+operator delete(void* ptr, size_t) noexcept
+{
+	free(ptr);
+}
 
 namespace ingen::bench {
 namespace {
@@ -56,6 +117,425 @@ real_path(const char* path)
 	return result;
 }
 
+/** Measure event throughput with several threads flooding value changes. */
+int
+bench_events(const std::string& out_file, const int32_t n_producers)
+{
+	const URIs&    uris            = world->uris();
+	Interface&     iface           = *world->interface();
+	EngineBase&    engine          = *world->engine();
+	const URI      port_uri("ingen:/main/bench_in");
+	const uint32_t block_length    = 4096;
+	const uint32_t events_per_prod = 1U << 14U;
+
+	// Create a control input port to send values to
+	iface.put(port_uri,
+	          Properties{{uris.rdf_type, Property(uris.lv2_InputPort)},
+	                     {uris.rdf_type, Property(uris.lv2_ControlPort)}});
+	engine.flush_events(std::chrono::milliseconds(20));
+
+	const ingen::Clock clock;
+	const uint64_t     t_start  = clock.now_microseconds();
+	const uint64_t     n_allocs = n_allocations.load();
+
+	std::vector<std::thread> producers;
+	for (int32_t p = 0; p < n_producers; ++p) {
+		producers.emplace_back([&iface, &uris, &port_uri, events_per_prod] {
+			// Send messages directly, since Interface::_seq is not thread-safe
+			for (uint32_t i = 0; i < events_per_prod; ++i) {
+				const float value = static_cast<float>(i) / events_per_prod;
+				iface.message(SetProperty{0,
+				                          port_uri,
+				                          uris.ingen_value,
+				                          world->forge().make(value),
+				                          Resource::Graph::DEFAULT});
+			}
+		});
+	}
+
+	for (auto& p : producers) {
+		p.join();
+	}
+
+	while (engine.pending_events()) {
+		engine.advance(block_length);
+		engine.run(block_length);
+		engine.main_iteration();
+	}
+
+	const uint64_t t_end    = clock.now_microseconds();
+	const double   run_time = static_cast<double>(t_end - t_start) / 1000000.0;
+	const uint64_t n_events = uint64_t{events_per_prod} * n_producers;
+	const double   allocs_per_event =
+	    static_cast<double>(n_allocations.load() - n_allocs) / n_events;
+
+	// Write log output
+	const std::unique_ptr<FILE, int (*)(FILE*)> log{fopen(out_file.c_str(), "a"),
+	                                                &fclose};
+	if (ftell(log.get()) == 0) {
+		fprintf(log.get(),
+		        "# n_producers\tn_events\trun_time\tevents_per_sec"
+		        "\tallocs_per_event\n");
+	}
+	fprintf(log.get(), "%d\t%llu\t%f\t%f\t%f\n",
+	        n_producers,
+	        static_cast<unsigned long long>(n_events),
+	        run_time,
+	        static_cast<double>(n_events) / run_time,
+	        allocs_per_event);
+
+	return EXIT_SUCCESS;
+}
+
+#if HAVE_SOCKET
+
+/** An Interface that only counts the messages it receives. */
+class MessageCounter : public Interface
+{
+public:
+	URI uri() const override { return URI("ingen:/clients/bench"); }
+
+	void message(const Message&) override { ++n_messages; }
+
+	std::atomic<uint64_t> n_messages{0U};
+};
+
+/** Measure socket throughput of value changes in every message format. */
+int
+bench_socket(const std::string& out_file, const int32_t n_messages)
+{
+	const URIs& uris = world->uris();
+	const URI   port_uri("ingen:/main/bench_in");
+
+	const std::filesystem::path path =
+	    std::filesystem::temp_directory_path() /
+	    ("ingen_bench." + std::to_string(getpid()) + ".sock");
+
+	const URI    uri("unix://" + path.string());
+	raul::Socket listener(raul::Socket::Type::UNIX);
+	if (!listener.bind(uri) || !listener.listen()) {
+		std::cerr << "error: failed to create socket " << path << "\n";
+		return EXIT_FAILURE;
+	}
+
+	const std::unique_ptr<FILE, int (*)(FILE*)> log{fopen(out_file.c_str(), "a"),
+	                                                &fclose};
+	if (ftell(log.get()) == 0) {
+		fprintf(log.get(), "# format\tn_messages\trun_time\tmessages_per_sec\n");
+	}
+
+	for (const SocketFormat format : {SocketFormat::TURTLE, SocketFormat::ATOM}) {
+		const auto client = std::make_shared<raul::Socket>(raul::Socket::Type::UNIX);
+		if (!client->connect(uri)) {
+			std::cerr << "error: failed to connect to " << path << "\n";
+			return EXIT_FAILURE;
+		}
+
+		MessageCounter     counter;
+		const SocketReader reader(*world, counter, listener.accept(), format);
+		SocketWriter writer(world->uri_map(), uris, uri, client, format);
+
+		const ingen::Clock clock;
+		const uint64_t     t_start = clock.now_microseconds();
+
+		for (int32_t i = 0; i < n_messages; ++i) {
+			const float value = static_cast<float>(i) / n_messages;
+			writer.set_property(port_uri,
+			                    uris.ingen_value,
+			                    world->forge().make(value));
+		}
+
+		while (counter.n_messages < static_cast<uint64_t>(n_messages)) {
+			std::this_thread::yield();
+		}
+
+		const uint64_t t_end    = clock.now_microseconds();
+		const double   run_time = static_cast<double>(t_end - t_start) / 1000000.0;
+
+		fprintf(log.get(), "%s\t%d\t%f\t%f\n",
+		        format == SocketFormat::ATOM ? "atom" : "turtle",
+		        n_messages,
+		        run_time,
+		        static_cast<double>(n_messages) / run_time);
+	}
+
+	std::filesystem::remove(path);
+	return EXIT_SUCCESS;
+}
+
+#endif // HAVE_SOCKET
+
+#if HAVE_EPOLL
+
+/** Measure throughput of many socket clients sending value changes at once. */
+int
+bench_hub(const std::string& out_file,
+          const int32_t      n_clients,
+          const int32_t      n_messages)
+{
+	const URIs&    uris = world->uris();
+	const URI      port_uri("ingen:/main/bench_in");
+	const unsigned n_threads =
+	    static_cast<unsigned>(world->conf().option("io-threads").get<int32_t>());
+
+	const std::filesystem::path path =
+	    std::filesystem::temp_directory_path() /
+	    ("ingen_bench." + std::to_string(getpid()) + ".sock");
+
+	const URI    uri("unix://" + path.string());
+	raul::Socket listener(raul::Socket::Type::UNIX);
+	if (!listener.bind(uri) || !listener.listen()) {
+		std::cerr << "error: failed to create socket " << path << "\n";
+		return EXIT_FAILURE;
+	}
+
+	const std::unique_ptr<FILE, int (*)(FILE*)> log{fopen(out_file.c_str(), "a"),
+	                                                &fclose};
+	if (ftell(log.get()) == 0) {
+		fprintf(log.get(),
+		        "# format\tn_clients\tn_threads\tn_messages\trun_time"
+		        "\tmessages_per_sec\n");
+	}
+
+	for (const SocketFormat format : {SocketFormat::TURTLE, SocketFormat::ATOM}) {
+		MessageCounter counter;
+		SocketHub      hub(*world, n_threads);
+
+		// Connect simulated clients, which request a format like SocketClient
+		std::vector<std::unique_ptr<SocketWriter>> writers;
+		for (int32_t i = 0; i < n_clients; ++i) {
+			const auto client =
+			    std::make_shared<raul::Socket>(raul::Socket::Type::UNIX);
+			if (!client->connect(uri)) {
+				std::cerr << "error: failed to connect to " << path << "\n";
+				return EXIT_FAILURE;
+			}
+
+			if (format == SocketFormat::ATOM) {
+				send(client->fd(),
+				     atom_protocol_hello,
+				     sizeof(atom_protocol_hello),
+				     0);
+			}
+
+			hub.add(listener.accept(), counter, nullptr, nullptr);
+			writers.push_back(std::make_unique<SocketWriter>(
+			    world->uri_map(), uris, uri, client, format));
+		}
+
+		const ingen::Clock clock;
+		const uint64_t     t_start = clock.now_microseconds();
+
+		for (int32_t i = 0; i < n_messages; ++i) {
+			const float value = static_cast<float>(i) / n_messages;
+			writers[i % n_clients]->set_property(port_uri,
+			                                     uris.ingen_value,
+			                                     world->forge().make(value));
+		}
+
+		while (counter.n_messages < static_cast<uint64_t>(n_messages)) {
+			std::this_thread::yield();
+		}
+
+		const uint64_t t_end    = clock.now_microseconds();
+		const double   run_time = static_cast<double>(t_end - t_start) / 1000000.0;
+
+		fprintf(log.get(), "%s\t%d\t%u\t%d\t%f\t%f\n",
+		        format == SocketFormat::ATOM ? "atom" : "turtle",
+		        n_clients,
+		        n_threads,
+		        n_messages,
+		        run_time,
+		        static_cast<double>(n_messages) / run_time);
+	}
+
+	std::filesystem::remove(path);
+	return EXIT_SUCCESS;
+}
+
+#endif // HAVE_EPOLL
+
+/** Write a graph bundle with a chain of `n_blocks` blocks to `dir`. */
+void
+write_chain_graph(const std::filesystem::path& dir, const int32_t n_blocks)
+{
+	std::filesystem::create_directories(dir);
+
+	std::ofstream manifest(dir / "manifest.ttl");
+	manifest << "@prefix ingen: <http://drobilla.net/ns/ingen#> .\n"
+	         << "@prefix lv2: <http://lv2plug.in/ns/lv2core#> .\n"
+	         << "@prefix rdfs: <http://www.w3.org/2000/01/rdf-schema#> .\n\n"
+	         << "<main.ttl>\n"
+	         << "\tlv2:prototype ingen:GraphPrototype ;\n"
+	         << "\ta ingen:Graph , lv2:Plugin ;\n"
+	         << "\trdfs:seeAlso <main.ttl> .\n";
+
+	std::ofstream main(dir / "main.ttl");
+	main << "@prefix ingen: <http://drobilla.net/ns/ingen#> .\n"
+	     << "@prefix internals: <http://drobilla.net/ns/ingen-internals#> .\n"
+	     << "@prefix lv2: <http://lv2plug.in/ns/lv2core#> .\n\n";
+
+	for (int32_t i = 0; i < n_blocks; ++i) {
+		main << "<b" << i << ">\n"
+		     << "\tlv2:prototype internals:BlockDelay ;\n"
+		     << "\ta ingen:Block .\n\n";
+	}
+
+	main << "<>\n\ta ingen:Graph , lv2:Plugin";
+	for (int32_t i = 0; i < n_blocks; ++i) {
+		main << " ;\n\tingen:block <b" << i << ">";
+	}
+	for (int32_t i = 1; i < n_blocks; ++i) {
+		main << " ;\n\tingen:arc [ ingen:tail <b" << (i - 1)
+		     << "/out> ; ingen:head <b" << i << "/in> ]";
+	}
+	main << " .\n";
+}
+
+/** Measure the time to load a synthetic graph with `n_blocks` blocks. */
+int
+bench_load(const std::string& out_file, const int32_t n_blocks)
+{
+	EngineBase&    engine       = *world->engine();
+	const uint32_t block_length = 4096;
+
+	const std::filesystem::path dir =
+	    std::filesystem::temp_directory_path() /
+	    ("ingen_bench_" + std::to_string(n_blocks) + ".ingen");
+
+	write_chain_graph(dir, n_blocks);
+
+	const ingen::Clock clock;
+	const uint64_t     t_start = clock.now_microseconds();
+
+	const bool success = world->parser()->parse_file(
+	    *world, *world->interface(), dir, raul::Path("/bench"));
+
+	while (engine.pending_events()) {
+		engine.advance(block_length);
+		engine.run(block_length);
+		engine.main_iteration();
+	}
+
+	const uint64_t t_end = clock.now_microseconds();
+
+	std::filesystem::remove_all(dir);
+	if (!success) {
+		std::cerr << "error: failed to load synthetic graph\n";
+		return EXIT_FAILURE;
+	}
+
+	// Write log output
+	const std::unique_ptr<FILE, int (*)(FILE*)> log{fopen(out_file.c_str(), "a"),
+	                                                &fclose};
+	if (ftell(log.get()) == 0) {
+		fprintf(log.get(), "# n_blocks\tload_time\tblocks_per_sec\n");
+	}
+
+	const double load_time = static_cast<double>(t_end - t_start) / 1000000.0;
+	fprintf(log.get(), "%d\t%f\t%f\n",
+	        n_blocks,
+	        load_time,
+	        static_cast<double>(n_blocks) / load_time);
+
+	return EXIT_SUCCESS;
+}
+
+/** A TurtleWriter that appends everything it writes to a string. */
+class StringWriter : public TurtleWriter
+{
+public:
+	StringWriter(URIMap& map, URIs& uris)
+		: TurtleWriter(map, uris, URI("ingen:/clients/bench"))
+	{}
+
+	size_t text_sink(const void* buf, size_t len) override
+	{
+		text.append(static_cast<const char*>(buf), len);
+		return len;
+	}
+
+	std::string text;
+};
+
+/** Measure Turtle serialisation of value changes, with and without templates. */
+int
+bench_turtle(const std::string& out_file, const int32_t n_messages)
+{
+	URIs&        uris  = world->uris();
+	Forge&       forge = world->forge();
+
+	const URI ports[] = {URI("ingen:/main/bench_in"),
+	                     URI("ingen:/main/bench_out"),
+	                     URI("ingen:/main/block/control")};
+
+	// Make a typical mix of value changes, some with sequence numbers
+	std::vector<Message> messages;
+	messages.reserve(static_cast<size_t>(n_messages));
+	for (int32_t i = 0; i < n_messages; ++i) {
+		const URI&    port = ports[i % 3];
+		const int32_t seq  = (i % 4 == 0) ? i : 0;
+		const float   value =
+			static_cast<float>(i - (n_messages / 2)) / 3.0f;
+
+		if (i % 8 == 7) {
+			messages.emplace_back(
+				Delta{seq,
+				      port,
+				      {{uris.ingen_enabled, Property(forge.make(false))}},
+				      {{uris.ingen_enabled, Property(forge.make(i % 16 == 7))},
+				       {uris.lv2_minimum, Property(forge.make(i))}},
+				      Resource::Graph::DEFAULT});
+		} else {
+			messages.emplace_back(SetProperty{seq,
+			                                  port,
+			                                  uris.ingen_value,
+			                                  forge.make(value),
+			                                  Resource::Graph::DEFAULT});
+		}
+	}
+
+	const std::unique_ptr<FILE, int (*)(FILE*)> log{fopen(out_file.c_str(), "a"),
+	                                                &fclose};
+	if (ftell(log.get()) == 0) {
+		fprintf(log.get(), "# writer\tn_messages\trun_time\tmessages_per_sec\n");
+	}
+
+	std::string outputs[2];
+	for (const bool use_templates : {false, true}) {
+		StringWriter writer(world->uri_map(), uris);
+
+		const ingen::Clock clock;
+		const uint64_t     t_start = clock.now_microseconds();
+
+		for (const Message& msg : messages) {
+			if (use_templates) {
+				writer.message(msg);
+			} else {
+				writer.AtomWriter::message(msg);
+			}
+		}
+
+		const uint64_t t_end    = clock.now_microseconds();
+		const double   run_time = static_cast<double>(t_end - t_start) / 1000000.0;
+
+		fprintf(log.get(), "%s\t%d\t%f\t%f\n",
+		        use_templates ? "template" : "sratom",
+		        n_messages,
+		        run_time,
+		        static_cast<double>(n_messages) / run_time);
+
+		outputs[use_templates] = std::move(writer.text);
+	}
+
+	if (outputs[0] != outputs[1]) {
+		std::cerr << "error: templated Turtle differs from sratom output\n";
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
 int
 run(int argc, char** argv)
 {
@@ -66,6 +546,31 @@ run(int argc, char** argv)
 		world->conf().add(
 			"output", "output", 'O', "File to write benchmark output",
 			ingen::Configuration::SESSION, world->forge().String, Atom());
+		world->conf().add(
+			"producers", "producers", 'P',
+			"Benchmark event throughput with this many sending threads",
+			ingen::Configuration::SESSION, world->forge().Int,
+			world->forge().make(0));
+		world->conf().add(
+			"blocks", "blocks", 'B',
+			"Benchmark loading a synthetic graph with this many blocks",
+			ingen::Configuration::SESSION, world->forge().Int,
+			world->forge().make(0));
+		world->conf().add(
+			"messages", "messages", 'M',
+			"Benchmark socket formats by sending this many messages",
+			ingen::Configuration::SESSION, world->forge().Int,
+			world->forge().make(0));
+		world->conf().add(
+			"turtle", "turtle", 0,
+			"Benchmark Turtle serialisation of this many messages",
+			ingen::Configuration::SESSION, world->forge().Int,
+			world->forge().make(0));
+		world->conf().add(
+			"clients", "clients", 0,
+			"Send benchmark messages from this many clients to a socket hub",
+			ingen::Configuration::SESSION, world->forge().Int,
+			world->forge().make(0));
 		world->load_configuration(argc, argv);
 	} catch (std::exception& e) {
 		std::cout << "ingen: " << e.what() << "\n";
@@ -111,6 +616,51 @@ run(int argc, char** argv)
 	}
 	world->engine()->flush_events(std::chrono::milliseconds(20));
 
+	// Run event throughput benchmark instead if requested
+	const int32_t n_producers = world->conf().option("producers").get<int32_t>();
+	if (n_producers > 0) {
+		const int st = bench_events(out_file, n_producers);
+		world->engine()->deactivate();
+		return st;
+	}
+
+	// Run graph loading benchmark instead if requested
+	const int32_t n_blocks = world->conf().option("blocks").get<int32_t>();
+	if (n_blocks > 0) {
+		const int st = bench_load(out_file, n_blocks);
+		world->engine()->deactivate();
+		return st;
+	}
+
+	// Run Turtle serialisation benchmark instead if requested
+	const int32_t n_turtle = world->conf().option("turtle").get<int32_t>();
+	if (n_turtle > 0) {
+		const int st = bench_turtle(out_file, n_turtle);
+		world->engine()->deactivate();
+		return st;
+	}
+
+#if HAVE_EPOLL
+	// Run socket hub load test instead if requested
+	const int32_t n_clients = world->conf().option("clients").get<int32_t>();
+	if (n_clients > 0) {
+		const int32_t n = world->conf().option("messages").get<int32_t>();
+		const int     st = bench_hub(out_file, n_clients, n > 0 ? n : 100000);
+		world->engine()->deactivate();
+		return st;
+	}
+#endif
+
+#if HAVE_SOCKET
+	// Run socket format benchmark instead if requested
+	const int32_t n_messages = world->conf().option("messages").get<int32_t>();
+	if (n_messages > 0) {
+		const int st = bench_socket(out_file, n_messages);
+		world->engine()->deactivate();
+		return st;
+	}
+#endif
+
 	// Run benchmark
 	// TODO: Set up real-time scheduling for this and worker threads
 	const ingen::Clock clock;
@@ -128,12 +678,14 @@ run(int argc, char** argv)
 	const std::unique_ptr<FILE, int (*)(FILE*)> log{fopen(out_file.c_str(), "a"),
 	                                                &fclose};
 	if (ftell(log.get()) == 0) {
-		fprintf(log.get(), "# n_threads\trun_time\treal_time\n");
+		fprintf(log.get(), "# n_threads\trun_time\treal_time\tcycle_time\n");
 	}
-	fprintf(log.get(), "%d\t%f\t%f\n",
+	const uint32_t n_cycles = n_test_frames / block_length;
+	fprintf(log.get(), "%d\t%f\t%f\t%f\n",
 	        world->conf().option("threads").get<int32_t>(),
 	        static_cast<double>(t_end - t_start) / 1000000.0,
-	        (n_test_frames / 48000.0));
+	        (n_test_frames / 48000.0),
+	        static_cast<double>(t_end - t_start) / n_cycles);
 
 	// Shut down
 	world->engine()->deactivate();
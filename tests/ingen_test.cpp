@@ -23,6 +23,7 @@
 #include <ingen/EngineBase.hpp>
 #include <ingen/FilePath.hpp>
 #include <ingen/Interface.hpp>
+#include <ingen/Message.hpp>
 #include <ingen/Parser.hpp>
 #include <ingen/Serialiser.hpp>
 #include <ingen/Store.hpp>
@@ -31,6 +32,7 @@
 #include <ingen/World.hpp>
 #include <ingen/fmt.hpp>
 #include <ingen/memory.hpp>
+#include <ingen/paths.hpp>
 #include <ingen/runtime_paths.hpp>
 #include <raul/Path.hpp>
 #include <serd/serd.h>
@@ -46,6 +48,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <variant>
 
 // #define DUMP_EVENTS 1
 
@@ -64,6 +67,40 @@ ingen_try(bool cond, const char* msg)
 	}
 }
 
+/** Forwards commands to the engine, and tells the client what to expect.
+ *
+ * Commands may get plugins_uri("cached") to request the catalog at the
+ * version the client last received, which must not send any plugins.
+ */
+class CommandSink : public Interface
+{
+public:
+	CommandSink(Interface& engine, TestClient& client)
+		: _engine(engine), _client(client)
+	{}
+
+	URI uri() const override { return URI("ingen:testCommands"); }
+
+	void message(const Message& msg) override {
+		const auto* const get    = std::get_if<Get>(&msg);
+		const std::string prefix = plugins_uri().string();
+		if (!get || get->subject.string().compare(0, prefix.length(), prefix)) {
+			_engine.message(msg);
+		} else if (get->subject == plugins_uri("cached")) {
+			_client.expect_plugins(false);
+			_engine.message(
+				Get{get->seq, plugins_uri(_client.catalog_version())});
+		} else {
+			_client.expect_plugins(true);
+			_engine.message(msg);
+		}
+	}
+
+private:
+	Interface&  _engine;
+	TestClient& _client;
+};
+
 FilePath
 real_file_path(const char* path)
 {
@@ -132,18 +169,16 @@ run(int argc, char** argv)
 
 	sratom_set_object_mode(&forge.sratom(), SRATOM_OBJECT_MODE_BLANK_SUBJECT);
 
-	// AtomReader to read commands from a file and send them to engine
-	AtomReader atom_reader(world->uri_map(),
-	                       world->uris(),
-	                       world->log(),
-	                       *world->interface());
-
 	// AtomWriter to serialise responses from the engine
-	const std::shared_ptr<Interface> client{new TestClient(world->log())};
+	const auto client = std::make_shared<TestClient>(world->log());
 
 	world->interface()->set_respondee(client);
 	world->engine()->register_client(client);
 
+	// AtomReader to read commands from a file and send them to engine
+	CommandSink sink{*world->interface(), *client};
+	AtomReader  atom_reader(world->uri_map(), world->uris(), world->log(), sink);
+
 	SerdURI cmds_base;
 	SerdNode cmds_file_uri = serd_node_new_file_uri(
 		reinterpret_cast<const uint8_t*>(run_path.c_str()),